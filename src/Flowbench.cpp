@@ -0,0 +1,287 @@
+#include "DnsParser.hpp"
+#include "FlatFlowTable.hpp"
+#include "FlowId.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <getopt.h>
+#include <pcap/pcap.h>
+#include <random>
+#include <tins/dns.h>
+#include <tins/exceptions.h>
+#include <unordered_map>
+
+using namespace flowstats;
+
+static struct option FlowBenchOptions[] = {
+    { "flows", required_argument, nullptr, 'n' },
+    { "dns-pcap", required_argument, nullptr, 'p' },
+    { "dns-queries", required_argument, nullptr, 'q' },
+    { "help", no_argument, nullptr, 'h' },
+    { nullptr, 0, nullptr, 0 }
+};
+
+/**
+ * Print application usage
+ */
+static auto printUsage()
+{
+    printf("\nUsage: \n"
+           "----------------------\n"
+           "flowbench [-n numFlows]... [-p pcap]... [-q numQueries] -h \n"
+           "\nOptions:\n\n"
+           "    -n           : Number of concurrent flows, can be repeated. Default to 1M and 10M\n"
+           "    -p           : Parse the dns messages of a pcap, can be repeated\n"
+           "    -q           : Number of synthetic dns queries parsed, each with its response. Default to 1M\n"
+           "    -h           : Displays this help message and exits\n\n");
+    exit(0);
+}
+
+/**
+ * Per field hash summing, as the flow table used before FlowId::hash
+ */
+struct SumFlowIdHash {
+    auto operator()(FlowId const& flowId) const -> size_t
+    {
+        return std::hash<IPAddress>()(flowId.getIp(0)) + std::hash<IPAddress>()(flowId.getIp(1))
+            + std::hash<uint16_t>()(flowId.getPort(0)) + std::hash<uint16_t>()(flowId.getPort(1))
+            + std::hash<uint8_t>()(flowId.getTransport());
+    }
+};
+
+// Stand in for the per flow state, the size of a TcpFlow
+struct BenchFlow {
+    std::array<uint64_t, 8> counters = {};
+};
+
+using Clock = std::chrono::steady_clock;
+
+static auto elapsedNs(Clock::time_point start, size_t ops) -> double
+{
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+    return static_cast<double>(elapsed.count()) / ops;
+}
+
+/**
+ * Clients behind a few NAT addresses talking to a few servers, the case
+ * where the summed hash collides the most
+ */
+static auto generateFlowIds(size_t numFlows) -> std::vector<FlowId>
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<uint32_t> dist;
+    std::vector<FlowId> flowIds;
+    flowIds.reserve(numFlows);
+    for (size_t i = 0; i < numFlows; ++i) {
+        std::array<uint8_t, 4> clt = { 10, 0, static_cast<uint8_t>(dist(gen) % 16), static_cast<uint8_t>(dist(gen) % 256) };
+        std::array<uint8_t, 4> srv = { 172, 16, 0, static_cast<uint8_t>(dist(gen) % 64) };
+        uint16_t cltPort = 1024 + dist(gen) % 64000;
+        uint16_t srvPort = (i % 2) ? 443 : 80;
+        IPAddressPair pair = { IPAddress::fromIpv4(clt.data()), IPAddress::fromIpv4(srv.data()) };
+        flowIds.emplace_back(std::array<uint16_t, 2> { cltPort, srvPort }, pair, Transport::TCP);
+    }
+    return flowIds;
+}
+
+template <typename Map>
+static auto benchMap(std::string const& name, Map* map, std::vector<FlowId> const& flowIds,
+    std::vector<FlowId> const& churnIds) -> void
+{
+    auto start = Clock::now();
+    for (auto const& flowId : flowIds) {
+        map->emplace(flowId, BenchFlow());
+    }
+    auto insertNs = elapsedNs(start, flowIds.size());
+
+    // Packets hit flows in random order
+    std::vector<uint32_t> order(flowIds.size());
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(1));
+
+    start = Clock::now();
+    size_t found = 0;
+    for (auto i : order) {
+        auto it = map->find(flowIds[i]);
+        if (it != map->end()) {
+            it->second.counters[0]++;
+            found++;
+        }
+    }
+    auto lookupNs = elapsedNs(start, order.size());
+
+    // Flows closing while new ones open, at constant table size
+    start = Clock::now();
+    for (size_t i = 0; i < churnIds.size(); ++i) {
+        map->erase(flowIds[order[i]]);
+        map->emplace(churnIds[i], BenchFlow());
+    }
+    auto churnNs = elapsedNs(start, churnIds.size());
+
+    start = Clock::now();
+    for (auto const& flowId : churnIds) {
+        found += map->find(flowId) != map->end();
+    }
+    auto lookupAfterChurnNs = elapsedNs(start, churnIds.size());
+
+    printf("%-32s insert %7.1f ns  lookup %7.1f ns  erase+insert %7.1f ns  lookup after churn %7.1f ns  (%zu found)\n",
+        name.c_str(), insertNs, lookupNs, churnNs, lookupAfterChurnNs, found);
+}
+
+static auto benchFlowTables(size_t numFlows) -> void
+{
+    printf("\n%zu concurrent flows\n", numFlows);
+    auto flowIds = generateFlowIds(numFlows);
+    // Same seed, so only the ids past numFlows are new flows
+    auto churnIds = generateFlowIds(numFlows + numFlows / 4);
+    churnIds.erase(churnIds.begin(), churnIds.begin() + numFlows);
+    {
+        std::unordered_map<FlowId, BenchFlow, SumFlowIdHash> map;
+        benchMap("unordered_map, summed hash", &map, flowIds, churnIds);
+    }
+    {
+        std::unordered_map<FlowId, BenchFlow> map;
+        benchMap("unordered_map, FlowId::hash", &map, flowIds, churnIds);
+    }
+    {
+        FlatFlowTable<FlowId, BenchFlow> map(numFlows);
+        benchMap("FlatFlowTable, FlowId::hash", &map, flowIds, churnIds);
+    }
+}
+
+/**
+ * Payloads of the udp dns messages of a pcap
+ */
+static auto readDnsPayloads(std::string const& fileName) -> std::vector<std::vector<uint8_t>>
+{
+    std::vector<std::vector<uint8_t>> payloads;
+    char errbuf[PCAP_ERRBUF_SIZE];
+    auto* handle = pcap_open_offline(fileName.c_str(), errbuf);
+    if (handle == nullptr) {
+        fprintf(stderr, "Could not open %s: %s\n", fileName.c_str(), errbuf);
+        return payloads;
+    }
+    pcap_pkthdr* header;
+    uint8_t const* data;
+    while (pcap_next_ex(handle, &header, &data) == 1) {
+        PacketView packet;
+        if (packet.parseFrame(pcap_datalink(handle), data, header->caplen, header->ts) != PACKET_OK
+            || !packet.isUdp() || (packet.getSrcPort() != 53 && packet.getDstPort() != 53)) {
+            continue;
+        }
+        payloads.emplace_back(packet.getPayload(), packet.getPayload() + packet.getPayloadSize());
+    }
+    pcap_close(handle);
+    return payloads;
+}
+
+/**
+ * Queries over a few thousand names, each followed by a response with a
+ * cname and two addresses
+ */
+static auto generateDnsPayloads(size_t numQueries) -> std::vector<std::vector<uint8_t>>
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<uint32_t> dist;
+    std::vector<std::vector<uint8_t>> payloads;
+    payloads.reserve(numQueries * 2);
+    for (size_t i = 0; i < numQueries; ++i) {
+        auto name = fmt::format("host{}.service{}.example.com", dist(gen) % 1000, dist(gen) % 8);
+        Tins::DNS query;
+        query.id(static_cast<uint16_t>(i));
+        query.type(Tins::DNS::QUERY);
+        query.add_query(Tins::DNS::query(name, Tins::DNS::A, Tins::DNS::INTERNET));
+        payloads.push_back(query.serialize());
+
+        auto response = query;
+        response.type(Tins::DNS::RESPONSE);
+        auto cname = "edge." + name;
+        response.add_answer(Tins::DNS::resource(name, cname, Tins::DNS::CNAME, Tins::DNS::INTERNET, 300));
+        response.add_answer(Tins::DNS::resource(cname, fmt::format("10.0.{}.{}", i % 256, i / 256 % 256),
+            Tins::DNS::A, Tins::DNS::INTERNET, 60));
+        response.add_answer(Tins::DNS::resource(cname, "10.1.0.1", Tins::DNS::A, Tins::DNS::INTERNET, 60));
+        payloads.push_back(response.serialize());
+    }
+    return payloads;
+}
+
+/**
+ * Extract what the dns collector needs, with Tins::DNS and with DnsMessage
+ */
+static auto benchDnsParsers(std::string const& name, std::vector<std::vector<uint8_t>> const& payloads) -> void
+{
+    auto start = Clock::now();
+    size_t tinsAddresses = 0;
+    for (auto const& payload : payloads) {
+        try {
+            Tins::DNS dns(payload.data(), static_cast<uint32_t>(payload.size()));
+            auto queries = dns.queries();
+            if (queries.empty() || dns.type() == Tins::DNS::QUERY) {
+                continue;
+            }
+            for (auto const& answer : dns.answers()) {
+                if (answer.query_type() == Tins::DNS::A || answer.query_type() == Tins::DNS::AAAA) {
+                    tinsAddresses += !answer.data().empty();
+                }
+            }
+        } catch (Tins::malformed_packet const&) {
+        }
+    }
+    auto tinsNs = elapsedNs(start, payloads.size());
+
+    start = Clock::now();
+    size_t addresses = 0;
+    DnsMessage message;
+    for (auto const& payload : payloads) {
+        if (message.parse(payload.data(), static_cast<uint32_t>(payload.size()))) {
+            addresses += message.getNumAddresses();
+        }
+    }
+    auto parserNs = elapsedNs(start, payloads.size());
+
+    printf("%-32s Tins::DNS %7.1f ns  DnsMessage %7.1f ns  (%zu messages, %zu/%zu addresses)\n",
+        name.c_str(), tinsNs, parserNs, payloads.size(), tinsAddresses, addresses);
+}
+
+/**
+ * main method of this utility
+ */
+auto main(int argc, char* argv[]) -> int
+{
+    std::vector<size_t> numFlows;
+    std::vector<std::string> dnsPcaps;
+    size_t numDnsQueries = 1000000;
+    int optionIndex = 0;
+    int opt = 0;
+    while ((opt = getopt_long(argc, argv, "n:p:q:h", FlowBenchOptions, &optionIndex)) != -1) {
+        switch (opt) {
+            case 'n':
+                numFlows.push_back(std::max(1L, atol(optarg)));
+                break;
+            case 'p':
+                dnsPcaps.emplace_back(optarg);
+                break;
+            case 'q':
+                numDnsQueries = std::max(1L, atol(optarg));
+                break;
+            default:
+                printUsage();
+        }
+    }
+    if (numFlows.empty()) {
+        numFlows = { 1000000, 10000000 };
+    }
+
+    for (auto n : numFlows) {
+        benchFlowTables(n);
+    }
+
+    printf("\nDns parsing, per message\n");
+    for (auto const& pcap : dnsPcaps) {
+        benchDnsParsers(pcap, readDnsPayloads(pcap));
+    }
+    benchDnsParsers(fmt::format("{} synthetic queries", numDnsQueries), generateDnsPayloads(numDnsQueries));
+    return 0;
+}
@@ -9,7 +9,9 @@
 #include <cstdlib>
 #include <cstring>
 #include <getopt.h>
+#include <memory>
 #include <netinet/in.h>
+#include <thread>
 
 #define EXIT_WITH_ERROR(reason, ...)                      \
     do {                                                  \
@@ -27,12 +29,25 @@ static struct option FlowStatsOptions[] = {
     { "max-results", required_argument, nullptr, 'm' },
     { "resolve-domains", required_argument, nullptr, 'd' },
     { "server-ports", required_argument, nullptr, 'k' },
+    { "ring-block-size", required_argument, nullptr, 'B' },
+    { "ring-block-count", required_argument, nullptr, 'N' },
+    { "capture-workers", required_argument, nullptr, 'j' },
+    { "max-flows", required_argument, nullptr, 'M' },
+    { "flow-timeout", required_argument, nullptr, 'T' },
+    { "max-fqdn-entries", required_argument, nullptr, 'E' },
+    { "fqdn-cache-file", required_argument, nullptr, 'C' },
+    { "prefix-file", required_argument, nullptr, 'P' },
+    { "reverse-dns", required_argument, nullptr, 'D' },
+    { "dns-rollup", required_argument, nullptr, 'O' },
+    { "dns-max-keys", required_argument, nullptr, 'K' },
 
     { "ignore-unknown-fqdn", no_argument, nullptr, 'u' },
     { "no-curses", no_argument, nullptr, 'n' },
     { "no-display", no_argument, nullptr, 'c' },
     { "verbose", no_argument, nullptr, 'v' },
     { "per-ip-aggr", no_argument, nullptr, 'w' },
+    { "dns-per-resolver", no_argument, nullptr, 'r' },
+    { "no-ring", no_argument, nullptr, 'R' },
     { "list-interfaces", no_argument, nullptr, 'l' },
     { "help", no_argument, nullptr, 'h' },
     { nullptr, 0, nullptr, 0 }
@@ -52,6 +67,19 @@ static auto printUsage()
            "    -a           : Address of the ddagent\n"
            "    -b           : Bpf filter to apply\n"
            "    -m           : Maximum number of result to display\n"
+           "    -R           : Capture with libpcap instead of the TPACKET_V3 ring\n"
+           "    -B           : Size in bytes of a ring block\n"
+           "    -N           : Number of ring blocks\n"
+           "    -j           : Number of capture workers sharing the ring fanout\n"
+           "    -M           : Maximum number of concurrent tcp and ssl flows and pending dns queries tracked\n"
+           "    -T           : Idle time in milliseconds before a flow times out\n"
+           "    -E           : Maximum number of ip to fqdn mappings per address family\n"
+           "    -C           : File where ip to fqdn mappings are saved and loaded on start\n"
+           "    -P           : File of \"<cidr> <name>\" lines naming addresses without dns mapping\n"
+           "    -D           : Dns server to query for PTR records of addresses without fqdn\n"
+           "    -O           : Aggregate dns names on their last n labels or, with \"registered\", their registered domain\n"
+           "    -K           : Maximum number of dns aggregations, new names go in an Other aggregation past it\n"
+           "    -r           : Aggregate dns queries per resolver with their response codes\n"
            "    -v           : Verbose log\n"
            "    -h           : Displays this help message and exits\n"
            "    -l           : Print the list of interfaces and exists\n\n");
@@ -77,7 +105,7 @@ auto main(int argc, char* argv[]) -> int
     bool noCurses = false;
     bool pcapReplay = false;
 
-    while ((opt = getopt_long(argc, argv, "k:i:a:f:o:b:m:p:d:cnuwhvl", FlowStatsOptions,
+    while ((opt = getopt_long(argc, argv, "k:i:a:f:o:b:m:p:d:B:N:j:M:T:E:C:P:D:O:K:cnuwrhvlR", FlowStatsOptions,
                 &optionIndex))
         != -1) {
         switch (opt) {
@@ -126,6 +154,49 @@ auto main(int argc, char* argv[]) -> int
             case 'w':
                 conf.setPerIpAggr(true);
                 break;
+            case 'r':
+                conf.setDnsPerResolver(true);
+                break;
+            case 'R':
+                conf.setUseRing(false);
+                break;
+            case 'B':
+                conf.setRingBlockSize(atoi(optarg));
+                break;
+            case 'N':
+                conf.setRingBlockCount(atoi(optarg));
+                break;
+            case 'j':
+                conf.setCaptureWorkers(std::max(1, atoi(optarg)));
+                break;
+            case 'M':
+                conf.setMaxFlows(std::max(1, atoi(optarg)));
+                break;
+            case 'T':
+                conf.setTimeoutFlowMs(std::max(1, atoi(optarg)));
+                break;
+            case 'E':
+                conf.setMaxFqdnEntries(std::max(1, atoi(optarg)));
+                break;
+            case 'C':
+                conf.setFqdnCacheFile(optarg);
+                break;
+            case 'P':
+                conf.setPrefixFile(optarg);
+                break;
+            case 'D':
+                conf.setReverseDnsServer(optarg);
+                break;
+            case 'O':
+                if (strcmp(optarg, "registered") == 0) {
+                    conf.setDnsRollupRegistered(true);
+                } else {
+                    conf.setDnsRollupDepth(std::max(0, atoi(optarg)));
+                }
+                break;
+            case 'K':
+                conf.setDnsMaxKeys(std::max(1, atoi(optarg)));
+                break;
             case 'l':
                 flowstats::listInterfaces();
                 break;
@@ -140,33 +211,74 @@ auto main(int argc, char* argv[]) -> int
     }
 
     pcapReplay = conf.getPcapFileName() != "";
-    std::vector<flowstats::Collector*> collectors;
+    if (pcapReplay) {
+        conf.setCaptureWorkers(1);
+    }
     conf.setDomainToServerPort(flowstats::getDomainToServerPort(initialServerPorts));
 
     flowstats::IpToFqdn ipToFqdn(conf, initialDomains, localhostIp);
 
-    collectors.push_back(
-        new flowstats::DnsStatsCollector(conf, displayConf, &ipToFqdn));
-    collectors.push_back(new flowstats::SslStatsCollector(conf,
-        displayConf, &ipToFqdn));
-    collectors.push_back(
-        new flowstats::TcpStatsCollector(conf, displayConf, &ipToFqdn));
+    // Each capture worker owns its collectors, the screen displays the
+    // first worker's collectors which merge the other shards
+    std::vector<std::vector<flowstats::Collector*>> workerCollectors(conf.getCaptureWorkers());
+    for (auto& collectors : workerCollectors) {
+        collectors.push_back(
+            new flowstats::DnsStatsCollector(conf, displayConf, &ipToFqdn));
+        collectors.push_back(new flowstats::SslStatsCollector(conf,
+            displayConf, &ipToFqdn));
+        collectors.push_back(
+            new flowstats::TcpStatsCollector(conf, displayConf, &ipToFqdn));
+    }
+    auto const& collectors = workerCollectors[0];
+    for (size_t worker = 1; worker < workerCollectors.size(); ++worker) {
+        for (size_t i = 0; i < collectors.size(); ++i) {
+            collectors[i]->addShard(workerCollectors[worker][i]);
+        }
+    }
 
     std::atomic_bool shouldStop = false;
     flowstats::Screen screen(&shouldStop, &displayConf,
         noCurses, noDisplay, pcapReplay, collectors);
     flowstats::PktSource pktSource(&screen, conf, collectors, &shouldStop);
+    std::vector<std::unique_ptr<flowstats::PktSource>> workers;
+    for (size_t worker = 1; worker < workerCollectors.size(); ++worker) {
+        workers.push_back(std::make_unique<flowstats::PktSource>(nullptr,
+            conf, workerCollectors[worker], &shouldStop));
+        pktSource.addFanoutWorker(workers.back().get());
+    }
+
     screen.startDisplay();
     if (pcapReplay) {
+        // A replay is fast, don't let it outrun the initial domains
+        ipToFqdn.waitForResolution();
         pktSource.analyzePcapFile();
     } else {
         std::vector<Tins::IPv4Address> localIps = pktSource.getLocalIps();
         ipToFqdn.updateFqdn("localhost", localIps, {});
-        pktSource.analyzeLiveTraffic();
+
+        // All rings need to be in the fanout group before traffic is split
+        bool captureOpened = pktSource.openLiveCapture();
+        for (auto& worker : workers) {
+            captureOpened = captureOpened && worker->openLiveCapture();
+        }
+        if (captureOpened) {
+            std::vector<std::thread> workerThreads;
+            for (auto& worker : workers) {
+                workerThreads.emplace_back(&flowstats::PktSource::analyzeLiveTraffic, worker.get());
+            }
+            pktSource.analyzeLiveTraffic();
+            for (auto& workerThread : workerThreads) {
+                workerThread.join();
+            }
+        } else {
+            shouldStop.store(true);
+        }
     }
 
     screen.stopDisplay();
-    for (auto* collector : collectors) {
-        delete collector;
+    for (auto const& shardCollectors : workerCollectors) {
+        for (auto* collector : shardCollectors) {
+            delete collector;
+        }
     }
 }
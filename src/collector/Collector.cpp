@@ -1,6 +1,8 @@
 #include "Collector.hpp"
 #include "FlowId.hpp"
+#include <algorithm>
 #include <arpa/inet.h>
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <iterator>
@@ -10,13 +12,59 @@
 
 namespace flowstats {
 
-auto Collector::buildTotalFlow(std::vector<Flow const*> const& aggregatedFlows) -> void
+/**
+ * totalFlow is updated along the aggregated flows. It only needs to be
+ * rebuilt when a filter hides some flows, and with shards, it's the sum
+ * of their totals.
+ */
+auto Collector::buildTotalFlow(std::vector<Flow*> const& aggregatedFlows,
+    SnapshotList const& snapshots) -> Flow*
 {
-    totalFlow->resetFlow(true);
-    for (auto const* flow : aggregatedFlows) {
-        totalFlow->addAggregatedFlow(flow);
+    auto const& filter = displayConf.getFilter();
+    if (filter.empty() && snapshots.size() == 1) {
+        auto* flow = snapshots[0]->totalFlow.get();
+        flow->prepareSubfields(flowFormatter.getSubFields());
+        return flow;
+    }
+
+    if (mergedTotalFlow == nullptr) {
+        mergedTotalFlow = snapshots[0]->totalFlow->clone();
+    }
+    mergedTotalFlow->resetFlow(true);
+    if (filter.empty()) {
+        for (auto const& shardSnapshot : snapshots) {
+            mergedTotalFlow->addAggregatedFlow(shardSnapshot->totalFlow.get());
+        }
+    } else {
+        for (auto const* flow : aggregatedFlows) {
+            mergedTotalFlow->addAggregatedFlow(flow);
+        }
+    }
+    mergedTotalFlow->prepareSubfields(flowFormatter.getSubFields());
+    return mergedTotalFlow;
+}
+
+auto Collector::mergeShards(SnapshotList const& snapshots) -> void
+{
+    for (auto& pair : mergedMap) {
+        pair.second->resetFlow(true);
+    }
+
+    for (auto const& shardSnapshot : snapshots) {
+        for (auto const& pair : shardSnapshot->flows) {
+            auto it = mergedMap.find(pair.first);
+            if (it == mergedMap.end()) {
+                auto* mergedFlow = pair.second->clone();
+                mergedFlow->resetFlow(true);
+                it = mergedMap.emplace(pair.first, mergedFlow).first;
+            }
+            it->second->addAggregatedFlow(pair.second.get());
+        }
+    }
+
+    for (auto& pair : mergedMap) {
+        pair.second->mergePercentiles();
     }
-    totalFlow->prepareSubfields(flowFormatter.getSubFields());
 }
 
 auto Collector::fillSortFields() -> void
@@ -61,70 +109,189 @@ auto Collector::mergePercentiles() -> void
 
 auto Collector::resetMetrics() -> void
 {
-    const std::lock_guard<std::mutex> lock(dataMutex);
     for (auto& pair : aggregatedMap) {
         pair.second->resetFlow(false);
     }
+    totalFlow->resetFlow(false);
 }
 
-auto Collector::outputStatus(time_t duration) -> CollectorOutput
+namespace {
+    /**
+     * Whether the packet thread holds the only reference left, the screen
+     * thread being done with it
+     */
+    template <typename T>
+    auto isUnshared(std::shared_ptr<T> const& ptr) -> bool
+    {
+        if (ptr.use_count() != 1) {
+            return false;
+        }
+        // Pairs with the release of the last reference by the screen thread
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+} // namespace
+
+/**
+ * Only the flows changed since the last snapshot are copied, into the
+ * storage of their copy from two snapshots ago when it's free
+ */
+auto Collector::publishSnapshot() -> void
 {
-    auto headers = flowFormatter.outputHeaders(displayConf);
+    auto newSnapshot = std::move(spareSnapshot);
+    if (newSnapshot == nullptr || !isUnshared(newSnapshot)) {
+        newSnapshot = std::make_shared<CollectorSnapshot>();
+    }
+    // Drop the references to the spare flow copies before reusing them
+    newSnapshot->flows.clear();
+    newSnapshot->totalFlow.reset();
 
-    const std::lock_guard<std::mutex> lock(dataMutex);
-    mergePercentiles();
+    auto publish = [&](Flow* flow) -> std::shared_ptr<Flow> const& {
+        auto& published = publishedFlows[flow];
+        if (published.current != nullptr && !flow->getChanged()) {
+            return published.current;
+        }
+        flow->setChanged(false);
+        auto copy = std::move(published.spare);
+        if (copy != nullptr && isUnshared(copy)) {
+            flow->copyTo(copy.get());
+        } else {
+            copy.reset(flow->clone());
+        }
+        published.spare = std::move(published.current);
+        published.current = std::move(copy);
+        return published.current;
+    };
 
-    std::vector<Flow const*> aggregatedFlows = getAggregatedFlows();
-    buildTotalFlow(aggregatedFlows);
-    aggregatedFlows.insert(aggregatedFlows.begin(), totalFlow);
+    newSnapshot->flows.reserve(aggregatedMap.size());
+    for (auto const& pair : aggregatedMap) {
+        newSnapshot->flows.emplace_back(pair.first, publish(pair.second));
+    }
+    newSnapshot->totalFlow = publish(totalFlow);
 
-    auto bodyLines = flowFormatter.outputFlow(aggregatedFlows, duration, displayConf);
-    return CollectorOutput(toString(), headers, bodyLines);
+    std::atomic_store(&snapshot, std::shared_ptr<CollectorSnapshot const>(newSnapshot));
+    spareSnapshot = std::move(publishedSnapshot);
+    publishedSnapshot = std::move(newSnapshot);
 }
 
-auto Collector::getAggregatedFlows() const -> std::vector<Flow const*>
+auto Collector::outputStatus(time_t duration, int firstRow, int numRows) -> CollectorOutput
 {
-    std::vector<Flow const*> tempVector;
-    auto aggregatedMap = getAggregatedMap();
-    tempVector.reserve(aggregatedMap.size());
-    for (auto const& pair : aggregatedMap) {
-        auto* flow = pair.second;
-        auto filter = displayConf.getFilter();
-        if (!filter.empty()) {
-            if (flow->getFqdn().find(filter) == std::string::npos) {
-                continue;
-            }
+    auto headers = flowFormatter.outputHeaders(displayConf);
+
+    // Snapshots are immutable, only the screen thread formats them
+    SnapshotList snapshots;
+    snapshots.push_back(getSnapshot());
+    if (snapshots[0] == nullptr) {
+        return CollectorOutput(toString(), headers, {}, 0, 0);
+    }
+    for (auto* shard : shards) {
+        auto shardSnapshot = shard->getSnapshot();
+        if (shardSnapshot != nullptr) {
+            snapshots.push_back(std::move(shardSnapshot));
+        }
+    }
+
+    std::vector<Flow*> flows;
+    if (snapshots.size() == 1) {
+        flows.reserve(snapshots[0]->flows.size());
+        for (auto const& pair : snapshots[0]->flows) {
+            flows.push_back(pair.second.get());
+        }
+    } else {
+        mergeShards(snapshots);
+        flows.reserve(mergedMap.size());
+        for (auto const& pair : mergedMap) {
+            flows.push_back(pair.second);
+        }
+    }
+    filterFlows(&flows);
+    auto* displayedTotalFlow = buildTotalFlow(flows, snapshots);
+
+    // Only the rows up to the end of the window need to be sorted, the
+    // first one is the total
+    size_t totalRows = std::min<size_t>(flows.size(), std::max(displayConf.getMaxResults(), 0)) + 1;
+    size_t start = std::min<size_t>(std::max(firstRow, 0), totalRows);
+    size_t end = std::min<size_t>(start + std::max(numRows, 0), totalRows);
+    if (end > 1) {
+        sortFlows(&flows, end - 1);
+    }
+
+    std::vector<Flow const*> windowFlows;
+    windowFlows.reserve(end - start);
+    auto const& subfields = flowFormatter.getSubFields();
+    for (size_t row = start; row < end; ++row) {
+        if (row == 0) {
+            windowFlows.push_back(displayedTotalFlow);
+            continue;
         }
+        auto* flow = flows[row - 1];
+        flow->prepareSubfields(subfields);
+        windowFlows.push_back(flow);
+    }
 
-        auto const& subfields = flowFormatter.getSubFields();
-        pair.second->prepareSubfields(subfields);
+    auto bodyLines = flowFormatter.outputFlow(windowFlows, duration, displayConf);
+    return CollectorOutput(toString(), headers, bodyLines, start, totalRows);
+}
 
-        tempVector.push_back(pair.second);
+auto Collector::filterFlows(std::vector<Flow*>* flows) const -> void
+{
+    auto const& filter = displayConf.getFilter();
+    if (filter.empty()) {
+        return;
     }
+    flows->erase(std::remove_if(flows->begin(), flows->end(),
+                     [&filter](Flow const* flow) { return flow->getFqdn().find(filter) == std::string::npos; }),
+        flows->end());
+}
 
-    SPDLOG_INFO("Got {} {} flows", tempVector.size(), toString());
-    // TODO Merge percentiles?
+/**
+ * Only keep the limit first flows in sort order
+ */
+auto Collector::sortFlows(std::vector<Flow*>* flows, size_t limit) const -> void
+{
     auto sortFun = getSortFun(selectedSortField);
-    std::sort(tempVector.begin(), tempVector.end(),
-        [&](Flow const* left, Flow const* right) {
-            if (left == nullptr || right == nullptr) {
-                return false;
-            }
-            if (reversedSort) {
-                return sortFun(right, left);
-            } else {
-                return sortFun(left, right);
-            }
-        });
-    return tempVector;
+    auto comp = [&](Flow const* left, Flow const* right) {
+        if (reversedSort) {
+            return sortFun(right, left);
+        }
+        return sortFun(left, right);
+    };
+    if (limit < flows->size()) {
+        std::partial_sort(flows->begin(), flows->begin() + limit, flows->end(), comp);
+        flows->resize(limit);
+    } else {
+        std::sort(flows->begin(), flows->end(), comp);
+    }
+}
+
+auto Collector::getAggregatedFlows(size_t limit) const -> std::vector<Flow const*>
+{
+    std::vector<Flow*> flows;
+    flows.reserve(aggregatedMap.size());
+    for (auto const& pair : aggregatedMap) {
+        flows.push_back(pair.second);
+    }
+    filterFlows(&flows);
+    SPDLOG_INFO("Got {} {} flows", flows.size(), toString());
+    sortFlows(&flows, limit);
+
+    auto const& subfields = flowFormatter.getSubFields();
+    for (auto* flow : flows) {
+        flow->prepareSubfields(subfields);
+    }
+    return { flows.begin(), flows.end() };
 }
 
 Collector::~Collector()
 {
     delete totalFlow;
+    delete mergedTotalFlow;
     for (auto const& pair : aggregatedMap) {
         delete pair.second;
     }
+    for (auto const& pair : mergedMap) {
+        delete pair.second;
+    }
 }
 
 } // namespace flowstats
@@ -8,8 +8,9 @@
 #include "FlowFormatter.hpp"
 #include "Utils.hpp"
 #include <fmt/format.h>
+#include <limits>
 #include <map>
-#include <mutex>
+#include <memory>
 #include <sys/time.h>
 
 namespace flowstats {
@@ -20,6 +21,17 @@ BETTER_ENUM(CollectorProtocol, char,
     DNS,
     SSL);
 
+/**
+ * Copy of the aggregated flows handed to the screen thread. Flows that
+ * didn't change since the previous snapshot are shared with it. Once the
+ * screen thread releases a snapshot, its storage and its flow copies are
+ * reused by the next ones.
+ */
+struct CollectorSnapshot {
+    std::vector<std::pair<AggregatedKey, std::shared_ptr<Flow>>> flows;
+    std::shared_ptr<Flow> totalFlow;
+};
+
 class Collector {
 public:
     Collector(FlowstatsConfiguration const& conf, DisplayConfiguration const& displayConf)
@@ -27,15 +39,18 @@ public:
         , displayConf(displayConf) {};
     virtual ~Collector();
 
-    virtual auto processPacket(Tins::Packet const& pdu,
-        FlowId const& flowId,
-        Tins::IP const* ip,
-        Tins::IPv6 const* ipv6,
-        Tins::TCP const* tcp,
-        Tins::UDP const* udp) -> void
+    virtual auto processPacket(PacketView const& packet,
+        FlowId const& flowId) -> void
         = 0;
     virtual auto advanceTick(timeval now) -> void {};
     auto resetMetrics() -> void;
+    /**
+     * Called from the packet thread, make the current flows visible to
+     * outputStatus
+     */
+    auto publishSnapshot() -> void;
+    [[nodiscard]] auto getSnapshot() const -> std::shared_ptr<CollectorSnapshot const> { return std::atomic_load(&snapshot); };
+    auto addShard(Collector* shard) -> void { shards.push_back(shard); };
 
     auto mergePercentiles() -> void;
 
@@ -45,9 +60,15 @@ public:
     [[nodiscard]] auto getDisplayFieldValues() const { return displayFieldValues; };
     [[nodiscard]] auto getSortFields() const { return sortFields; };
     typedef bool (*sortFlowFun)(Flow const*, Flow const*);
+    typedef std::unordered_map<AggregatedKey, Flow*, std::hash<AggregatedKey>> AggregatedMap;
     [[nodiscard]] virtual auto getSortFun(Field field) const -> sortFlowFun;
 
-    [[nodiscard]] auto outputStatus(time_t duration) -> CollectorOutput;
+    /**
+     * Format numRows rows of the last published snapshot starting at
+     * firstRow, the first row being the total
+     */
+    [[nodiscard]] auto outputStatus(time_t duration, int firstRow = 0,
+        int numRows = std::numeric_limits<int>::max()) -> CollectorOutput;
 
     auto updateDisplayType(int displayIndex) -> void { flowFormatter.setDisplayValues(displayFieldValues[displayIndex]); };
 
@@ -63,27 +84,33 @@ public:
         reversedSort = reversed;
     };
 
-    [[nodiscard]] auto getAggregatedMap() const { return aggregatedMap; }
-    [[nodiscard]] auto getAggregatedMap() { return &aggregatedMap; }
-    [[nodiscard]] auto getAggregatedFlows() const -> std::vector<Flow const*>;
+    [[nodiscard]] auto getAggregatedMap() const -> AggregatedMap const& { return aggregatedMap; }
+    [[nodiscard]] auto getAggregatedMap() -> AggregatedMap* { return &aggregatedMap; }
+    /**
+     * The limit first aggregated flows in sort order
+     */
+    [[nodiscard]] auto getAggregatedFlows(size_t limit = std::numeric_limits<size_t>::max()) const -> std::vector<Flow const*>;
 
     [[nodiscard]] auto getFlowFormatterPtr() -> FlowFormatter* { return &flowFormatter; };
     [[nodiscard]] auto getFlowFormatter() -> FlowFormatter& { return flowFormatter; };
     [[nodiscard]] auto getFlowFormatter() const -> FlowFormatter const& { return flowFormatter; };
 
 protected:
-    auto buildTotalFlow(std::vector<Flow const*> const& aggregatedFlows) -> void;
+    typedef std::vector<std::shared_ptr<CollectorSnapshot const>> SnapshotList;
+    auto buildTotalFlow(std::vector<Flow*> const& aggregatedFlows, SnapshotList const& snapshots) -> Flow*;
+    auto mergeShards(SnapshotList const& snapshots) -> void;
+    auto filterFlows(std::vector<Flow*>* flows) const -> void;
+    auto sortFlows(std::vector<Flow*>* flows, size_t limit) const -> void;
 
-    [[nodiscard]] auto getDataMutex() -> std::mutex* { return &dataMutex; };
     [[nodiscard]] auto getDisplayConf() const -> DisplayConfiguration const& { return displayConf; };
     [[nodiscard]] auto getFlowstatsConfiguration() const -> FlowstatsConfiguration const& { return conf; };
 
     auto setDisplayPairs(std::vector<DisplayFieldValues> pairs) -> void { displayFieldValues = std::move(pairs); };
     auto fillSortFields() -> void;
     auto setTotalFlow(Flow* flow) -> void { totalFlow = flow; };
+    [[nodiscard]] auto getTotalFlow() -> Flow* { return totalFlow; };
 
 private:
-    std::mutex dataMutex;
     FlowFormatter flowFormatter;
     FlowstatsConfiguration const& conf;
     DisplayConfiguration const& displayConf;
@@ -92,6 +119,25 @@ private:
     std::vector<Field> sortFields;
     Field selectedSortField = Field::FQDN;
     bool reversedSort = false;
-    std::unordered_map<AggregatedKey, Flow*, std::hash<AggregatedKey>> aggregatedMap;
+    AggregatedMap aggregatedMap;
+
+    // Only accessed through std::atomic_load and std::atomic_store
+    std::shared_ptr<CollectorSnapshot const> snapshot;
+    struct PublishedFlow {
+        // Copy in the last snapshot, reused while the flow doesn't change
+        std::shared_ptr<Flow> current;
+        // Copy of the snapshot before, overwritten once no snapshot uses it
+        std::shared_ptr<Flow> spare;
+    };
+    // Kept across snapshots, aggregated flows are never removed
+    std::unordered_map<Flow const*, PublishedFlow> publishedFlows;
+    std::shared_ptr<CollectorSnapshot> publishedSnapshot;
+    std::shared_ptr<CollectorSnapshot> spareSnapshot;
+
+    // Collectors of the other capture workers, merged at display time
+    std::vector<Collector*> shards;
+    AggregatedMap mergedMap;
+    // Total of the shards or of the filtered flows
+    Flow* mergedTotalFlow = nullptr;
 };
 } // namespace flowstats
@@ -1,8 +1,10 @@
 #include "DnsStatsCollector.hpp"
-#include "PduUtils.hpp"
+#include "DomainRollup.hpp"
 #include "PrintHelper.hpp"
-#include <tins/memory_helpers.h>
-#include <tins/rawpdu.h>
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <cstring>
 
 namespace flowstats {
 
@@ -11,12 +13,20 @@ DnsStatsCollector::DnsStatsCollector(FlowstatsConfiguration const& conf,
     IpToFqdn* ipToFqdn)
     : Collector { conf, displayConf }
     , ipToFqdn(ipToFqdn)
+    , pendingQueries(conf.getMaxFlows())
+    , tcpReassembler(DNS_TCP_MAX_STREAMS)
+    , otherFqdnId(internFqdn("Other"))
 {
-    getFlowFormatter().setDisplayKeys({ Field::FQDN, Field::IP, Field::PORT, Field::PROTO, Field::TYPE, Field::DIR });
+    if (conf.getDnsPerResolver()) {
+        getFlowFormatter().setDisplayKeys({ Field::IP, Field::PORT, Field::PROTO, Field::FQDN, Field::DIR });
+    } else {
+        getFlowFormatter().setDisplayKeys({ Field::FQDN, Field::IP, Field::PORT, Field::PROTO, Field::TYPE, Field::DIR });
+    }
     setDisplayPairs({
         DisplayFieldValues(DisplayRequests, { Field::REQ, Field::REQ_AVG, Field::TIMEOUTS, Field::TIMEOUTS_AVG }),
         DisplayFieldValues(DisplayResponses, { Field::SRT, Field::SRT_AVG, Field::SRT_P95, Field::SRT_TOTAL_P95, Field::SRT_P99, Field::SRT_TOTAL_P99 }),
         DisplayFieldValues(DisplayDnsResourceRecords, { Field::RR_A_RATE, Field::RR_AAAA_RATE, Field::RR_CNAME_RATE, Field::RR_OTHER_RATE }),
+        DisplayFieldValues(DisplayDnsResponseCodes, { Field::RCODE_NOERROR_RATE, Field::RCODE_SERVFAIL_RATE, Field::RCODE_NXDOMAIN_RATE, Field::RCODE_REFUSED_RATE, Field::RCODE_OTHER_RATE, Field::TIMEOUTS_RATE }),
         DisplayFieldValues(DisplayClients, { Field::TOP_CLIENT_IPS_IP, Field::TOP_CLIENT_IPS_PKTS, Field::TOP_CLIENT_IPS_BYTES, Field::TOP_CLIENT_IPS_REQUESTS }, true),
         DisplayFieldValues(DisplayTraffic, { Field::PKTS, Field::PKTS_RATE, Field::BYTES, Field::BYTES_RATE }),
     });
@@ -36,149 +46,214 @@ auto DnsStatsCollector::isDnsPort(uint16_t port) -> bool
     return false;
 }
 
-auto DnsStatsCollector::isPossibleDns(Tins::TCP const* tcp, Tins::UDP const* udp) -> bool
+auto DnsStatsCollector::isPossibleDns(PacketView const& packet) -> bool
 {
-    auto ports = getPorts(tcp, udp);
-    if (isDnsPort(ports[0])) {
+    if (isDnsPort(packet.getSrcPort())) {
         return true;
     }
-    if (isDnsPort(ports[1])) {
+    if (isDnsPort(packet.getDstPort())) {
         return true;
     }
 
     return false;
 }
 
-auto DnsStatsCollector::processPacket(Tins::Packet const& packet,
-    FlowId const& flowId,
-    Tins::IP const*,
-    Tins::IPv6 const*,
-    Tins::TCP const* tcp,
-    Tins::UDP const* udp) -> void
+auto DnsStatsCollector::processPacket(PacketView const& packet,
+    FlowId const& flowId) -> void
 {
-    auto const* pdu = packet.pdu();
-    if (pdu == nullptr) {
+    if (!isPossibleDns(packet)) {
         return;
     }
-    if (!isPossibleDns(tcp, udp)) {
+    if (packet.isTcp()) {
+        processTcpSegment(packet, flowId);
         return;
     }
-
-    auto const* rawPdu = pdu->find_pdu<Tins::RawPDU>();
-    if (rawPdu == nullptr) {
+    if (packet.getPayloadSize() == 0) {
         return;
     }
-    Tins::DNS dns;
-    if (tcp) {
-        auto const& payload = rawPdu->payload();
-        Tins::Memory::InputMemoryStream stream(&payload[0], static_cast<uint32_t>(payload.size()));
-        auto tcpSize = stream.read_be<uint16_t>();
-        if (tcpSize != stream.size()) {
-            return;
+    processMessage(packet, flowId, packet.getPayload(), packet.getPayloadSize());
+}
+
+auto DnsStatsCollector::processTcpSegment(PacketView const& packet,
+    FlowId const& flowId) -> void
+{
+    auto streamKey = DnsStreamKey(flowId, flowId.getDirection());
+    if (packet.getWirePayloadSize() > 0) {
+        auto const& messages = tcpReassembler.addSegment(streamKey, packet.getSeq(),
+            packet.getPayload(), packet.getPayloadSize(), packet.getWirePayloadSize(),
+            timevalInMs(packet.getTimestamp()));
+        for (auto const& tcpMessage : messages) {
+            SPDLOG_DEBUG("Found dns on tcp with size {}", tcpMessage.size);
+            processMessage(packet, flowId, tcpMessage.data, tcpMessage.size);
         }
-        SPDLOG_DEBUG("Found dns on tcp with size {}", tcpSize);
-        dns = Tins::DNS(stream.pointer(), static_cast<uint32_t>(stream.size()));
-    } else {
-        dns = rawPdu->to<Tins::DNS>();
     }
+    if (packet.hasFlags(Tins::TCP::RST)) {
+        tcpReassembler.closeStream(streamKey);
+        tcpReassembler.closeStream(DnsStreamKey(flowId, static_cast<Direction>(!flowId.getDirection())));
+    } else if (packet.hasFlags(Tins::TCP::FIN)) {
+        tcpReassembler.closeStream(streamKey);
+    }
+}
 
-    if (dns.type() == Tins::DNS::QUERY) {
-        newDnsQuery(packet, flowId, dns);
+auto DnsStatsCollector::processMessage(PacketView const& packet, FlowId const& flowId,
+    uint8_t const* data, uint32_t size) -> void
+{
+    DnsMessage message;
+    if (!message.parse(data, size)) {
+        return;
+    }
+    if (message.getNumQueries() == 0) {
+        SPDLOG_DEBUG("No queries in {}", message.getId());
+        return;
+    }
+    if (!message.isResponse()) {
+        newDnsQuery(packet, flowId, message);
         return;
     }
 
-    auto it = transactionIdToDnsFlow.find(dns.id());
-    if (it != transactionIdToDnsFlow.end()) {
-        DnsFlow* flow = &it->second;
-        newDnsResponse(packet, dns, flow);
+    auto key = DnsTransactionKey(flowId, message.getId(), message.getQname());
+    auto it = pendingQueries.find(key);
+    if (it != pendingQueries.end()) {
+        newDnsResponse(packet, message, key, &it->second);
     }
 }
 
-auto DnsStatsCollector::updateIpToFqdn(Tins::DNS const& dns, std::string const& fqdn) -> void
+auto DnsStatsCollector::updateIpToFqdn(DnsMessage const& message, std::string_view fqdn, timeval now) -> void
 {
-    auto answers = dns.answers();
-    std::vector<Tins::IPv4Address> ips;
-    std::vector<Tins::IPv6Address> ipv6;
-    for (auto const& answer : answers) {
-        if (answer.query_type() == Tins::DNS::A) {
-            ips.emplace_back(Tins::IPv4Address(answer.data()));
-        } else if (answer.query_type() == Tins::DNS::AAAA) {
-            ipv6.emplace_back(Tins::IPv6Address(answer.data()));
+    // Reused so responses don't allocate
+    answerIps.clear();
+    answerIpv6.clear();
+    uint32_t ttl = std::numeric_limits<uint32_t>::max();
+    for (size_t i = 0; i < message.getNumAddresses(); ++i) {
+        auto const& address = message.getAddress(i);
+        if (address.isV6) {
+            answerIpv6.emplace_back(address.data);
+        } else {
+            uint32_t ip;
+            memcpy(&ip, address.data, sizeof(ip));
+            answerIps.emplace_back(ip);
         }
+        ttl = std::min(ttl, address.ttl);
+    }
+    if (answerIps.empty() && answerIpv6.empty()) {
+        return;
     }
 
-    ipToFqdn->updateFqdn(fqdn, ips, ipv6);
+    ipToFqdn->updateFqdn(fqdn, answerIps, answerIpv6, ttl, now);
 }
 
-auto DnsStatsCollector::newDnsQuery(Tins::Packet const& packet, FlowId const& flowId, Tins::DNS const& dns) -> void
+auto DnsStatsCollector::newDnsQuery(PacketView const& packet, FlowId const& flowId, DnsMessage const& message) -> void
 {
-    auto queries = dns.queries();
-    if (queries.size() == 0) {
-        SPDLOG_DEBUG("No queries in {}", dns.id());
+    if (message.getQname().empty()) {
+        SPDLOG_DEBUG("Empty query in dns tid {}", message.getId());
         return;
     }
-    auto firstQuery = queries.at(0);
-    if (firstQuery.dname().empty()) {
-        SPDLOG_DEBUG("Empty query in dns tid {}", dns.id());
+    auto key = DnsTransactionKey(flowId, message.getId(), message.getQname());
+    auto res = pendingQueries.emplace(key, packet, flowId, message);
+    if (res.first == pendingQueries.end()) {
+        SPDLOG_DEBUG("Dns query table is full, ignoring tid {}", message.getId());
         return;
     }
-    DnsFlow flow(packet, flowId, dns);
-    transactionIdToDnsFlow[dns.id()] = std::move(flow);
+    // A retransmitted query keeps its timer, which is re-armed from the
+    // new start time when it fires
+    if (!res.second) {
+        res.first->second = DnsFlow(packet, flowId, message);
+        return;
+    }
+    queryTimeouts.schedule(key, timevalInMs(packet.getTimestamp()) + DNS_TIMEOUT_MS + 1);
 }
 
-auto DnsStatsCollector::newDnsResponse(Tins::Packet const& packet,
-    Tins::DNS const& dns, DnsFlow* flow) -> void
+auto DnsStatsCollector::newDnsResponse(PacketView const& packet,
+    DnsMessage const& message, DnsTransactionKey const& key, DnsFlow* flow) -> void
 {
-    flow->processDnsResponse(packet, dns);
+    flow->processDnsResponse(packet, message);
     addFlowToAggregation(flow);
-    updateIpToFqdn(dns, flow->getFqdn());
-    transactionIdToDnsFlow.erase(dns.id());
+    // The full name is only interned for the mappings of its addresses
+    updateIpToFqdn(message, flow->getQname(), packet.getTimestamp());
+    pendingQueries.erase(key);
+}
+
+auto DnsStatsCollector::getAggregationName(DnsFlow const* flow) const -> std::string_view
+{
+    auto const& conf = getFlowstatsConfiguration();
+    if (conf.getDnsRollupRegistered()) {
+        return registeredDomain(flow->getQname());
+    }
+    if (conf.getDnsRollupDepth() > 0) {
+        return domainSuffix(flow->getQname(), conf.getDnsRollupDepth());
+    }
+    return flow->getQname();
 }
 
 auto DnsStatsCollector::addFlowToAggregation(DnsFlow const* flow) -> void
 {
+    auto* aggregatedMap = getAggregatedMap();
+    bool canCreate = aggregatedMap->size() < getFlowstatsConfiguration().getDnsMaxKeys();
     auto dnsType = flow->getType();
-    auto fqdn = flow->getFqdn();
-    auto key = AggregatedKey::aggregatedDnsKey(fqdn, dnsType, flow->getTransport());
+    auto transport = flow->getTransport();
 
-    const std::lock_guard<std::mutex> lock(*getDataMutex());
-    auto* aggregatedMap = getAggregatedMap();
-    auto it = aggregatedMap->find(key);
+    FqdnId fqdnId = FQDN_NONE;
+    std::optional<AggregatedKey> key;
+    if (getFlowstatsConfiguration().getDnsPerResolver()) {
+        key = AggregatedKey(FQDN_NONE, flow->getSrvIp(), flow->getSrvPort(),
+            static_cast<Tins::DNS::QueryType>(0), transport);
+    } else {
+        // Past the limit, names are only looked up so new ones aren't interned
+        auto name = getAggregationName(flow);
+        auto id = canCreate ? std::optional<FqdnId>(internFqdn(name)) : fqdnTable().find(name);
+        if (id.has_value()) {
+            fqdnId = *id;
+            key = AggregatedKey::aggregatedDnsKey(fqdnId, dnsType, transport);
+        }
+    }
+
+    auto it = key.has_value() ? aggregatedMap->find(*key) : aggregatedMap->end();
+    if (it == aggregatedMap->end() && !canCreate) {
+        // New names share a single aggregation per transport
+        fqdnId = otherFqdnId;
+        dnsType = static_cast<Tins::DNS::QueryType>(0);
+        key = AggregatedKey::aggregatedDnsKey(fqdnId, dnsType, transport);
+        it = aggregatedMap->find(*key);
+    }
     DnsAggregatedFlow* aggregatedFlow;
     if (it == aggregatedMap->end()) {
-        SPDLOG_DEBUG("Create new dns aggregation for {} {} {}", fqdn,
-            dnsTypeToString(dnsType), flow->getTransport()._to_string());
-        aggregatedFlow = new DnsAggregatedFlow(flow->getFlowId(), fqdn, dnsType);
-        aggregatedMap->emplace(key, aggregatedFlow);
+        if (fqdnId == FQDN_NONE) {
+            // Resolvers are named after their address when it's known
+            fqdnId = ipToFqdn->getFlowFqdnId(flow->getSrvIp()).value_or(FQDN_UNKNOWN);
+        }
+        SPDLOG_DEBUG("Create new dns aggregation for {} {} {}", fqdnString(fqdnId),
+            dnsTypeToString(dnsType), transport._to_string());
+        aggregatedFlow = new DnsAggregatedFlow(flow->getFlowId(), fqdnId, dnsType);
+        aggregatedMap->emplace(*key, aggregatedFlow);
     } else {
         aggregatedFlow = dynamic_cast<DnsAggregatedFlow*>(it->second);
     }
     aggregatedFlow->addFlow(flow);
+    getTotalFlow()->addFlow(flow);
 }
 
 auto DnsStatsCollector::advanceTick(timeval now) -> void
 {
-    if (now.tv_sec <= lastTick) {
-        return;
-    }
-    SPDLOG_DEBUG("Advancing dns tick to {}s", now.tv_sec);
-    lastTick = now.tv_sec;
+    ipToFqdn->advanceTick(now);
+    tcpReassembler.advanceTick(timevalInMs(now));
 
     // Timeout ongoing dns queries
-    std::vector<uint16_t> toErase;
-    for (auto& pair : transactionIdToDnsFlow) {
-        DnsFlow& flow = pair.second;
-        time_t delta_time = now.tv_sec - flow.getStartTv().tv_sec;
-        SPDLOG_DEBUG("Flow {}, delta {}, hasResponse {}", flow.getFqdn(),
-            delta_time, flow.getHasResponse());
-        if (delta_time > 5) {
-            addFlowToAggregation(&flow);
-            toErase.push_back(pair.first);
+    auto nowMs = timevalInMs(now);
+    queryTimeouts.advance(nowMs, [&](DnsTransactionKey const& key) {
+        auto it = pendingQueries.find(key);
+        if (it == pendingQueries.end()) {
+            return;
         }
-    }
-    for (auto& key : toErase) {
-        transactionIdToDnsFlow.erase(key);
-    }
+        DnsFlow& flow = it->second;
+        auto deadlineMs = timevalInMs(flow.getStartTv()) + DNS_TIMEOUT_MS + 1;
+        if (deadlineMs > nowMs) {
+            queryTimeouts.schedule(key, deadlineMs);
+            return;
+        }
+        SPDLOG_DEBUG("Timeout dns query {}, tid {}", flow.getQname(), key.transactionId);
+        addFlowToAggregation(&flow);
+        pendingQueries.erase(key);
+    });
 }
 
 auto DnsStatsCollector::getSortFun(Field field) const -> sortFlowFun
@@ -236,6 +311,26 @@ auto DnsStatsCollector::getSortFun(Field field) const -> sortFlowFun
             return [](Flow const* a, Flow const* b) { return DnsAggregatedFlow::sortByResourceRecord(a, b, ResourceRecordType::PTR, true); };
         case Field::RR_OTHER_AVG:
             return [](Flow const* a, Flow const* b) { return DnsAggregatedFlow::sortByResourceRecord(a, b, ResourceRecordType::OTHER, true); };
+        case Field::RCODE_NOERROR_RATE:
+            return [](Flow const* a, Flow const* b) { return DnsAggregatedFlow::sortByResponseCode(a, b, ResponseCodeType::RCODE_NOERROR, false); };
+        case Field::RCODE_SERVFAIL_RATE:
+            return [](Flow const* a, Flow const* b) { return DnsAggregatedFlow::sortByResponseCode(a, b, ResponseCodeType::RCODE_SERVFAIL, false); };
+        case Field::RCODE_NXDOMAIN_RATE:
+            return [](Flow const* a, Flow const* b) { return DnsAggregatedFlow::sortByResponseCode(a, b, ResponseCodeType::RCODE_NXDOMAIN, false); };
+        case Field::RCODE_REFUSED_RATE:
+            return [](Flow const* a, Flow const* b) { return DnsAggregatedFlow::sortByResponseCode(a, b, ResponseCodeType::RCODE_REFUSED, false); };
+        case Field::RCODE_OTHER_RATE:
+            return [](Flow const* a, Flow const* b) { return DnsAggregatedFlow::sortByResponseCode(a, b, ResponseCodeType::RCODE_OTHER, false); };
+        case Field::RCODE_NOERROR_AVG:
+            return [](Flow const* a, Flow const* b) { return DnsAggregatedFlow::sortByResponseCode(a, b, ResponseCodeType::RCODE_NOERROR, true); };
+        case Field::RCODE_SERVFAIL_AVG:
+            return [](Flow const* a, Flow const* b) { return DnsAggregatedFlow::sortByResponseCode(a, b, ResponseCodeType::RCODE_SERVFAIL, true); };
+        case Field::RCODE_NXDOMAIN_AVG:
+            return [](Flow const* a, Flow const* b) { return DnsAggregatedFlow::sortByResponseCode(a, b, ResponseCodeType::RCODE_NXDOMAIN, true); };
+        case Field::RCODE_REFUSED_AVG:
+            return [](Flow const* a, Flow const* b) { return DnsAggregatedFlow::sortByResponseCode(a, b, ResponseCodeType::RCODE_REFUSED, true); };
+        case Field::RCODE_OTHER_AVG:
+            return [](Flow const* a, Flow const* b) { return DnsAggregatedFlow::sortByResponseCode(a, b, ResponseCodeType::RCODE_OTHER, true); };
         default:
             return nullptr;
     }
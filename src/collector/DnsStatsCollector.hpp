@@ -5,42 +5,65 @@
 #include "Configuration.hpp"
 #include "DnsAggregatedFlow.hpp"
 #include "DnsFlow.hpp"
+#include "DnsTcpReassembler.hpp"
+#include "FlatFlowTable.hpp"
 #include "IpToFqdn.hpp"
+#include "TimerWheel.hpp"
 #include "Utils.hpp"
 
 namespace flowstats {
 
+uint64_t const DNS_TIMEOUT_MS = 5000;
+// Tcp connections with a dns message split across segments
+uint32_t const DNS_TCP_MAX_STREAMS = 1 << 12;
+
 class DnsStatsCollector : public Collector {
 public:
     DnsStatsCollector(FlowstatsConfiguration const& conf,
         DisplayConfiguration const& displayConf,
         IpToFqdn* ipToFqdn);
 
-    auto processPacket(Tins::Packet const& packet,
-        FlowId const& flowId,
-        Tins::IP const* ip,
-        Tins::IPv6 const* ipv6,
-        Tins::TCP const* tcp,
-        Tins::UDP const* udp) -> void override;
+    auto processPacket(PacketView const& packet,
+        FlowId const& flowId) -> void override;
     auto advanceTick(timeval now) -> void override;
 
     [[nodiscard]] auto toString() const -> std::string override { return "DnsStatsCollector"; }
     [[nodiscard]] auto getProtocol() const -> CollectorProtocol override { return CollectorProtocol::DNS; };
 
+    [[nodiscard]] auto getNumPendingQueries() const -> size_t { return pendingQueries.size(); }
+    [[nodiscard]] auto getNumTcpStreams() const -> size_t { return tcpReassembler.getNumStreams(); }
+
 private:
     auto isDnsPort(uint16_t port) -> bool;
-    auto isPossibleDns(Tins::TCP const* tcp, Tins::UDP const* udp) -> bool;
+    auto isPossibleDns(PacketView const& packet) -> bool;
 
-    auto newDnsQuery(Tins::Packet const& packet,
+    auto processTcpSegment(PacketView const& packet, FlowId const& flowId) -> void;
+    auto processMessage(PacketView const& packet, FlowId const& flowId,
+        uint8_t const* data, uint32_t size) -> void;
+    auto newDnsQuery(PacketView const& packet,
         FlowId const& flowId,
-        Tins::DNS const& dns) -> void;
-    auto newDnsResponse(Tins::Packet const& packet, Tins::DNS const& dns, DnsFlow* flow) -> void;
-    auto updateIpToFqdn(Tins::DNS const& dns, std::string const& fqdn) -> void;
+        DnsMessage const& message) -> void;
+    auto newDnsResponse(PacketView const& packet, DnsMessage const& message,
+        DnsTransactionKey const& key, DnsFlow* flow) -> void;
+    auto updateIpToFqdn(DnsMessage const& message, std::string_view fqdn, timeval now) -> void;
+    /**
+     * Name the flow is aggregated on, rolled up to its last labels or its
+     * registered domain when configured
+     */
+    [[nodiscard]] auto getAggregationName(DnsFlow const* flow) const -> std::string_view;
+    /**
+     * Aggregate the flow on its resolver in per resolver mode, on its
+     * name, type and transport otherwise
+     */
     auto addFlowToAggregation(DnsFlow const* flow) -> void;
     [[nodiscard]] auto getSortFun(Field field) const -> sortFlowFun override;
 
     IpToFqdn* ipToFqdn;
-    std::map<uint16_t, DnsFlow> transactionIdToDnsFlow;
-    time_t lastTick = 0;
+    FlatFlowTable<DnsTransactionKey, DnsFlow> pendingQueries;
+    TimerWheel<DnsTransactionKey> queryTimeouts;
+    DnsTcpReassembler tcpReassembler;
+    std::vector<Tins::IPv4Address> answerIps;
+    std::vector<Tins::IPv6Address> answerIpv6;
+    FqdnId otherFqdnId;
 };
 } // namespace flowstats
@@ -1,13 +1,12 @@
 #include "SslStatsCollector.hpp"
 #include "SslProto.hpp"
 #include <fmt/format.h>
-#include <tins/memory_helpers.h>
-#include <tins/rawpdu.h>
 
 namespace flowstats {
 
 SslStatsCollector::SslStatsCollector(FlowstatsConfiguration const& conf, DisplayConfiguration const& displayConf, IpToFqdn* ipToFqdn)
     : Collector { conf, displayConf }
+    , hashToSslFlow(conf.getMaxFlows())
     , ipToFqdn(ipToFqdn)
 {
     auto& flowFormatter = getFlowFormatter();
@@ -28,80 +27,92 @@ SslStatsCollector::SslStatsCollector(FlowstatsConfiguration const& conf, Display
     fillSortFields();
 };
 
-auto SslStatsCollector::lookupSslFlow(FlowId const& flowId) -> SslFlow*
+auto SslStatsCollector::lookupSslFlow(PacketView const& packet, FlowId const& flowId) -> SslFlow*
 {
     auto it = hashToSslFlow.find(flowId);
     if (it != hashToSslFlow.end()) {
         return &it->second;
     }
 
-    auto fqdnOpt = ipToFqdn->getFlowFqdn(flowId.getIp(!flowId.getDirection()));
-    if (!fqdnOpt.has_value()) {
+    auto fqdnId = ipToFqdn->getFlowFqdnId(flowId.getIp(!flowId.getDirection()));
+    if (!fqdnId.has_value()) {
         return nullptr;
     }
 
-    auto const* fqdn = fqdnOpt->data();
     // TODO dectect server port
-    auto aggregatedFlows = lookupAggregatedFlows(flowId, fqdn, FROM_SERVER);
+    auto aggregatedFlows = lookupAggregatedFlows(flowId, *fqdnId, FROM_SERVER);
+    auto res = hashToSslFlow.emplace(flowId, flowId, *fqdnId, aggregatedFlows);
+    if (res.first == hashToSslFlow.end()) {
+        SPDLOG_DEBUG("Ssl flow table is full, ignoring {}", flowId.toString());
+        return nullptr;
+    }
     SPDLOG_DEBUG("Create ssl flow {}", flowId.toString());
-    auto sslFlow = SslFlow(flowId, fqdn, aggregatedFlows);
-    auto res = hashToSslFlow.insert({ flowId, sslFlow });
+    auto nowMs = timevalInMs(packet.getTimestamp());
+    flowTimeouts.schedule(flowId, nowMs + getFlowstatsConfiguration().getTimeoutFlowMs() + 1);
     return &res.first->second;
 }
 
-auto SslStatsCollector::lookupAggregatedFlows(FlowId const& flowId, std::string const& fqdn, Direction srvDir) -> std::vector<SslAggregatedFlow*>
+auto SslStatsCollector::lookupAggregatedFlows(FlowId const& flowId, FqdnId fqdnId, Direction srvDir) -> SslAggregatedFlows
 {
-    std::vector<SslAggregatedFlow*> subflows;
     IPAddress ipSrvInt = {};
     if (getFlowstatsConfiguration().getPerIpAggr()) {
         ipSrvInt = flowId.getIp(srvDir);
     }
-    auto tcpKey = AggregatedKey(fqdn, ipSrvInt, flowId.getPort(srvDir));
+    auto tcpKey = AggregatedKey(fqdnId, ipSrvInt, flowId.getPort(srvDir));
     SslAggregatedFlow* aggregatedFlow;
 
     auto* aggregatedMap = getAggregatedMap();
     auto it = aggregatedMap->find(tcpKey);
     if (it == aggregatedMap->end()) {
-        aggregatedFlow = new SslAggregatedFlow(flowId, fqdn);
+        aggregatedFlow = new SslAggregatedFlow(flowId, fqdnId);
         aggregatedMap->insert({ tcpKey, aggregatedFlow });
     } else {
         aggregatedFlow = dynamic_cast<SslAggregatedFlow*>(it->second);
     }
-    subflows.push_back(aggregatedFlow);
-
-    return subflows;
+    // The total is updated with the aggregated flow
+    return { aggregatedFlow, static_cast<SslAggregatedFlow*>(getTotalFlow()) };
 }
 
-auto SslStatsCollector::processPacket(Tins::Packet const& packet,
-    FlowId const& flowId,
-    Tins::IP const*,
-    Tins::IPv6 const*,
-    Tins::TCP const* tcp,
-    Tins::UDP const*) -> void
+auto SslStatsCollector::processPacket(PacketView const& packet,
+    FlowId const& flowId) -> void
 {
-    if (tcp == nullptr) {
+    if (!packet.isTcp() || packet.getPayloadSize() == 0) {
         return;
     }
 
-    auto const* rawData = tcp->find_pdu<Tins::RawPDU>();
-    if (rawData == nullptr) {
-        return;
-    }
-    auto payload = rawData->payload();
-    auto cursor = Cursor(payload);
+    auto cursor = Cursor(packet.getPayload(), packet.getPayloadSize());
     auto mbTlsHeader = TlsHeader::parse(&cursor);
     if (!mbTlsHeader) {
         return;
     }
 
-    auto* sslFlow = lookupSslFlow(flowId);
+    auto* sslFlow = lookupSslFlow(packet, flowId);
     if (sslFlow == nullptr) {
         return;
     }
     auto direction = flowId.getDirection();
-    const std::lock_guard<std::mutex> lock(*getDataMutex());
     sslFlow->addPacket(packet, direction);
-    sslFlow->updateFlow(packet, *tcp);
+    sslFlow->updateFlow(packet);
+}
+
+auto SslStatsCollector::advanceTick(timeval now) -> void
+{
+    // Ssl flows have no close detection, drop the idle ones to keep room in
+    // the flow table
+    auto nowMs = timevalInMs(now);
+    auto timeoutMs = getFlowstatsConfiguration().getTimeoutFlowMs();
+    flowTimeouts.advance(nowMs, [&](FlowId const& flowId) {
+        auto it = hashToSslFlow.find(flowId);
+        if (it == hashToSslFlow.end()) {
+            return;
+        }
+        auto deadlineMs = timevalInMs(it->second.getEndTime()) + timeoutMs + 1;
+        if (deadlineMs > nowMs) {
+            flowTimeouts.schedule(flowId, deadlineMs);
+            return;
+        }
+        hashToSslFlow.erase(flowId);
+    });
 }
 
 auto SslStatsCollector::getSortFun(Field field) const -> sortFlowFun
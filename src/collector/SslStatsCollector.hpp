@@ -2,10 +2,12 @@
 
 #include "AggregatedKeys.hpp"
 #include "Collector.hpp"
+#include "FlatFlowTable.hpp"
 #include "IpToFqdn.hpp"
 #include "PrintHelper.hpp"
 #include "SslAggregatedFlow.hpp"
 #include "SslFlow.hpp"
+#include "TimerWheel.hpp"
 #include <algorithm>
 #include <arpa/inet.h>
 #include <iostream>
@@ -18,24 +20,21 @@ class SslStatsCollector : public Collector {
 public:
     SslStatsCollector(FlowstatsConfiguration const& conf, DisplayConfiguration const& displayConf, IpToFqdn* ipToFqdn);
 
-    auto processPacket(Tins::Packet const& packet,
-        FlowId const& flowId,
-        Tins::IP const* ip,
-        Tins::IPv6 const* ipv6,
-        Tins::TCP const* tcp,
-        Tins::UDP const* udp) -> void override;
+    auto processPacket(PacketView const& packet,
+        FlowId const& flowId) -> void override;
+    auto advanceTick(timeval now) -> void override;
 
     [[nodiscard]] auto getProtocol() const -> CollectorProtocol override { return CollectorProtocol::SSL; };
     [[nodiscard]] auto toString() const -> std::string override { return "SslStatsCollector"; }
 
-    [[nodiscard]] auto getSslFlow() const { return hashToSslFlow; }
-
+    [[nodiscard]] auto getSslFlow() const -> FlatFlowTable<FlowId, SslFlow> const& { return hashToSslFlow; }
 
 private:
-    std::unordered_map<FlowId, SslFlow, std::hash<FlowId>> hashToSslFlow;
+    FlatFlowTable<FlowId, SslFlow> hashToSslFlow;
+    TimerWheel<FlowId> flowTimeouts;
     [[nodiscard]] auto getSortFun(Field field) const -> sortFlowFun override;
-    auto lookupSslFlow(FlowId const& flowId) -> SslFlow*;
-    auto lookupAggregatedFlows(FlowId const& flowId, std::string const& fqdn, Direction srvDir) -> std::vector<SslAggregatedFlow*>;
+    auto lookupSslFlow(PacketView const& packet, FlowId const& flowId) -> SslFlow*;
+    auto lookupAggregatedFlows(FlowId const& flowId, FqdnId fqdnId, Direction srvDir) -> SslAggregatedFlows;
     IpToFqdn* ipToFqdn;
 };
 } // namespace flowstats
@@ -11,6 +11,7 @@ TcpStatsCollector::TcpStatsCollector(FlowstatsConfiguration const& conf,
     DisplayConfiguration const& displayConf,
     IpToFqdn* ipToFqdn)
     : Collector { conf, displayConf }
+    , hashToTcpFlow(conf.getMaxFlows())
     , ipToFqdn(ipToFqdn)
 {
     auto& flowFormatter = getFlowFormatter();
@@ -34,9 +35,9 @@ TcpStatsCollector::TcpStatsCollector(FlowstatsConfiguration const& conf,
     fillSortFields();
 };
 
-auto TcpStatsCollector::detectServer(Tins::TCP const& tcp, FlowId const& flowId) -> Direction
+auto TcpStatsCollector::detectServer(PacketView const& packet, FlowId const& flowId) -> Direction
 {
-    auto const flags = tcp.flags();
+    auto const flags = packet.getTcpFlags();
     auto direction = flowId.getDirection();
     if (flags & Tins::TCP::SYN) {
         if (flags & Tins::TCP::ACK) {
@@ -71,7 +72,7 @@ auto TcpStatsCollector::detectServer(Tins::TCP const& tcp, FlowId const& flowId)
     return static_cast<Direction>(!direction);
 }
 
-auto TcpStatsCollector::lookupTcpFlow(Tins::TCP const& tcp,
+auto TcpStatsCollector::lookupTcpFlow(PacketView const& packet,
     FlowId const& flowId) -> TcpFlow*
 {
     auto it = hashToTcpFlow.find(flowId);
@@ -79,27 +80,29 @@ auto TcpStatsCollector::lookupTcpFlow(Tins::TCP const& tcp,
         return &it->second;
     }
 
-    auto srvDir = detectServer(tcp, flowId);
-    std::optional<std::string> fqdnOpt = {};
+    auto srvDir = detectServer(packet, flowId);
     auto ipSrv = flowId.getIp(srvDir);
     SPDLOG_DEBUG("Detected srvDir {}, looking for fqdn of ip {}", srvDir, ipSrv.getAddrStr());
-    fqdnOpt = ipToFqdn->getFlowFqdn(ipSrv);
-
-    if (!fqdnOpt.has_value()) {
+    auto fqdnId = ipToFqdn->getFlowFqdnId(ipSrv);
+    if (!fqdnId.has_value()) {
         return nullptr;
     }
 
-    auto const* fqdn = fqdnOpt->data();
-    auto aggregatedTcpFlows = lookupAggregatedFlows(flowId, fqdn, srvDir);
-    auto tcpFlow = TcpFlow(flowId, srvDir, aggregatedTcpFlows);
-    SPDLOG_DEBUG("Create tcp flow {}, fqdn {}", flowId.toString(), fqdn);
-    auto res = hashToTcpFlow.emplace(flowId, tcpFlow);
+    auto aggregatedTcpFlows = lookupAggregatedFlows(flowId, *fqdnId, srvDir);
+    auto res = hashToTcpFlow.emplace(flowId, srvDir, aggregatedTcpFlows[0], packet.getTimestamp());
+    if (res.first == hashToTcpFlow.end()) {
+        SPDLOG_DEBUG("Tcp flow table is full, ignoring {}", flowId.toString());
+        return nullptr;
+    }
+    SPDLOG_DEBUG("Create tcp flow {}, fqdn {}", flowId.toString(), fqdnString(*fqdnId));
+    auto nowMs = timevalInMs(packet.getTimestamp());
+    flowTimeouts.schedule(flowId, nowMs + getFlowstatsConfiguration().getTimeoutFlowMs() + 1);
     return &res.first->second;
 }
 
 auto TcpStatsCollector::lookupAggregatedFlows(FlowId const& flowId,
-    std::string const& fqdn,
-    Direction srvDir) -> std::vector<TcpAggregatedFlow*>
+    FqdnId fqdnId,
+    Direction srvDir) -> TcpAggregatedFlows
 {
     IPAddress ipSrvInt = {};
     if (getFlowstatsConfiguration().getPerIpAggr()) {
@@ -107,87 +110,81 @@ auto TcpStatsCollector::lookupAggregatedFlows(FlowId const& flowId,
     }
     auto srvPort = flowId.getPort(srvDir);
     TcpAggregatedFlow* aggregatedFlow;
-    auto tcpKey = AggregatedKey(fqdn, ipSrvInt, srvPort);
-    const std::lock_guard<std::mutex> lock(*getDataMutex());
+    auto tcpKey = AggregatedKey(fqdnId, ipSrvInt, srvPort);
     auto* aggregatedMap = getAggregatedMap();
     auto it = aggregatedMap->find(tcpKey);
     if (it == aggregatedMap->end()) {
-        aggregatedFlow = new TcpAggregatedFlow(flowId, fqdn, srvDir);
+        aggregatedFlow = new TcpAggregatedFlow(flowId, fqdnId, srvDir);
         aggregatedMap->emplace(tcpKey, aggregatedFlow);
         SPDLOG_DEBUG("Create aggregated tcp flow for {}", flowId.toString());
     } else {
         aggregatedFlow = dynamic_cast<TcpAggregatedFlow*>(it->second);
     }
-    std::vector<TcpAggregatedFlow*> aggregatedFlows;
-    aggregatedFlows.push_back(aggregatedFlow);
-    return aggregatedFlows;
+    // The total is updated with the aggregated flow
+    auto* totalFlow = static_cast<TcpAggregatedFlow*>(getTotalFlow());
+    return { aggregatedFlow, totalFlow };
 }
 
-auto TcpStatsCollector::processPacket(Tins::Packet const& packet,
-    FlowId const& flowId,
-    Tins::IP const* ip,
-    Tins::IPv6 const* ipv6,
-    Tins::TCP const* tcp,
-    Tins::UDP const*) -> void
+auto TcpStatsCollector::processPacket(PacketView const& packet,
+    FlowId const& flowId) -> void
 {
-    if (tcp == nullptr) {
+    if (!packet.isTcp()) {
         return;
     }
 
-    auto* tcpFlow = lookupTcpFlow(*tcp, flowId);
+    auto* tcpFlow = lookupTcpFlow(packet, flowId);
     if (tcpFlow == nullptr) {
         return;
     }
 
-    const std::lock_guard<std::mutex> lock(*getDataMutex());
     auto direction = flowId.getDirection();
-    tcpFlow->addPacket(packet, direction);
-
-    for (auto* subflow : tcpFlow->getTcpAggregatedFlows()) {
+    auto aggregatedFlows = getFlowAggregations(*tcpFlow);
+    for (auto* subflow : aggregatedFlows) {
         subflow->addPacket(packet, direction);
-        subflow->updateFlow(packet, flowId, *tcp);
+        subflow->updateFlow(packet, flowId);
     }
 
-    tcpFlow->updateFlow(packet, direction, ip, ipv6, *tcp);
+    tcpFlow->updateFlow(packet, flowId, aggregatedFlows);
 }
 
-auto TcpStatsCollector::advanceTick(timeval now) -> void
+auto TcpStatsCollector::getFlowAggregations(TcpFlow const& flow) -> TcpAggregatedFlows
+{
+    return { flow.getAggregatedFlow(), static_cast<TcpAggregatedFlow*>(getTotalFlow()) };
+}
+
+/**
+ * A flow times out once one of its directions has been idle for longer
+ * than the flow timeout
+ */
+auto TcpStatsCollector::getFlowDeadlineMs(TcpFlow const& flow) const -> uint64_t
+{
+    return flow.getOldestPacketMs() + getFlowstatsConfiguration().getTimeoutFlowMs() + 1;
+}
+
+auto TcpStatsCollector::expireFlow(FlowId const& flowId, uint64_t nowMs) -> void
 {
-    if (now.tv_sec <= lastTick) {
+    auto it = hashToTcpFlow.find(flowId);
+    if (it == hashToTcpFlow.end()) {
         return;
     }
-    std::vector<FlowId> toTimeout;
-    lastTick = now.tv_sec;
-    SPDLOG_DEBUG("Advance tick to {}", now.tv_sec);
-    for (auto it : hashToTcpFlow) {
-        TcpFlow& flow = it.second;
-        auto lastPacketTime = flow.getLastPacketTime();
-        SPDLOG_DEBUG("Check flow {} for timeouts, now {}, lastPacketTime {} {}",
-            flow.getFlowId().toString(), now.tv_sec,
-            lastPacketTime[0].tv_sec, lastPacketTime[1].tv_sec);
-        if (lastPacketTime[FROM_CLIENT].tv_sec == 0
-            && lastPacketTime[FROM_SERVER].tv_sec == 0) {
-            continue;
-        }
-        std::array<uint32_t, 2> deltas = { 0, 0 };
-        for (int i = 0; i < 2; ++i) {
-            if (lastPacketTime[i].tv_sec > 0) {
-                deltas[i] = getTimevalDeltaS(lastPacketTime[i], now);
-            }
-        }
-        uint32_t maxDelta = std::max(deltas[0], deltas[1]);
-        SPDLOG_DEBUG("flow.{}, maxDelta: {}", flow.getFlowId().toString(), maxDelta);
-        auto timeoutFlow = getFlowstatsConfiguration().getTimeoutFlow();
-        if (maxDelta > timeoutFlow) {
-            SPDLOG_DEBUG("Timeout flow {}, now {}, maxDelta {} > {}",
-                flow.getFlowId().toString(), now.tv_sec, maxDelta, timeoutFlow);
-            toTimeout.push_back(it.first);
-            flow.timeoutFlow();
-        }
-    }
-    for (auto& i : toTimeout) {
-        hashToTcpFlow.erase(i);
+    auto& flow = it->second;
+    auto deadlineMs = getFlowDeadlineMs(flow);
+    if (deadlineMs > nowMs) {
+        flowTimeouts.schedule(flowId, deadlineMs);
+        return;
     }
+    SPDLOG_DEBUG("Timeout flow {}, now {}, deadline {}",
+        flowId.toString(), nowMs, deadlineMs);
+    flow.timeoutFlow(getFlowAggregations(flow));
+    hashToTcpFlow.erase(flowId);
+}
+
+auto TcpStatsCollector::advanceTick(timeval now) -> void
+{
+    auto nowMs = timevalInMs(now);
+    flowTimeouts.advance(nowMs, [this, nowMs](FlowId const& flowId) {
+        expireFlow(flowId, nowMs);
+    });
 }
 
 auto TcpStatsCollector::getSortFun(Field field) const -> sortFlowFun
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "Collector.hpp"
+#include "FlatFlowTable.hpp"
 #include "IpToFqdn.hpp"
 #include "TcpAggregatedFlow.hpp"
 #include "TcpFlow.hpp"
+#include "TimerWheel.hpp"
 
 namespace flowstats {
 
@@ -13,36 +15,34 @@ public:
         DisplayConfiguration const& displayConf,
         IpToFqdn* ipToFqdn);
 
-    auto processPacket(Tins::Packet const& packet,
-        FlowId const& flowId,
-        Tins::IP const* ip,
-        Tins::IPv6 const* ipv6,
-        Tins::TCP const* tcp,
-        Tins::UDP const* udp) -> void override;
+    auto processPacket(PacketView const& packet,
+        FlowId const& flowId) -> void override;
 
     auto advanceTick(timeval now) -> void override;
 
     [[nodiscard]] auto getProtocol() const -> CollectorProtocol override { return CollectorProtocol::TCP; };
     [[nodiscard]] auto toString() const -> std::string override { return "TcpStatsCollector"; }
 
-    [[nodiscard]] auto getTcpFlow() const { return hashToTcpFlow; }
+    [[nodiscard]] auto getTcpFlow() const -> FlatFlowTable<FlowId, TcpFlow> const& { return hashToTcpFlow; }
 
 private:
     typedef std::array<int, 65536> portArray;
-    std::unordered_map<FlowId, TcpFlow, std::hash<FlowId>> hashToTcpFlow;
+    FlatFlowTable<FlowId, TcpFlow> hashToTcpFlow;
+    TimerWheel<FlowId> flowTimeouts;
     portArray srvPortsCounter = {};
 
-    std::vector<std::pair<TcpFlow*, std::vector<TcpAggregatedFlow*>>> openingTcpFlow;
-    auto lookupTcpFlow(Tins::TCP const& tcpLayer,
+    auto lookupTcpFlow(PacketView const& packet,
         FlowId const& flowId) -> TcpFlow*;
-    auto lookupAggregatedFlows(FlowId const& flowId, std::string const& fqdn, Direction srvDir) -> std::vector<TcpAggregatedFlow*>;
-    [[nodiscard]] auto detectServer(Tins::TCP const& tcp, FlowId const& flowId) -> Direction;
+    auto lookupAggregatedFlows(FlowId const& flowId, FqdnId fqdnId, Direction srvDir) -> TcpAggregatedFlows;
+    auto getFlowAggregations(TcpFlow const& flow) -> TcpAggregatedFlows;
+    [[nodiscard]] auto detectServer(PacketView const& packet, FlowId const& flowId) -> Direction;
     [[nodiscard]] auto getSortFun(Field field) const -> sortFlowFun override;
+    [[nodiscard]] auto getFlowDeadlineMs(TcpFlow const& flow) const -> uint64_t;
+    auto expireFlow(FlowId const& flowId, uint64_t nowMs) -> void;
 
     void timeoutOpeningConnections(timeval now);
     void timeoutFlows(timeval now);
 
-    int lastTick = 0;
     IpToFqdn* ipToFqdn;
 };
 } // namespace flowstats
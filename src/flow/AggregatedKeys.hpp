@@ -3,31 +3,46 @@
 #include "Field.hpp"
 #include "Flow.hpp"
 #include "Stats.hpp"
+#include <tuple>
 #include <tins/dns.h>
 
 namespace flowstats {
 
 class AggregatedKey {
 public:
-    AggregatedKey(std::string fqdn,
+    AggregatedKey(FqdnId fqdnId,
         IPAddress const& address,
         Port port,
         Tins::DNS::QueryType dnsType = Tins::DNS::A,
         Transport transport = Transport::TCP)
-        : fqdn(std::move(fqdn))
+        : fqdnId(fqdnId)
         , address(address)
         , port(port)
         , dnsType(dnsType)
         , transport(transport) {};
 
-    static auto aggregatedIpTcpKey(std::string const& fqdn,
+    AggregatedKey(std::string_view fqdn,
+        IPAddress const& address,
+        Port port,
+        Tins::DNS::QueryType dnsType = Tins::DNS::A,
+        Transport transport = Transport::TCP)
+        : AggregatedKey(internFqdn(fqdn), address, port, dnsType, transport) {};
+
+    static auto aggregatedIpTcpKey(FqdnId fqdnId,
         IPAddress const& address,
         Port port)
     {
-        return AggregatedKey(fqdn, address, port);
+        return AggregatedKey(fqdnId, address, port);
     }
 
-    static auto aggregatedDnsKey(std::string const& fqdn,
+    static auto aggregatedDnsKey(FqdnId fqdnId,
+        Tins::DNS::QueryType dnsType,
+        Transport transport)
+    {
+        return AggregatedKey(fqdnId, {}, 0, dnsType, transport);
+    }
+
+    static auto aggregatedDnsKey(std::string_view fqdn,
         Tins::DNS::QueryType dnsType,
         Transport transport)
     {
@@ -38,16 +53,13 @@ public:
 
     auto operator<(AggregatedKey const& b) const -> bool
     {
-        return fqdn < b.fqdn
-            && address < b.address
-            && port < b.port
-            && dnsType < b.dnsType
-            && transport < b.transport;
+        return std::tie(fqdnId, address, port, dnsType, transport)
+            < std::tie(b.fqdnId, b.address, b.port, b.dnsType, b.transport);
     }
 
     auto operator==(AggregatedKey const& b) const -> bool
     {
-        return fqdn == b.fqdn
+        return fqdnId == b.fqdnId
             && address == b.address
             && port == b.port
             && dnsType == b.dnsType
@@ -56,15 +68,17 @@ public:
 
     [[nodiscard]] auto hash() const
     {
-        return std::hash<std::string>()(fqdn)
+        return std::hash<FqdnId>()(fqdnId)
             + std::hash<IPAddress>()(address)
             + std::hash<uint16_t>()(port)
             + std::hash<uint16_t>()(dnsType)
             + std::hash<uint16_t>()(transport);
     };
 
+    [[nodiscard]] auto getFqdnId() const { return fqdnId; };
+
 private:
-    std::string fqdn;
+    FqdnId fqdnId;
     IPAddress address;
     Port port;
     Tins::DNS::QueryType dnsType;
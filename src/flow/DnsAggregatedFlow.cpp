@@ -34,7 +34,7 @@ auto DnsAggregatedFlow::getSubfieldSize(Field field) const -> int
         case Field::TOP_CLIENT_IPS_BYTES:
         case Field::TOP_CLIENT_IPS_PKTS:
         case Field::TOP_CLIENT_IPS_REQUESTS:
-            return std::min(5, static_cast<int>(sourceIpToStats.size()));
+            return std::min(5, static_cast<int>(clientIpStats.size()));
         default:
             return 0;
     }
@@ -45,42 +45,14 @@ auto DnsAggregatedFlow::prepareSubfields(std::vector<Field> const& subfields) ->
 {
     for (auto field : subfields) {
         if (field == +Field::TOP_CLIENT_IPS_IP) {
-            computeTopClientIps(TrafficStatsDns::REQUESTS);
+            computeTopClientIps();
         }
     }
 }
 
-auto DnsAggregatedFlow::computeTopClientIps(TrafficStatsDns::TrafficType type) -> void
+auto DnsAggregatedFlow::computeTopClientIps() -> void
 {
-    int size = std::min(5, static_cast<int>(sourceIpToStats.size()));
-    topClientIps = std::vector<std::pair<IPAddress, TrafficStatsDns>>(size);
-
-    bool (*sortFun)(std::pair<IPAddress, TrafficStatsDns> const& l,
-        std::pair<IPAddress, TrafficStatsDns> const& r)
-        = nullptr;
-    switch (type) {
-        case TrafficStatsDns::PKTS:
-            sortFun = [](std::pair<IPAddress, TrafficStatsDns> const& l,
-                          std::pair<IPAddress, TrafficStatsDns> const& r) {
-                return l.second.pkts > r.second.pkts;
-            };
-            break;
-        case TrafficStatsDns::BYTES:
-            sortFun = [](std::pair<IPAddress, TrafficStatsDns> const& l,
-                          std::pair<IPAddress, TrafficStatsDns> const& r) {
-                return l.second.bytes > r.second.bytes;
-            };
-            break;
-        case TrafficStatsDns::REQUESTS:
-            sortFun = [](std::pair<IPAddress, TrafficStatsDns> const& l,
-                          std::pair<IPAddress, TrafficStatsDns> const& r) {
-                return l.second.requests > r.second.requests;
-            };
-            break;
-    }
-
-    std::partial_sort_copy(sourceIpToStats.begin(), sourceIpToStats.end(),
-        topClientIps.begin(), topClientIps.end(), sortFun);
+    topClientIps = clientIpStats.top(5);
 }
 
 auto DnsAggregatedFlow::getFieldStr(Field field, Direction direction, int duration, int index) const -> std::string
@@ -95,8 +67,7 @@ auto DnsAggregatedFlow::getFieldStr(Field field, Direction direction, int durati
         }
     }
 
-    auto fqdn = getFqdn();
-    if (fqdn == "Total") {
+    if (getFqdnId() == FQDN_TOTAL) {
         if (direction == FROM_CLIENT || direction == MERGED) {
             switch (field) {
                 case Field::IP:
@@ -111,7 +82,7 @@ auto DnsAggregatedFlow::getFieldStr(Field field, Direction direction, int durati
 
     if (direction == FROM_CLIENT || direction == MERGED) {
         switch (field) {
-            case Field::FQDN: return fqdn;
+            case Field::FQDN: return getFqdn();
             case Field::PROTO: return getTransport()._to_string();
             case Field::TYPE: return dnsTypeToString(dnsType);
             case Field::IP: return getSrvIp().getAddrStr();
@@ -154,6 +125,18 @@ auto DnsAggregatedFlow::getFieldStr(Field field, Direction direction, int durati
             case Field::RR_TXT_AVG: return prettyFormatNumber(totalResourceRecords.getResourceRecordCount(ResourceRecordType::TXT));
             case Field::RR_OTHER_AVG: return prettyFormatNumber(totalResourceRecords.getResourceRecordCount(ResourceRecordType::OTHER));
 
+            case Field::RCODE_NOERROR_RATE: return prettyFormatNumber(rcodes[ResponseCodeType::RCODE_NOERROR]);
+            case Field::RCODE_SERVFAIL_RATE: return prettyFormatNumber(rcodes[ResponseCodeType::RCODE_SERVFAIL]);
+            case Field::RCODE_NXDOMAIN_RATE: return prettyFormatNumber(rcodes[ResponseCodeType::RCODE_NXDOMAIN]);
+            case Field::RCODE_REFUSED_RATE: return prettyFormatNumber(rcodes[ResponseCodeType::RCODE_REFUSED]);
+            case Field::RCODE_OTHER_RATE: return prettyFormatNumber(rcodes[ResponseCodeType::RCODE_OTHER]);
+
+            case Field::RCODE_NOERROR_AVG: return prettyFormatNumberAverage(totalRcodes[ResponseCodeType::RCODE_NOERROR], duration);
+            case Field::RCODE_SERVFAIL_AVG: return prettyFormatNumberAverage(totalRcodes[ResponseCodeType::RCODE_SERVFAIL], duration);
+            case Field::RCODE_NXDOMAIN_AVG: return prettyFormatNumberAverage(totalRcodes[ResponseCodeType::RCODE_NXDOMAIN], duration);
+            case Field::RCODE_REFUSED_AVG: return prettyFormatNumberAverage(totalRcodes[ResponseCodeType::RCODE_REFUSED], duration);
+            case Field::RCODE_OTHER_AVG: return prettyFormatNumberAverage(totalRcodes[ResponseCodeType::RCODE_OTHER], duration);
+
             default:
                 break;
         }
@@ -171,7 +154,7 @@ auto DnsAggregatedFlow::addFlow(Flow const* flow) -> void
     resourceRecords.addResourceRecords(dnsFlow->getResourceRecords());
     timeouts += !dnsFlow->getHasResponse();
 
-    auto* stats = &sourceIpToStats[dnsFlow->getCltIp()];
+    auto* stats = clientIpStats.add(dnsFlow->getCltIp(), 1);
     auto cltPos = !flow->getSrvPos();
     stats->bytes += flow->getTotalBytes()[cltPos];
     stats->pkts += flow->getTotalPackets()[cltPos];
@@ -183,6 +166,9 @@ auto DnsAggregatedFlow::addFlow(Flow const* flow) -> void
     if (dnsFlow->getHasResponse()) {
         totalTruncated += dnsFlow->getTruncated();
         totalResourceRecords.addResourceRecords(dnsFlow->getResourceRecords());
+        auto rcode = toResponseCodeType(dnsFlow->getResponseCode());
+        rcodes[rcode]++;
+        totalRcodes[rcode]++;
         srts.addPoint(dnsFlow->getDeltaTv());
         totalSrts.addPoint(dnsFlow->getDeltaTv());
         totalNumSrt++;
@@ -194,26 +180,25 @@ auto DnsAggregatedFlow::addAggregatedFlow(Flow const* flow) -> void
 {
     Flow::addFlow(flow);
 
-    auto const* dnsFlow = dynamic_cast<const DnsAggregatedFlow*>(flow);
+    auto const* dnsFlow = static_cast<const DnsAggregatedFlow*>(flow);
     queries += dnsFlow->queries;
     truncated += dnsFlow->truncated;
     resourceRecords.addResourceRecords(dnsFlow->resourceRecords);
     timeouts += dnsFlow->timeouts;
 
-    for (auto const& sourceIt : dnsFlow->sourceIpToStats) {
-        auto* stats = &sourceIpToStats[sourceIt.first];
-        stats->bytes += sourceIt.second.bytes;
-        stats->pkts += sourceIt.second.pkts;
-        stats->requests += sourceIt.second.requests;
-    }
+    clientIpStats.merge(dnsFlow->clientIpStats);
 
     totalQueries += dnsFlow->totalQueries;
     totalTimeouts += dnsFlow->totalTimeouts;
     totalResponses += dnsFlow->totalResponses;
     totalTruncated += dnsFlow->totalTruncated;
     totalResourceRecords.addResourceRecords(dnsFlow->totalResourceRecords);
+    for (size_t i = 0; i < rcodes.size(); ++i) {
+        rcodes[i] += dnsFlow->rcodes[i];
+        totalRcodes[i] += dnsFlow->totalRcodes[i];
+    }
     srts.addPoints(dnsFlow->srts);
-    totalSrts.addPoints(dnsFlow->srts);
+    totalSrts.addPoints(dnsFlow->totalSrts);
     totalNumSrt += dnsFlow->totalNumSrt;
     numSrt += dnsFlow->numSrt;
 }
@@ -227,14 +212,16 @@ void DnsAggregatedFlow::resetFlow(bool resetTotal)
     truncated = 0;
     numSrt = 0;
     resourceRecords = {};
+    rcodes = {};
 
     if (resetTotal) {
         totalSrts.reset();
-        sourceIpToStats.clear();
+        clientIpStats.clear();
         totalQueries = 0;
         totalTimeouts = 0;
         totalTruncated = 0;
         totalResourceRecords = ResourceRecords();
+        totalRcodes = {};
         totalNumSrt = 0;
     }
 }
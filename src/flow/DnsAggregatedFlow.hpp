@@ -1,6 +1,7 @@
 #pragma once
 
 #include "DnsFlow.hpp"
+#include "HeavyHitters.hpp"
 #include "Stats.hpp"
 #include <map>
 #include <string>
@@ -18,24 +19,38 @@ public:
         PKTS,
         REQUESTS,
     };
+
+    auto operator+=(TrafficStatsDns const& other) -> TrafficStatsDns&
+    {
+        bytes += other.bytes;
+        pkts += other.pkts;
+        requests += other.requests;
+        return *this;
+    }
 };
 
 struct DnsAggregatedFlow : Flow {
 
     DnsAggregatedFlow()
-        : Flow("Total") {};
+        : Flow(FQDN_TOTAL) {};
 
-    DnsAggregatedFlow(FlowId const& flowId, std::string const& fqdn,
+    DnsAggregatedFlow(FlowId const& flowId, FqdnId fqdnId,
         enum Tins::DNS::QueryType dnsType)
-        : Flow(flowId, fqdn)
+        : Flow(flowId, fqdnId)
         , dnsType(dnsType) {};
 
     auto resetFlow(bool resetTotal) -> void override;
     auto operator<(DnsAggregatedFlow const& b) { return queries < b.queries; }
     auto addFlow(Flow const* flow) -> void override;
     auto addAggregatedFlow(Flow const* flow) -> void override;
-    auto mergePercentiles() -> void override { srts.merge(); }
+    auto mergePercentiles() -> void override
+    {
+        srts.merge();
+        totalSrts.merge();
+    }
     auto prepareSubfields(std::vector<Field> const& fields) -> void override;
+    [[nodiscard]] auto clone() const -> Flow* override { return new DnsAggregatedFlow(*this); };
+    auto copyTo(Flow* dst) const -> void override { *static_cast<DnsAggregatedFlow*>(dst) = *this; };
 
     [[nodiscard]] auto getFieldStr(Field field, Direction direction, int duration, int index) const -> std::string override;
     [[nodiscard]] auto getSubfieldSize(Field field) const -> int override;
@@ -115,8 +130,17 @@ struct DnsAggregatedFlow : Flow {
         return aResourceRecords.getResourceRecordCount(rrType) < bResourceRecords.getResourceRecordCount(rrType);
     }
 
+    [[nodiscard]] static auto sortByResponseCode(Flow const* a, Flow const* b, ResponseCodeType rcode, bool total) -> bool
+    {
+        auto const* aCast = static_cast<DnsAggregatedFlow const*>(a);
+        auto const* bCast = static_cast<DnsAggregatedFlow const*>(b);
+        auto const& aRcodes = total ? aCast->totalRcodes : aCast->rcodes;
+        auto const& bRcodes = total ? bCast->totalRcodes : bCast->rcodes;
+        return aRcodes[rcode] < bRcodes[rcode];
+    }
+
 private:
-    auto computeTopClientIps(TrafficStatsDns::TrafficType type) -> void;
+    auto computeTopClientIps() -> void;
     [[nodiscard]] auto getTopClientIpsKey(int index) const -> std::string;
     [[nodiscard]] auto getTopClientIpsValue(TrafficStatsDns::TrafficType type, int index) const -> std::string;
     std::vector<std::pair<IPAddress, TrafficStatsDns>> topClientIps;
@@ -128,15 +152,18 @@ private:
     int totalTruncated = 0;
     int totalTimeouts = 0;
     ResourceRecords totalResourceRecords;
+    std::array<int, ResponseCodeType::_size()> totalRcodes = {};
 
     int queries = 0;
     int timeouts = 0;
     int truncated = 0;
     ResourceRecords resourceRecords;
+    std::array<int, ResponseCodeType::_size()> rcodes = {};
 
     int numSrt = 0;
     int totalNumSrt = 0;
-    std::map<IPAddress, TrafficStatsDns> sourceIpToStats;
+    // Clients ranked by requests
+    HeavyHitters<IPAddress, TrafficStatsDns, 32> clientIpStats;
 
     Percentile srts;
     Percentile totalSrts;
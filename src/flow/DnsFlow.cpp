@@ -1,56 +1,40 @@
 #include "DnsFlow.hpp"
+#include <algorithm>
+#include <cctype>
 
 namespace flowstats {
 
-DnsFlow::DnsFlow(Tins::Packet const& packet, FlowId const& flowId,
-    Tins::DNS const& dns)
+DnsFlow::DnsFlow(PacketView const& packet, FlowId const& flowId,
+    DnsMessage const& message)
     : Flow(flowId)
 {
     addPacket(packet, FROM_CLIENT);
-    startTv = packetToTimeval(packet);
-    auto queries = dns.queries();
-    auto firstQuery = queries.at(0);
-    type = firstQuery.query_type();
-    fqdn = firstQuery.dname();
+    startTv = packet.getTimestamp();
+    type = message.getQueryType();
+    // Only interned once aggregated, most names are never seen again
+    auto name = message.getQname();
+    std::copy(name.begin(), name.end(), qname.begin());
+    qnameSize = name.size();
     hasResponse = false;
 }
 
-auto DnsFlow::processDnsResponse(Tins::Packet const& packet,
-    Tins::DNS const& dns) -> void
+auto DnsFlow::processDnsResponse(PacketView const& packet,
+    DnsMessage const& message) -> void
 {
     addPacket(packet, FROM_SERVER);
-    endTv = packetToTimeval(packet);
+    endTv = packet.getTimestamp();
     hasResponse = true;
-    resourceRecords.addResourceRecords(dns);
-    truncated = dns.truncated();
-    responseCode = dns.rcode();
-    SPDLOG_DEBUG("Dns tid {}, {} finished, {}", dns.id(),
-        getTransport()._to_string(), fqdn);
+    resourceRecords.addResourceRecords(message);
+    truncated = message.getTruncated();
+    responseCode = message.getRcode();
+    SPDLOG_DEBUG("Dns tid {}, {} finished, {}", message.getId(),
+        getTransport()._to_string(), getQname());
 }
 
-auto ResourceRecords::addResourceRecords(Tins::DNS const& dns) -> void
+auto ResourceRecords::addResourceRecords(DnsMessage const& message) -> void
 {
-    for (auto rr : dns.answers()) {
-        switch (rr.query_type()) {
-            case Tins::DNS::A:
-                resourceRecords[ResourceRecordType::A]++;
-                break;
-            case Tins::DNS::AAAA:
-                resourceRecords[ResourceRecordType::AAAA]++;
-                break;
-            case Tins::DNS::CNAME:
-                resourceRecords[ResourceRecordType::CNAME]++;
-                break;
-            case Tins::DNS::PTR:
-                resourceRecords[ResourceRecordType::PTR]++;
-                break;
-            case Tins::DNS::TXT:
-                resourceRecords[ResourceRecordType::TXT]++;
-                break;
-            default:
-                resourceRecords[ResourceRecordType::OTHER]++;
-                break;
-        }
+    for (auto rrType : ResourceRecordType::_values()) {
+        resourceRecords[rrType] += message.getAnswerCount(rrType);
     }
 }
 
@@ -60,6 +44,19 @@ auto ResourceRecords::addResourceRecords(ResourceRecords const& rr) -> void {
     }
 };
 
+DnsTransactionKey::DnsTransactionKey(FlowId const& flowId, uint16_t transactionId, std::string_view qname)
+    : flowId(flowId)
+    , transactionId(transactionId)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261U;
+    for (auto c : qname) {
+        hash ^= static_cast<uint8_t>(std::tolower(static_cast<unsigned char>(c)));
+        hash *= 16777619U;
+    }
+    qnameHash = hash;
+}
+
 auto dnsTypeToString(Tins::DNS::QueryType dnsType) -> std::string
 {
 #define ENUM_TEXT(p)                \
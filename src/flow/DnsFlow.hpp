@@ -1,19 +1,16 @@
 #pragma once
 
+#include "DnsParser.hpp"
 #include "Flow.hpp"
-#include <enum.h>
-#include <tins/dns.h>
 
 namespace flowstats {
 
-BETTER_ENUM(ResourceRecordType, uint8_t, A, AAAA, CNAME, PTR, TXT, OTHER);
-
 class ResourceRecords {
 public:
     ResourceRecords() = default;
     [[nodiscard]] auto& getResourceRecords() const { return resourceRecords; };
     [[nodiscard]] auto& getResourceRecordCount(ResourceRecordType rrType) const { return resourceRecords[rrType]; };
-    auto addResourceRecords(Tins::DNS const& dns) -> void;
+    auto addResourceRecords(DnsMessage const& message) -> void;
     auto addResourceRecords(ResourceRecords const& rr) -> void;
 
 private:
@@ -24,31 +21,67 @@ class DnsFlow : public Flow {
 
 public:
     DnsFlow() = default;
-    DnsFlow(const Tins::Packet& packet, FlowId const& flowId,
-        Tins::DNS const& dns);
+    DnsFlow(PacketView const& packet, FlowId const& flowId,
+        DnsMessage const& message);
 
-    auto processDnsResponse(Tins::Packet const& packet, Tins::DNS const& dns) -> void;
+    auto processDnsResponse(PacketView const& packet, DnsMessage const& message) -> void;
 
-    [[nodiscard]] auto getFqdn() const { return fqdn; };
     [[nodiscard]] auto getTruncated() const { return truncated; };
     [[nodiscard]] auto getHasResponse() const { return hasResponse; };
     [[nodiscard]] auto getType() const { return type; };
+    [[nodiscard]] auto getQname() const -> std::string_view { return { qname.data(), qnameSize }; };
     [[nodiscard]] auto getResponseCode() const { return responseCode; };
     [[nodiscard]] auto& getResourceRecords() const { return resourceRecords; };
     [[nodiscard]] auto getDeltaTv() const { return getTimevalDeltaMs(startTv, endTv); };
     [[nodiscard]] auto getStartTv() const { return startTv; };
 
 private:
-    std::string fqdn = "";
     bool hasResponse = false;
     bool truncated = false;
     enum Tins::DNS::QueryType type = Tins::DNS::A;
     ResourceRecords resourceRecords;
     uint8_t responseCode = 0;
+    std::array<char, DNS_MAX_NAME_SIZE> qname;
+    uint8_t qnameSize = 0;
 
     timeval startTv = {};
     timeval endTv = {};
 };
 
+/**
+ * Identify a pending query: transaction ids alone collide between the
+ * clients of a resolver. The flow id is normalised so the query and its
+ * response share the same key.
+ */
+struct DnsTransactionKey {
+    DnsTransactionKey() = default;
+    DnsTransactionKey(FlowId const& flowId, uint16_t transactionId, std::string_view qname);
+
+    FlowId flowId;
+    uint16_t transactionId = 0;
+    // Case insensitive, resolvers may randomize the case of the query
+    uint32_t qnameHash = 0;
+
+    auto operator==(DnsTransactionKey const& b) const -> bool
+    {
+        return transactionId == b.transactionId
+            && qnameHash == b.qnameHash
+            && flowId == b.flowId;
+    }
+};
+
 auto dnsTypeToString(Tins::DNS::QueryType queryType) -> std::string;
 } // namespace flowstats
+
+namespace std {
+
+template <>
+struct hash<flowstats::DnsTransactionKey> {
+    auto operator()(const flowstats::DnsTransactionKey& key) const -> size_t
+    {
+        auto id = (static_cast<uint64_t>(key.qnameHash) << 16) | key.transactionId;
+        return key.flowId.hash() ^ (id * 0x9e3779b97f4a7c15ULL);
+    }
+};
+
+} // namespace std
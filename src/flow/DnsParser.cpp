@@ -0,0 +1,182 @@
+#include "DnsParser.hpp"
+#include <algorithm>
+#include <cctype>
+
+namespace flowstats {
+
+namespace {
+
+    auto readBe16(uint8_t const* data) -> uint16_t
+    {
+        return static_cast<uint16_t>((data[0] << 8) | data[1]);
+    }
+
+    auto readBe32(uint8_t const* data) -> uint32_t
+    {
+        return (static_cast<uint32_t>(readBe16(data)) << 16) | readBe16(data + 2);
+    }
+
+    auto toResourceRecordType(uint16_t type) -> ResourceRecordType
+    {
+        switch (type) {
+            case Tins::DNS::A:
+                return ResourceRecordType::A;
+            case Tins::DNS::AAAA:
+                return ResourceRecordType::AAAA;
+            case Tins::DNS::CNAME:
+                return ResourceRecordType::CNAME;
+            case Tins::DNS::PTR:
+                return ResourceRecordType::PTR;
+            case Tins::DNS::TXT:
+                return ResourceRecordType::TXT;
+            default:
+                return ResourceRecordType::OTHER;
+        }
+    }
+
+    uint8_t const LABEL_POINTER = 0xc0;
+
+} // namespace
+
+auto toResponseCodeType(uint8_t rcode) -> ResponseCodeType
+{
+    switch (rcode) {
+        case 0:
+            return ResponseCodeType::RCODE_NOERROR;
+        case 2:
+            return ResponseCodeType::RCODE_SERVFAIL;
+        case 3:
+            return ResponseCodeType::RCODE_NXDOMAIN;
+        case 5:
+            return ResponseCodeType::RCODE_REFUSED;
+        default:
+            return ResponseCodeType::RCODE_OTHER;
+    }
+}
+
+auto DnsMessage::parse(uint8_t const* data, uint32_t size) -> bool
+{
+    if (size < DNS_HEADER_SIZE) {
+        return false;
+    }
+    id = readBe16(data);
+    flags = readBe16(data + 2);
+    numQueries = readBe16(data + 4);
+    numAnswers = readBe16(data + 6);
+    queryType = 0;
+    qnameSize = 0;
+    answerCounts = {};
+    numAddresses = 0;
+
+    uint32_t offset = DNS_HEADER_SIZE;
+    for (uint16_t i = 0; i < numQueries; ++i) {
+        offset = i == 0 ? readName(data, size, offset) : skipName(data, size, offset);
+        // Type and class
+        if (offset == 0 || offset + 4 > size) {
+            return false;
+        }
+        if (i == 0) {
+            queryType = readBe16(data + offset);
+        }
+        offset += 4;
+    }
+
+    if (!isResponse()) {
+        return true;
+    }
+    return parseAnswers(data, size, offset);
+}
+
+auto DnsMessage::parseAnswers(uint8_t const* data, uint32_t size, uint32_t offset) -> bool
+{
+    for (uint16_t i = 0; i < numAnswers; ++i) {
+        offset = skipName(data, size, offset);
+        // Type, class, ttl and rdata length
+        if (offset == 0 || offset + 10 > size) {
+            return false;
+        }
+        auto type = readBe16(data + offset);
+        auto ttl = readBe32(data + offset + 4);
+        auto rdataSize = readBe16(data + offset + 8);
+        offset += 10;
+        if (offset + rdataSize > size) {
+            return false;
+        }
+
+        auto rrType = toResourceRecordType(type);
+        answerCounts[rrType]++;
+        bool isAddress = (rrType == +ResourceRecordType::A && rdataSize == 4)
+            || (rrType == +ResourceRecordType::AAAA && rdataSize == 16);
+        if (isAddress && numAddresses < addresses.size()) {
+            addresses[numAddresses++] = { data + offset, rdataSize == 16, ttl };
+        }
+        offset += rdataSize;
+    }
+    return true;
+}
+
+auto DnsMessage::readName(uint8_t const* data, uint32_t size, uint32_t offset) -> uint32_t
+{
+    uint32_t end = 0;
+    uint32_t labelOffset = offset;
+    while (true) {
+        if (labelOffset >= size) {
+            return 0;
+        }
+        uint8_t length = data[labelOffset];
+        if (length == 0) {
+            break;
+        }
+        if ((length & LABEL_POINTER) == LABEL_POINTER) {
+            if (labelOffset + 2 > size) {
+                return 0;
+            }
+            uint32_t target = readBe16(data + labelOffset) & 0x3fff;
+            if (target >= labelOffset) {
+                return 0;
+            }
+            if (end == 0) {
+                end = labelOffset + 2;
+            }
+            labelOffset = target;
+            continue;
+        }
+        if ((length & LABEL_POINTER) != 0 || labelOffset + 1 + length > size) {
+            return 0;
+        }
+        uint32_t separator = qnameSize > 0;
+        if (qnameSize + separator + length > qname.size()) {
+            return 0;
+        }
+        if (separator) {
+            qname[qnameSize++] = '.';
+        }
+        // Names are case insensitive and resolvers may randomize the case
+        std::transform(data + labelOffset + 1, data + labelOffset + 1 + length, qname.data() + qnameSize,
+            [](uint8_t c) { return static_cast<char>(std::tolower(c)); });
+        qnameSize += length;
+        labelOffset += 1 + length;
+    }
+    return end != 0 ? end : labelOffset + 1;
+}
+
+auto DnsMessage::skipName(uint8_t const* data, uint32_t size, uint32_t offset) -> uint32_t
+{
+    while (offset < size) {
+        uint8_t length = data[offset];
+        if (length == 0) {
+            return offset + 1;
+        }
+        // A pointer ends the name
+        if ((length & LABEL_POINTER) == LABEL_POINTER) {
+            return offset + 2 <= size ? offset + 2 : 0;
+        }
+        if ((length & LABEL_POINTER) != 0) {
+            return 0;
+        }
+        offset += 1 + length;
+    }
+    return 0;
+}
+
+} // namespace flowstats
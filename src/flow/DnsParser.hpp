@@ -0,0 +1,84 @@
+#pragma once
+
+#include "enum.h"
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <tins/dns.h>
+
+namespace flowstats {
+
+// NOLINTNEXTLINE
+BETTER_ENUM(ResourceRecordType, uint8_t, A, AAAA, CNAME, PTR, TXT, OTHER);
+// Response codes counted on their own, the others are grouped
+// NOLINTNEXTLINE
+BETTER_ENUM(ResponseCodeType, uint8_t, RCODE_NOERROR, RCODE_SERVFAIL, RCODE_NXDOMAIN, RCODE_REFUSED, RCODE_OTHER);
+
+uint32_t const DNS_HEADER_SIZE = 12;
+uint32_t const DNS_MAX_NAME_SIZE = 255;
+// A and AAAA answers kept per message, the others are only counted
+size_t const DNS_MAX_ADDRESSES = 32;
+
+struct DnsAddress {
+    // Points in the payload, 4 or 16 bytes
+    uint8_t const* data;
+    bool isV6;
+    uint32_t ttl;
+};
+
+auto toResponseCodeType(uint8_t rcode) -> ResponseCodeType;
+
+/**
+ * Fields of a dns message read in place from the payload: the header,
+ * the first question and the types and addresses of the answers.
+ *
+ * Nothing is allocated, the first query name is decoded in a fixed buffer
+ * and the addresses point in the payload so the message is only valid as
+ * long as the payload is.
+ */
+class DnsMessage {
+public:
+    /**
+     * Returns false on a malformed or truncated message. Compression
+     * pointers have to point before themselves so loops are rejected.
+     */
+    [[nodiscard]] auto parse(uint8_t const* data, uint32_t size) -> bool;
+
+    [[nodiscard]] auto getId() const -> uint16_t { return id; }
+    [[nodiscard]] auto isResponse() const -> bool { return (flags & 0x8000) != 0; }
+    [[nodiscard]] auto getTruncated() const -> bool { return (flags & 0x0200) != 0; }
+    [[nodiscard]] auto getRcode() const -> uint8_t { return flags & 0xf; }
+    [[nodiscard]] auto getNumQueries() const -> uint16_t { return numQueries; }
+    // Lowercased labels separated by dots without the trailing dot
+    [[nodiscard]] auto getQname() const -> std::string_view { return { qname.data(), qnameSize }; }
+    [[nodiscard]] auto getQueryType() const { return static_cast<Tins::DNS::QueryType>(queryType); }
+
+    [[nodiscard]] auto getNumAnswers() const -> uint16_t { return numAnswers; }
+    [[nodiscard]] auto getAnswerCount(ResourceRecordType rrType) const { return answerCounts[rrType]; }
+    [[nodiscard]] auto getNumAddresses() const -> size_t { return numAddresses; }
+    [[nodiscard]] auto getAddress(size_t i) const -> DnsAddress const& { return addresses[i]; }
+
+private:
+    /**
+     * Decode the name at offset into qname, returns the offset following
+     * the name or 0 on error
+     */
+    auto readName(uint8_t const* data, uint32_t size, uint32_t offset) -> uint32_t;
+    static auto skipName(uint8_t const* data, uint32_t size, uint32_t offset) -> uint32_t;
+    auto parseAnswers(uint8_t const* data, uint32_t size, uint32_t offset) -> bool;
+
+    uint16_t id = 0;
+    uint16_t flags = 0;
+    uint16_t numQueries = 0;
+    uint16_t numAnswers = 0;
+    uint16_t queryType = 0;
+
+    std::array<char, DNS_MAX_NAME_SIZE> qname;
+    uint32_t qnameSize = 0;
+
+    std::array<uint16_t, ResourceRecordType::_size()> answerCounts = {};
+    std::array<DnsAddress, DNS_MAX_ADDRESSES> addresses;
+    size_t numAddresses = 0;
+};
+
+} // namespace flowstats
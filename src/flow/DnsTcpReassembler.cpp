@@ -0,0 +1,155 @@
+#include "DnsTcpReassembler.hpp"
+#include <algorithm>
+
+namespace flowstats {
+
+namespace {
+
+    // The length prefix doesn't include itself
+    auto readMessageSize(uint8_t const* data) -> uint32_t
+    {
+        return 2 + ((data[0] << 8) | data[1]);
+    }
+
+} // namespace
+
+auto DnsTcpReassembler::addSegment(DnsStreamKey const& key, uint32_t seq,
+    uint8_t const* data, uint32_t size, uint32_t wireSize,
+    uint64_t nowMs) -> std::vector<DnsTcpMessage> const&
+{
+    messages.clear();
+    auto it = streams.find(key);
+    if (it != streams.end()) {
+        auto& stream = it->second;
+        // Payload already seen, from a retransmission
+        auto seen = static_cast<int32_t>(stream.nextSeq - seq);
+        if (seen > 0 && static_cast<uint32_t>(seen) >= wireSize) {
+            return messages;
+        }
+        if (seen < 0 || static_cast<uint32_t>(seen) > size) {
+            // A segment was lost, restart framing from this one
+            streams.erase(key);
+            it = streams.end();
+        } else {
+            seq += seen;
+            data += seen;
+            size -= seen;
+            wireSize -= seen;
+            stream.lastMs = nowMs;
+            if (stream.hasPending()) {
+                auto used = completePending(&stream, data, size);
+                seq += used;
+                data += used;
+                size -= used;
+                wireSize -= used;
+            }
+            if (stream.hasPending()) {
+                stream.nextSeq = seq + wireSize;
+                if (size < wireSize) {
+                    streams.erase(key);
+                }
+                return messages;
+            }
+        }
+    }
+
+    // Whole messages are used in place
+    uint32_t offset = 0;
+    while (size - offset >= 2) {
+        auto messageSize = readMessageSize(data + offset);
+        if (size - offset < messageSize) {
+            break;
+        }
+        messages.push_back({ data + offset + 2, messageSize - 2 });
+        offset += messageSize;
+    }
+
+    if (size < wireSize) {
+        // The end of the segment wasn't captured
+        if (it != streams.end()) {
+            streams.erase(key);
+        }
+        return messages;
+    }
+    if (it == streams.end()) {
+        if (offset == size) {
+            return messages;
+        }
+        auto res = streams.emplace(key);
+        if (res.first == streams.end()) {
+            return messages;
+        }
+        it = res.first;
+        streamTimeouts.schedule(key, nowMs + DNS_TCP_STREAM_TIMEOUT_MS + 1);
+    }
+    auto& stream = it->second;
+    stream.nextSeq = seq + wireSize;
+    stream.lastMs = nowMs;
+    keepTail(&stream, data + offset, size - offset);
+    return messages;
+}
+
+auto DnsTcpReassembler::completePending(DnsTcpStream* stream, uint8_t const* data, uint32_t size) -> uint32_t
+{
+    if (stream->skipSize > 0) {
+        auto skipped = std::min(stream->skipSize, size);
+        stream->skipSize -= skipped;
+        return skipped;
+    }
+    auto& buffer = stream->buffer;
+    uint32_t used = 0;
+    if (buffer.size() < 2) {
+        // Length split between segments
+        used = std::min<uint32_t>(2 - buffer.size(), size);
+        buffer.insert(buffer.end(), data, data + used);
+        if (buffer.size() < 2) {
+            return used;
+        }
+        if (readMessageSize(buffer.data()) > DNS_TCP_MAX_BUFFERED) {
+            stream->skipSize = readMessageSize(buffer.data()) - 2;
+            buffer.clear();
+            return used + completePending(stream, data + used, size - used);
+        }
+    }
+
+    auto messageSize = readMessageSize(buffer.data());
+    auto copied = std::min<uint32_t>(messageSize - buffer.size(), size - used);
+    buffer.insert(buffer.end(), data + used, data + used + copied);
+    used += copied;
+    if (buffer.size() == messageSize) {
+        // The stream buffer is reused for the next pending message
+        assembled.swap(buffer);
+        buffer.clear();
+        messages.push_back({ assembled.data() + 2, messageSize - 2 });
+    }
+    return used;
+}
+
+auto DnsTcpReassembler::keepTail(DnsTcpStream* stream, uint8_t const* data, uint32_t size) -> void
+{
+    stream->buffer.clear();
+    stream->skipSize = 0;
+    if (size >= 2 && readMessageSize(data) > DNS_TCP_MAX_BUFFERED) {
+        stream->skipSize = readMessageSize(data) - size;
+        return;
+    }
+    stream->buffer.assign(data, data + size);
+}
+
+auto DnsTcpReassembler::advanceTick(uint64_t nowMs) -> void
+{
+    streamTimeouts.advance(nowMs, [&](DnsStreamKey const& key) {
+        auto it = streams.find(key);
+        if (it == streams.end()) {
+            return;
+        }
+        auto deadlineMs = it->second.lastMs + DNS_TCP_STREAM_TIMEOUT_MS + 1;
+        if (deadlineMs > nowMs) {
+            streamTimeouts.schedule(key, deadlineMs);
+            return;
+        }
+        streams.erase(key);
+    });
+}
+
+} // namespace flowstats
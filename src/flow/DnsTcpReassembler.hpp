@@ -0,0 +1,106 @@
+#pragma once
+
+#include "FlatFlowTable.hpp"
+#include "FlowId.hpp"
+#include "TimerWheel.hpp"
+#include <vector>
+
+namespace flowstats {
+
+// Largest message kept across segments, bigger ones are skipped
+uint32_t const DNS_TCP_MAX_BUFFERED = 16384;
+uint64_t const DNS_TCP_STREAM_TIMEOUT_MS = 30000;
+
+/**
+ * One direction of a tcp connection carrying dns
+ */
+struct DnsStreamKey {
+    DnsStreamKey() = default;
+    DnsStreamKey(FlowId const& flowId, Direction direction)
+        : flowId(flowId)
+        , direction(direction) {};
+
+    FlowId flowId;
+    uint8_t direction = FROM_CLIENT;
+
+    auto operator==(DnsStreamKey const& b) const -> bool
+    {
+        return direction == b.direction && flowId == b.flowId;
+    }
+};
+
+} // namespace flowstats
+
+namespace std {
+
+template <>
+struct hash<flowstats::DnsStreamKey> {
+    auto operator()(const flowstats::DnsStreamKey& key) const -> size_t
+    {
+        return key.flowId.hash() ^ key.direction;
+    }
+};
+
+} // namespace std
+
+namespace flowstats {
+
+struct DnsTcpMessage {
+    uint8_t const* data;
+    uint32_t size;
+};
+
+/**
+ * Split the payload of dns over tcp connections in messages, each
+ * prefixed by its 2 bytes length.
+ *
+ * Complete messages point in the segment so the usual case of whole
+ * messages, one or several per segment, copies nothing. A stream is only
+ * tracked once a message is split across segments: its start is buffered
+ * until the following segments complete it. Streams are dropped on a
+ * gap in the sequence numbers, on close and after being idle.
+ */
+class DnsTcpReassembler {
+public:
+    explicit DnsTcpReassembler(size_t maxStreams)
+        : streams(maxStreams) {};
+
+    /**
+     * Messages completed by the segment, valid until the next call.
+     * size is the captured payload and wireSize the payload on the wire.
+     */
+    auto addSegment(DnsStreamKey const& key, uint32_t seq,
+        uint8_t const* data, uint32_t size, uint32_t wireSize,
+        uint64_t nowMs) -> std::vector<DnsTcpMessage> const&;
+    auto closeStream(DnsStreamKey const& key) -> void { streams.erase(key); }
+    auto advanceTick(uint64_t nowMs) -> void;
+
+    [[nodiscard]] auto getNumStreams() const -> size_t { return streams.size(); }
+
+private:
+    struct DnsTcpStream {
+        uint32_t nextSeq = 0;
+        uint64_t lastMs = 0;
+        // Remaining bytes of a message too large to be buffered
+        uint32_t skipSize = 0;
+        // Start of the pending message with its length
+        std::vector<uint8_t> buffer;
+
+        [[nodiscard]] auto hasPending() const -> bool { return skipSize > 0 || !buffer.empty(); }
+    };
+
+    /**
+     * Feed the message pending on the stream, returns the number of bytes
+     * used
+     */
+    auto completePending(DnsTcpStream* stream, uint8_t const* data, uint32_t size) -> uint32_t;
+    auto keepTail(DnsTcpStream* stream, uint8_t const* data, uint32_t size) -> void;
+
+    FlatFlowTable<DnsStreamKey, DnsTcpStream> streams;
+    TimerWheel<DnsStreamKey> streamTimeouts;
+    std::vector<DnsTcpMessage> messages;
+    // Last message completed from a stream buffer
+    std::vector<uint8_t> assembled;
+};
+
+} // namespace flowstats
@@ -39,6 +39,17 @@ auto fieldToSortable(Field field) -> bool
         case Field::RR_TXT_AVG:
         case Field::RR_OTHER_AVG:
 
+        case Field::RCODE_NOERROR_RATE:
+        case Field::RCODE_SERVFAIL_RATE:
+        case Field::RCODE_NXDOMAIN_RATE:
+        case Field::RCODE_REFUSED_RATE:
+        case Field::RCODE_OTHER_RATE:
+        case Field::RCODE_NOERROR_AVG:
+        case Field::RCODE_SERVFAIL_AVG:
+        case Field::RCODE_NXDOMAIN_AVG:
+        case Field::RCODE_REFUSED_AVG:
+        case Field::RCODE_OTHER_AVG:
+
         case Field::REQ_AVG:
         case Field::FIN_AVG:
         case Field::RST_AVG:
@@ -102,6 +113,17 @@ auto fieldWithRateMode(RateMode rateMode, Field field) -> Field
                 return Field::RR_TXT_AVG;
             case Field::RR_OTHER_RATE:
                 return Field::RR_OTHER_AVG;
+
+            case Field::RCODE_NOERROR_RATE:
+                return Field::RCODE_NOERROR_AVG;
+            case Field::RCODE_SERVFAIL_RATE:
+                return Field::RCODE_SERVFAIL_AVG;
+            case Field::RCODE_NXDOMAIN_RATE:
+                return Field::RCODE_NXDOMAIN_AVG;
+            case Field::RCODE_REFUSED_RATE:
+                return Field::RCODE_REFUSED_AVG;
+            case Field::RCODE_OTHER_RATE:
+                return Field::RCODE_OTHER_AVG;
             default:
                 break;
         }
@@ -192,6 +214,17 @@ auto fieldToHeader(Field field) -> char const*
         case Field::RR_TXT_AVG: return "TXT";
         case Field::RR_OTHER_AVG: return "OTHER";
 
+        case Field::RCODE_NOERROR_RATE:
+        case Field::RCODE_NOERROR_AVG: return "NoError/s";
+        case Field::RCODE_SERVFAIL_RATE:
+        case Field::RCODE_SERVFAIL_AVG: return "ServFail/s";
+        case Field::RCODE_NXDOMAIN_RATE:
+        case Field::RCODE_NXDOMAIN_AVG: return "NxDomain/s";
+        case Field::RCODE_REFUSED_RATE:
+        case Field::RCODE_REFUSED_AVG: return "Refused/s";
+        case Field::RCODE_OTHER_RATE:
+        case Field::RCODE_OTHER_AVG: return "OtherRc/s";
+
         case Field::DS_P95: return "Ds95 (1s)";
         case Field::DS_P99: return "Ds99 (1s)";
         case Field::DS_MAX: return "DsMax (1s)";
@@ -63,6 +63,18 @@ BETTER_ENUM(Field, char,
     RR_TXT_AVG,
     RR_OTHER_AVG,
 
+    RCODE_NOERROR_RATE,
+    RCODE_SERVFAIL_RATE,
+    RCODE_NXDOMAIN_RATE,
+    RCODE_REFUSED_RATE,
+    RCODE_OTHER_RATE,
+
+    RCODE_NOERROR_AVG,
+    RCODE_SERVFAIL_AVG,
+    RCODE_NXDOMAIN_AVG,
+    RCODE_REFUSED_AVG,
+    RCODE_OTHER_AVG,
+
     REQ,
     REQ_RATE,
     REQ_AVG,
@@ -3,14 +3,15 @@
 
 namespace flowstats {
 
-auto Flow::addPacket(Tins::Packet const& packet,
+auto Flow::addPacket(PacketView const& packet,
     Direction const direction) -> void
 {
+    changed = true;
     packets[direction]++;
-    bytes[direction] += packet.pdu()->advertised_size();
+    bytes[direction] += packet.getAdvertisedSize();
     totalPackets[direction]++;
-    totalBytes[direction] += packet.pdu()->advertised_size();
-    auto tv = packetToTimeval(packet);
+    totalBytes[direction] += packet.getAdvertisedSize();
+    auto const& tv = packet.getTimestamp();
     if (start.tv_sec == 0) {
         start = tv;
     }
@@ -59,6 +60,7 @@ auto Flow::getFieldStr(Field field, Direction direction, int duration, int index
 
 auto Flow::addFlow(Flow const* flow) -> void
 {
+    changed = true;
     packets[0] += flow->packets[0];
     packets[1] += flow->packets[1];
     totalPackets[0] += flow->totalPackets[0];
@@ -77,6 +79,8 @@ auto Flow::addAggregatedFlow(Flow const* flow) -> void
 
 void Flow::resetFlow(bool resetTotal)
 {
+    // An idle flow keeps the same values
+    changed = changed || resetTotal || packets[0] != 0 || packets[1] != 0;
     packets[0] = 0;
     packets[1] = 0;
     bytes[0] = 0;
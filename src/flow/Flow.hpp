@@ -2,9 +2,10 @@
 
 #include "Field.hpp"
 #include "FlowId.hpp"
+#include "FqdnTable.hpp"
+#include "PacketView.hpp"
 #include <map>
 #include <string>
-#include <tins/packet.h>
 
 namespace flowstats {
 
@@ -16,14 +17,19 @@ public:
     {
     }
 
-    explicit Flow(std::string fqdn)
-        : fqdn(std::move(fqdn))
+    explicit Flow(FqdnId fqdnId)
+        : fqdnId(fqdnId)
     {
     }
 
-    explicit Flow(FlowId flowId, std::string fqdn = "", uint8_t srvPos = 1)
+    explicit Flow(std::string_view fqdn)
+        : fqdnId(internFqdn(fqdn))
+    {
+    }
+
+    explicit Flow(FlowId flowId, FqdnId fqdnId = FQDN_NONE, uint8_t srvPos = 1)
         : flowId(std::move(flowId))
-        , fqdn(std::move(fqdn))
+        , fqdnId(fqdnId)
         , srvPos(srvPos)
     {
     }
@@ -37,22 +43,32 @@ public:
 
     auto setSrvPos(uint8_t pos) { srvPos = pos; };
 
-    virtual auto addPacket(Tins::Packet const& packet, Direction const direction) -> void;
+    virtual auto addPacket(PacketView const& packet, Direction const direction) -> void;
     virtual auto addFlow(Flow const* flow) -> void;
     virtual auto addAggregatedFlow(Flow const* flow) -> void;
     virtual auto resetFlow(bool resetTotal) -> void;
     virtual auto mergePercentiles() -> void {};
     virtual auto prepareSubfields(std::vector<Field> const& subfields) -> void {};
+    [[nodiscard]] virtual auto clone() const -> Flow* { return new Flow(*this); };
+    /**
+     * Overwrite dst, a flow of the same type, reusing its storage
+     */
+    virtual auto copyTo(Flow* dst) const -> void { *dst = *this; };
 
     [[nodiscard]] virtual auto getSubfieldSize(Field field) const -> int { return 0; };
     [[nodiscard]] virtual auto getFieldStr(Field field, Direction direction, int duration, int index) const -> std::string;
 
-    [[nodiscard]] auto getFlowId() const { return flowId; };
-    [[nodiscard]] auto getFqdn() const { return fqdn; };
+    [[nodiscard]] auto getFlowId() const -> FlowId const& { return flowId; };
+    [[nodiscard]] auto getFqdn() const -> std::string const& { return fqdnString(fqdnId); };
+    [[nodiscard]] auto getFqdnId() const { return fqdnId; };
     [[nodiscard]] auto getSrvPos() const { return srvPos; }
     [[nodiscard]] auto getPackets() const { return packets; };
     [[nodiscard]] auto getTotalBytes() const { return totalBytes; };
     [[nodiscard]] auto getTotalPackets() const { return totalPackets; };
+    [[nodiscard]] auto getEndTime() const { return end; };
+    // Whether the flow was updated since the last display snapshot
+    [[nodiscard]] auto getChanged() const { return changed; };
+    auto setChanged(bool c) { changed = c; };
 
     [[nodiscard]] auto getTransport() const { return flowId.getTransport(); };
     [[nodiscard]] auto getPort(uint8_t pos) const { return flowId.getPort(pos); }
@@ -65,9 +81,11 @@ public:
 
     [[nodiscard]] static auto sortByFqdn(Flow const* a, Flow const* b) -> bool
     {
+        auto const& aFqdn = a->getFqdn();
+        auto const& bFqdn = b->getFqdn();
         return std::lexicographical_compare(
-            a->fqdn.begin(), a->fqdn.end(),
-            b->fqdn.begin(), b->fqdn.end(),
+            aFqdn.begin(), aFqdn.end(),
+            bFqdn.begin(), bFqdn.end(),
             caseInsensitiveComp);
     }
 
@@ -101,12 +119,16 @@ public:
         return a->totalPackets[0] + a->totalPackets[1] < b->totalPackets[0] + b->totalPackets[1];
     }
 
+protected:
+    auto setFqdnId(FqdnId id) { fqdnId = id; };
+
 private:
     FlowId flowId;
-    std::string fqdn;
+    FqdnId fqdnId = FQDN_NONE;
     uint8_t srvPos = 1;
     timeval start = {};
     timeval end = {};
+    bool changed = true;
 
     std::array<int, 2> packets = {};
     std::array<int, 2> bytes = {};
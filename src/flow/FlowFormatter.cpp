@@ -88,11 +88,8 @@ auto FlowFormatter::outputFlow(std::vector<Flow const*> const& aggregatedFlows,
     int duration, DisplayConfiguration const& displayConf) const -> std::vector<std::vector<std::string>>
 {
     std::vector<std::vector<std::string>> res;
-    int i = 0;
+    res.reserve(aggregatedFlows.size());
     for (auto const* flow : aggregatedFlows) {
-        if (i++ > displayConf.getMaxResults()) {
-            break;
-        };
         if (subfields.empty()) {
             outputBody(flow, &res, duration, displayConf);
         } else {
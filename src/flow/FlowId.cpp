@@ -1,94 +1,115 @@
 #include "FlowId.hpp"
+#include <cstring>
 #include <fmt/format.h>
 
 namespace flowstats {
 
-FlowId::FlowId(Tins::IP const* ip, Tins::IPv6 const* ipv6,
-    Tins::TCP const* tcp, Tins::UDP const* udp)
-{
-    std::array<Port, 2> pktPorts = {};
-    auto transport = Transport::TCP;
-    if (tcp) {
-        pktPorts = { tcp->sport(), tcp->dport() };
-    } else {
-        pktPorts = { udp->sport(), udp->dport() };
-        transport = Transport::UDP;
+namespace {
+
+    template <typename K>
+    auto fillKey(K* key, uint8_t const* serverIp, uint8_t const* clientIp,
+        std::array<Port, 2> ports, Transport transport) -> void
+    {
+        size_t const ipSize = sizeof(key->ips) / 2;
+        memcpy(key->ips.data(), serverIp, ipSize);
+        memcpy(key->ips.data() + ipSize, clientIp, ipSize);
+        key->ports = ports;
+        key->transport = transport._to_integral();
     }
 
-    IPAddressPair addresses;
-    if (ipv6) {
-        addresses = { IPAddress(ipv6->src_addr()), IPAddress(ipv6->dst_addr()) };
-    } else {
-        addresses = { IPAddress(ip->src_addr()), IPAddress(ip->dst_addr()) };
+    auto hashMix(uint64_t hash, uint64_t value) -> uint64_t
+    {
+        hash ^= value;
+        hash *= 0x9e3779b97f4a7c15ULL;
+        return hash ^ (hash >> 32);
+    }
+
+    template <typename K>
+    auto hashKey(K const& key) -> uint64_t
+    {
+        uint64_t hash = key.transport;
+        for (size_t i = 0; i < sizeof(key.ips); i += sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, key.ips.data() + i, sizeof(word));
+            hash = hashMix(hash, word);
+        }
+        return hashMix(hash, (static_cast<uint64_t>(key.ports[0]) << 16) | key.ports[1]);
     }
-    *this = FlowId(pktPorts, addresses, transport);
+
+} // namespace
+
+FlowId::FlowId(PacketView const& packet)
+{
+    setKey(packet.getSrcIpData(), packet.getDstIpData(), packet.getIsV6(),
+        { packet.getSrcPort(), packet.getDstPort() },
+        packet.isTcp() ? Transport::TCP : Transport::UDP);
 }
 
 FlowId::FlowId(IPAddressPair const& pair, Tins::TCP const& tcp)
+    : FlowId({ tcp.sport(), tcp.dport() }, pair, Transport::TCP)
 {
-    std::array<Port, 2> pktPorts = { tcp.sport(), tcp.dport() };
-    *this = FlowId(pktPorts, pair, Transport::TCP);
 }
 
 FlowId::FlowId(IPAddressPair const& pair, Tins::UDP const& udp)
+    : FlowId({ udp.sport(), udp.dport() }, pair, Transport::UDP)
 {
-    std::array<Port, 2> pktPorts = { udp.sport(), udp.dport() };
-    *this = FlowId(pktPorts, pair, Transport::UDP);
 }
 
-FlowId::FlowId(FlowId&& flowId) noexcept
+FlowId::FlowId(std::array<uint16_t, 2> pktPorts,
+    IPAddressPair const& pair,
+    Transport transport)
 {
-    transport = flowId.transport;
-    direction = flowId.direction;
-    addressPair = flowId.addressPair;
-    ports = flowId.ports;
+    setKey(pair[0].getAddress().data(), pair[1].getAddress().data(),
+        pair[0].getIsV6(), pktPorts, transport);
 }
 
-auto FlowId::operator=(FlowId&& flowId) noexcept -> FlowId&
+auto FlowId::setKey(uint8_t const* srcIp, uint8_t const* dstIp, bool v6,
+    std::array<Port, 2> pktPorts, Transport transport) -> void
 {
-    if (this == &flowId) {
-        return *this;
+    size_t ipSize = v6 ? 16 : 4;
+    if (pktPorts[0] < pktPorts[1]
+        || (pktPorts[0] == pktPorts[1] && memcmp(srcIp, dstIp, ipSize) < 0)) {
+        direction = FROM_SERVER;
+    }
+    std::array<uint8_t const*, 2> ips = { srcIp, dstIp };
+    std::array<Port, 2> ports = { pktPorts[direction], pktPorts[1 - direction] };
+    isV6 = v6;
+    if (v6) {
+        key.v6 = {};
+        fillKey(&key.v6, ips[direction], ips[1 - direction], ports, transport);
+    } else {
+        fillKey(&key.v4, ips[direction], ips[1 - direction], ports, transport);
     }
-    transport = flowId.transport;
-    direction = flowId.direction;
-    addressPair = flowId.addressPair;
-    ports = flowId.ports;
-    return *this;
-}
-
-auto FlowId::operator=(FlowId const& flowId) noexcept -> FlowId&
-{
-    transport = flowId.transport;
-    direction = flowId.direction;
-    addressPair = flowId.addressPair;
-    ports[0] = flowId.ports[0];
-    ports[1] = flowId.ports[1];
-    return *this;
 }
 
-FlowId::FlowId(FlowId const& flowId)
+auto FlowId::getIp(uint8_t pos) const -> IPAddress
 {
-    *this = flowId;
+    if (isV6) {
+        return IPAddress::fromIpv6(key.v6.ips.data() + 16 * pos);
+    }
+    return IPAddress::fromIpv4(key.v4.ips.data() + 4 * pos);
 }
 
-FlowId::FlowId(std::array<uint16_t, 2> pktPorts,
-    IPAddressPair const& pair,
-    Transport transport)
-    : transport(transport)
+/**
+ * FlowId is already normalised on the server side, so both directions of
+ * a flow hash the same. Every field goes through a multiply-xorshift so
+ * flows sharing an address or a port, as seen behind a NAT, spread over
+ * the whole hash range.
+ */
+auto FlowId::hash() const -> size_t
 {
-    if (pktPorts[0] < pktPorts[1]) {
-        direction = FROM_SERVER;
-    }
-    addressPair[0] = pair[0 + direction];
-    addressPair[1] = pair[1 - direction];
-    ports[0] = pktPorts[0 + direction];
-    ports[1] = pktPorts[1 - direction];
+    uint64_t hash = isV6 ? hashKey(key.v6) : hashKey(key.v4);
+    // Final avalanche so the low bits depend on every input bit
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
 }
 
 auto FlowId::toString() const -> std::string
 {
     return fmt::format("{}:{} -> {}:{}",
-        addressPair[direction].getAddrStr(), ports[direction],
-        addressPair[!direction].getAddrStr(), ports[!direction]);
+        getIp(direction).getAddrStr(), getPort(direction),
+        getIp(!direction).getAddrStr(), getPort(!direction));
 }
 } // namespace flowstats
@@ -1,12 +1,16 @@
 #pragma once
+#include "PacketView.hpp"
 #include "Utils.hpp"
 #include "enum.h"
 #include <arpa/inet.h>
+#include <cstddef>
+#include <cstring>
 #include <sstream>
 #include <tins/ip.h>
 #include <tins/ipv6.h>
 #include <tins/tcp.h>
 #include <tins/udp.h>
+#include <type_traits>
 
 namespace flowstats {
 
@@ -14,18 +18,37 @@ using Port = uint16_t;
 // NOLINTNEXTLINE
 BETTER_ENUM(Transport, char, TCP, UDP);
 
-struct FlowId {
+/**
+ * 5-tuples hashed and compared as raw bytes. Only the bytes up to the
+ * transport are significant, the tail padding is never read.
+ */
+struct FlowKeyV4 {
+    std::array<uint8_t, 8> ips;
+    std::array<Port, 2> ports;
+    uint8_t transport;
+};
 
-    FlowId() = default;
+struct FlowKeyV6 {
+    std::array<uint8_t, 32> ips;
+    std::array<Port, 2> ports;
+    uint8_t transport;
+};
 
-    FlowId(FlowId&& flowId) noexcept;
-    auto operator=(FlowId&& other) noexcept -> FlowId&;
+size_t const FLOW_KEY_V4_SIZE = offsetof(FlowKeyV4, transport) + 1;
+size_t const FLOW_KEY_V6_SIZE = offsetof(FlowKeyV6, transport) + 1;
+static_assert(FLOW_KEY_V4_SIZE == 13, "An ipv4 5-tuple is 13 bytes");
+static_assert(FLOW_KEY_V6_SIZE == 37, "An ipv6 5-tuple is 37 bytes");
 
-    FlowId(FlowId const& flowId);
-    auto operator=(FlowId const& other) noexcept -> FlowId&;
+/**
+ * Normalised flow key, the server side comes first so both directions of a
+ * flow share the same key. Ipv4 flows only touch the 13 bytes of their
+ * 5-tuple.
+ */
+struct FlowId {
+
+    FlowId() = default;
 
-    FlowId(Tins::IP const* ip, Tins::IPv6 const* ipv6,
-        Tins::TCP const* tcp, Tins::UDP const* udp);
+    explicit FlowId(PacketView const& packet);
 
     FlowId(std::array<uint16_t, 2> ports,
         IPAddressPair const& pair, Transport transport);
@@ -33,41 +56,54 @@ struct FlowId {
     FlowId(IPAddressPair const& pair, Tins::UDP const& udp);
 
     [[nodiscard]] auto toString() const -> std::string;
-    [[nodiscard]] auto getIp(uint8_t pos) const { return addressPair[pos]; };
-    [[nodiscard]] auto getIpv4(uint8_t pos) const { return addressPair[pos].getAddrV4(); };
-    [[nodiscard]] auto getIpv6(uint8_t pos) const { return addressPair[pos].getAddrV6(); };
+    [[nodiscard]] auto getIp(uint8_t pos) const -> IPAddress;
+    [[nodiscard]] auto getIpv4(uint8_t pos) const { return getIp(pos).getAddrV4(); };
+    [[nodiscard]] auto getIpv6(uint8_t pos) const { return getIp(pos).getAddrV6(); };
 
-    [[nodiscard]] auto getPorts() const { return ports; };
-    [[nodiscard]] auto getPort(uint8_t pos) const { return ports[pos]; };
-    [[nodiscard]] auto getTransport() const { return transport; };
-    [[nodiscard]] auto getDirection() const { return direction; };
-
-    [[nodiscard]] auto hash() const
+    [[nodiscard]] auto getPorts() const -> std::array<Port, 2> const& { return isV6 ? key.v6.ports : key.v4.ports; };
+    [[nodiscard]] auto getPort(uint8_t pos) const { return getPorts()[pos]; };
+    [[nodiscard]] auto getTransport() const -> Transport
     {
-        return std::hash<IPAddress>()(addressPair[0]) + std::hash<IPAddress>()(addressPair[1]) + +std::hash<uint16_t>()(ports[0]) + std::hash<uint16_t>()(ports[1])
-            + std::hash<uint8_t>()(transport);
+        return Transport::_from_integral_unchecked(isV6 ? key.v6.transport : key.v4.transport);
     };
+    [[nodiscard]] auto getDirection() const { return static_cast<Direction>(direction); };
+    [[nodiscard]] auto getIsV6() const { return isV6; };
+
+    [[nodiscard]] auto hash() const -> size_t;
 
     auto operator<(FlowId const& b) const -> bool
     {
-        return addressPair < b.addressPair
-            && ports < b.ports
-            && transport < b.transport;
+        if (isV6 != b.isV6) {
+            return isV6 < b.isV6;
+        }
+        return isV6 ? memcmp(&key.v6, &b.key.v6, FLOW_KEY_V6_SIZE) < 0
+                    : memcmp(&key.v4, &b.key.v4, FLOW_KEY_V4_SIZE) < 0;
     }
 
     auto operator==(FlowId const& b) const -> bool
     {
-        return addressPair == b.addressPair
-            && ports == b.ports
-            && transport == b.transport;
+        if (isV6 != b.isV6) {
+            return false;
+        }
+        return isV6 ? memcmp(&key.v6, &b.key.v6, FLOW_KEY_V6_SIZE) == 0
+                    : memcmp(&key.v4, &b.key.v4, FLOW_KEY_V4_SIZE) == 0;
     }
 
 private:
-    IPAddressPair addressPair;
-    std::array<Port, 2> ports = {};
-    Transport transport = Transport::TCP;
-    Direction direction = FROM_CLIENT;
+    auto setKey(uint8_t const* srcIp, uint8_t const* dstIp, bool v6,
+        std::array<Port, 2> pktPorts, Transport transport) -> void;
+
+    union Key {
+        FlowKeyV4 v4;
+        FlowKeyV6 v6;
+    };
+
+    Key key = {};
+    bool isV6 = false;
+    uint8_t direction = FROM_CLIENT;
 };
+
+static_assert(std::is_trivially_copyable_v<FlowId>, "Flow keys are copied as bytes");
 } // namespace flowstats
 
 namespace std {
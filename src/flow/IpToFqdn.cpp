@@ -1,109 +1,663 @@
 #include "IpToFqdn.hpp"
+#include "ReverseResolver.hpp"
+#include "Utils.hpp"
 #include <arpa/inet.h>
+#include <cstring>
+#include <fcntl.h>
 #include <fmt/ostream.h>
 #include <iostream>
+#include <sstream>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
 
 namespace flowstats {
 
+/**
+ * Cache file layout, in host byte order:
+ * header, v4 entries, v6 entries, numFqdns + 1 string offsets, strings.
+ * Expiries are saved in wall clock time, shifted from the packet time of
+ * the capture so a replayed capture saves its remaining ttls. A loaded
+ * cache keeps them in wall clock time, a replay only drops them on
+ * eviction.
+ */
+namespace {
+    char const FQDN_CACHE_MAGIC[8] = { 'F', 'Q', 'D', 'N', 'C', 'A', 'C', 'H' };
+    uint32_t const FQDN_CACHE_VERSION = 1;
+    // Detects a file written with another byte order
+    uint32_t const FQDN_CACHE_BYTE_ORDER = 0x01020304;
+
+    struct FqdnCacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t numV4;
+        uint64_t numV6;
+        uint64_t numFqdns;
+        uint64_t stringBytes;
+    };
+
+    struct FqdnCacheEntryV4 {
+        uint32_t ip;
+        uint32_t fqdnIndex;
+        uint32_t expiryS;
+    };
+
+    struct FqdnCacheEntryV6 {
+        uint8_t ip[16];
+        uint32_t fqdnIndex;
+        uint32_t expiryS;
+    };
+} // namespace
+
+struct IpToFqdn::ResolveState {
+    std::vector<std::string> domains;
+    std::vector<std::vector<Tins::IPv4Address>> ips;
+    std::vector<std::vector<Tins::IPv6Address>> ipv6;
+    std::vector<bool> resolved;
+    std::atomic<size_t> next = 0;
+
+    // Guards the results, done and stop
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t done = 0;
+    bool stop = false;
+};
+
 IpToFqdn::IpToFqdn(FlowstatsConfiguration const& flowstatsConfiguration,
     std::vector<std::string> const& initialDomains,
     std::string const& localhostIp)
     : conf(flowstatsConfiguration)
+    , ipToFqdn(1024, flowstatsConfiguration.getMaxFqdnEntries(),
+          [this](uint64_t const& entry) { releaseFqdn(entryFqdnId(entry)); })
+    , ipv6ToFqdn(1024, flowstatsConfiguration.getMaxFqdnEntries(),
+          [this](uint64_t const& entry) { releaseFqdn(entryFqdnId(entry)); })
 {
-    std::map<uint32_t, std::string> ipToFqdn;
-    ipToFqdn[Tins::IPv4Address("127.0.0.1")] = "localhost";
+    std::vector<Tins::IPv4Address> localhostIps = { Tins::IPv4Address("127.0.0.1") };
     if (!localhostIp.empty()) {
-        ipToFqdn[Tins::IPv4Address(localhostIp)] = "localhost";
+        localhostIps.emplace_back(localhostIp);
+    }
+    updateFqdn("localhost", localhostIps, { Tins::IPv6Address("::1") });
+    if (!initialDomains.empty()) {
+        resolveDomains(initialDomains);
+    }
+
+    if (!conf.getPrefixFile().empty()) {
+        loadPrefixes(conf.getPrefixFile());
+    }
+
+    if (!conf.getReverseDnsServer().empty()) {
+        reverseResolver = std::make_unique<ReverseResolver>(this, conf.getReverseDnsServer());
+    }
+
+    auto const& cacheFile = conf.getFqdnCacheFile();
+    if (!cacheFile.empty()) {
+        loadCache(cacheFile);
+        cacheSaver = std::thread(&IpToFqdn::cacheSaverLoop, this);
+    }
+}
+
+IpToFqdn::~IpToFqdn()
+{
+    // Stop the threads updating the mappings first
+    reverseResolver.reset();
+    if (resolver.joinable()) {
+        {
+            const std::lock_guard<std::mutex> lock(resolveState->mutex);
+            resolveState->stop = true;
+        }
+        resolveState->cv.notify_all();
+        resolver.join();
+    }
+    if (cacheSaver.joinable()) {
+        {
+            const std::lock_guard<std::mutex> lock(cacheSaverMutex);
+            stopCacheSaver = true;
+        }
+        cacheSaverCv.notify_one();
+        cacheSaver.join();
+        saveCache(conf.getFqdnCacheFile());
+    }
+
+    // No lookup is left, the fqdns of the mappings go back to the table
+    const std::lock_guard<std::mutex> lock(writeMutex);
+    ipToFqdn.forEach([this](Tins::IPv4Address const&, uint64_t entry) { releaseFqdn(entryFqdnId(entry)); });
+    ipv6ToFqdn.forEach([this](Tins::IPv6Address const&, uint64_t entry) { releaseFqdn(entryFqdnId(entry)); });
+    fqdnTable().recycle(releasedFqdns);
+}
+
+auto IpToFqdn::cacheSaverLoop() -> void
+{
+    std::unique_lock<std::mutex> lock(cacheSaverMutex);
+    while (!cacheSaverCv.wait_for(lock, std::chrono::seconds(FQDN_CACHE_SAVE_INTERVAL_S),
+        [this] { return stopCacheSaver; })) {
+        saveCache(conf.getFqdnCacheFile());
+    }
+}
+
+/**
+ * Lookups go on while the maps are walked, the file is written aside and
+ * renamed so a reader never sees a partial one
+ */
+auto IpToFqdn::saveCache(std::string const& path) const -> bool
+{
+    std::vector<FqdnCacheEntryV4> v4Entries;
+    std::vector<FqdnCacheEntryV6> v6Entries;
+    std::unordered_map<FqdnId, uint32_t> fqdnIndexes;
+    std::vector<uint64_t> offsets;
+    std::string strings;
+    // Called while the map is walked, which keeps the fqdns from being
+    // recycled
+    auto fqdnIndex = [&](uint64_t entry) {
+        auto res = fqdnIndexes.emplace(entryFqdnId(entry), offsets.size());
+        if (res.second) {
+            offsets.push_back(strings.size());
+            strings += fqdnString(entryFqdnId(entry));
+        }
+        return res.first->second;
+    };
+
+    // Ticks follow the packet time
+    auto packetS = lastTickS.load(std::memory_order_relaxed);
+    int64_t clockOffsetS = packetS == 0 ? 0 : time(nullptr) - packetS;
+    auto wallExpiryS = [&](uint64_t entry) {
+        auto expiryS = entryExpiryS(entry);
+        if (expiryS == 0) {
+            return expiryS;
+        }
+        // Already expired ones are saved as such
+        return static_cast<uint32_t>(std::max<int64_t>(expiryS + clockOffsetS, 1));
+    };
+
+    v4Entries.reserve(ipToFqdn.size());
+    ipToFqdn.forEach([&](Tins::IPv4Address const& ip, uint64_t entry) {
+        v4Entries.push_back({ static_cast<uint32_t>(ip), fqdnIndex(entry), wallExpiryS(entry) });
+    });
+    v6Entries.reserve(ipv6ToFqdn.size());
+    ipv6ToFqdn.forEach([&](Tins::IPv6Address const& ip, uint64_t entry) {
+        FqdnCacheEntryV6 v6Entry = { {}, fqdnIndex(entry), wallExpiryS(entry) };
+        std::copy(ip.begin(), ip.end(), v6Entry.ip);
+        v6Entries.push_back(v6Entry);
+    });
+
+    auto numFqdns = offsets.size();
+    offsets.push_back(strings.size());
+
+    FqdnCacheHeader header = {};
+    std::memcpy(header.magic, FQDN_CACHE_MAGIC, sizeof(header.magic));
+    header.version = FQDN_CACHE_VERSION;
+    header.byteOrder = FQDN_CACHE_BYTE_ORDER;
+    header.numV4 = v4Entries.size();
+    header.numV6 = v6Entries.size();
+    header.numFqdns = numFqdns;
+    header.stringBytes = strings.size();
+
+    auto tmpPath = path + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    out.write(reinterpret_cast<char const*>(v4Entries.data()), v4Entries.size() * sizeof(FqdnCacheEntryV4));
+    out.write(reinterpret_cast<char const*>(v6Entries.data()), v6Entries.size() * sizeof(FqdnCacheEntryV6));
+    out.write(reinterpret_cast<char const*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    out.write(strings.data(), strings.size());
+    out.close();
+    if (!out || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        spdlog::error("Could not write fqdn cache {}", path);
+        unlink(tmpPath.c_str());
+        return false;
     }
-    resolveDomains(initialDomains, ipToFqdn);
+    SPDLOG_DEBUG("Saved {} ipv4 and {} ipv6 fqdn mappings to {}",
+        v4Entries.size(), v6Entries.size(), path);
+    return true;
 }
 
-auto IpToFqdn::resolveDns(std::string const& domain) -> std::vector<std::string>
+auto IpToFqdn::loadCache(std::string const& path) -> bool
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        SPDLOG_INFO("No fqdn cache at {}", path);
+        return false;
+    }
+    struct stat st = {};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FqdnCacheHeader)) {
+        close(fd);
+        spdlog::error("Invalid fqdn cache {}", path);
+        return false;
+    }
+    size_t size = st.st_size;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        spdlog::error("Could not map fqdn cache {}", path);
+        return false;
+    }
+    auto const* data = static_cast<uint8_t const*>(map);
+
+    FqdnCacheHeader header = {};
+    std::memcpy(&header, data, sizeof(header));
+    // Check each section fits before computing the next offset
+    bool valid = std::memcmp(header.magic, FQDN_CACHE_MAGIC, sizeof(header.magic)) == 0
+        && header.version == FQDN_CACHE_VERSION
+        && header.byteOrder == FQDN_CACHE_BYTE_ORDER;
+    size_t remaining = size - sizeof(header);
+    auto takeSection = [&](uint64_t count, size_t elemSize) {
+        if (!valid || count > remaining / elemSize) {
+            valid = false;
+            return static_cast<size_t>(0);
+        }
+        remaining -= count * elemSize;
+        return static_cast<size_t>(count * elemSize);
+    };
+    size_t v4Offset = sizeof(header);
+    size_t v6Offset = v4Offset + takeSection(header.numV4, sizeof(FqdnCacheEntryV4));
+    size_t offsetsOffset = v6Offset + takeSection(header.numV6, sizeof(FqdnCacheEntryV6));
+    size_t stringsOffset = offsetsOffset + takeSection(header.numFqdns + 1, sizeof(uint64_t));
+    takeSection(header.stringBytes, 1);
+    if (!valid) {
+        munmap(map, size);
+        spdlog::error("Invalid fqdn cache {}", path);
+        return false;
+    }
+
+    std::vector<uint64_t> offsets(header.numFqdns + 1);
+    std::memcpy(offsets.data(), data + offsetsOffset, offsets.size() * sizeof(uint64_t));
+    std::vector<std::string_view> fqdns;
+    fqdns.reserve(header.numFqdns);
+    auto const* strings = reinterpret_cast<char const*>(data + stringsOffset);
+    for (size_t i = 0; i < header.numFqdns; ++i) {
+        if (offsets[i] > offsets[i + 1] || offsets[i + 1] > header.stringBytes) {
+            munmap(map, size);
+            spdlog::error("Invalid fqdn cache {}", path);
+            return false;
+        }
+        fqdns.emplace_back(strings + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+
+    // Expired mappings are dropped before their fqdn reaches the table,
+    // mappings without expiry stay pinned
+    auto nowS = static_cast<uint32_t>(time(nullptr));
+    size_t loaded = 0;
+    auto load = [&](IPAddress const& ip, uint32_t fqdnIndex, uint32_t expiryS) {
+        if (fqdnIndex >= fqdns.size() || (expiryS != 0 && expiryS <= nowS)) {
+            return;
+        }
+        auto const& fqdn = fqdns[fqdnIndex];
+        auto fqdnId = expiryS == 0 ? internFqdn(fqdn) : fqdnTable().acquire(fqdn);
+        updateEntry(ip, packEntry(fqdnId, expiryS), expiryS == 0);
+        loaded++;
+    };
+
+    const std::lock_guard<std::mutex> lock(writeMutex);
+    ipToFqdn.reserve(header.numV4);
+    for (size_t i = 0; i < header.numV4; ++i) {
+        FqdnCacheEntryV4 entry;
+        std::memcpy(&entry, data + v4Offset + i * sizeof(entry), sizeof(entry));
+        load(IPAddress(Tins::IPv4Address(entry.ip)), entry.fqdnIndex, entry.expiryS);
+    }
+    ipv6ToFqdn.reserve(header.numV6);
+    for (size_t i = 0; i < header.numV6; ++i) {
+        FqdnCacheEntryV6 entry;
+        std::memcpy(&entry, data + v6Offset + i * sizeof(entry), sizeof(entry));
+        load(IPAddress(Tins::IPv6Address(entry.ip)), entry.fqdnIndex, entry.expiryS);
+    }
+    munmap(map, size);
+    SPDLOG_INFO("Loaded {} fqdn mappings from {}", loaded, path);
+    return true;
+}
+
+auto IpToFqdn::resolveDns(std::string const& domain,
+    std::vector<Tins::IPv4Address>* ips,
+    std::vector<Tins::IPv6Address>* ipv6) -> int
 {
     struct addrinfo hints = {};
-    struct addrinfo* res;
-    hints.ai_family = AF_INET;
+    struct addrinfo* res = nullptr;
+    hints.ai_family = AF_UNSPEC;
     hints.ai_socktype = SOCK_STREAM;
-    hints.ai_flags |= AI_CANONNAME;
-    std::vector<std::string> ips;
 
     int errcode = getaddrinfo(domain.c_str(), nullptr, &hints, &res);
     if (errcode != 0) {
-        perror("getaddrinfo");
-        return ips;
+        return errcode;
     }
 
-    char ip[20];
-    while (res) {
-        void* ptr = &(reinterpret_cast<struct sockaddr_in*>(res->ai_addr))->sin_addr;
-        inet_ntop(res->ai_family, ptr, ip, 20);
-        ips.emplace_back(ip);
-        SPDLOG_DEBUG("Resolved {} -> {}", domain, ip);
-        res = res->ai_next;
+    for (auto* ai = res; ai != nullptr; ai = ai->ai_next) {
+        if (ai->ai_family == AF_INET) {
+            auto const* sin = reinterpret_cast<struct sockaddr_in const*>(ai->ai_addr);
+            ips->emplace_back(sin->sin_addr.s_addr);
+        } else if (ai->ai_family == AF_INET6) {
+            auto const* sin6 = reinterpret_cast<struct sockaddr_in6 const*>(ai->ai_addr);
+            ipv6->emplace_back(sin6->sin6_addr.s6_addr);
+        }
     }
-    return ips;
+    freeaddrinfo(res);
+    return 0;
+}
+
+/**
+ * getaddrinfo can't be cancelled, the resolver threads are detached and
+ * a domain still pending at the deadline is dropped. Capture starts
+ * without waiting, the mappings are applied in one batch once all domains
+ * are resolved or the deadline passed.
+ *
+ * A detached thread may return from getaddrinfo during shutdown. It checks
+ * stop under the state mutex before logging or storing anything, and the
+ * destructor sets stop under that mutex, so nothing runs past it.
+ */
+auto IpToFqdn::resolveDomains(std::vector<std::string> const& domains) -> void
+{
+    auto state = std::make_shared<ResolveState>();
+    state->domains = domains;
+    state->ips.resize(domains.size());
+    state->ipv6.resize(domains.size());
+    state->resolved.resize(domains.size());
+
+    for (size_t i = 0; i < std::min(RESOLVER_THREADS, domains.size()); ++i) {
+        std::thread([state] {
+            for (auto index = state->next++; index < state->domains.size(); index = state->next++) {
+                {
+                    const std::lock_guard<std::mutex> lock(state->mutex);
+                    if (state->stop) {
+                        return;
+                    }
+                }
+                auto const& domain = state->domains[index];
+                std::vector<Tins::IPv4Address> ips;
+                std::vector<Tins::IPv6Address> ipv6;
+                auto errcode = resolveDns(domain, &ips, &ipv6);
+
+                const std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->stop) {
+                    return;
+                }
+                if (errcode != 0) {
+                    spdlog::error("Could not resolve {}: {}", domain, gai_strerror(errcode));
+                }
+                SPDLOG_DEBUG("Resolved {} to {} ipv4 and {} ipv6", domain, ips.size(), ipv6.size());
+                state->ips[index] = std::move(ips);
+                state->ipv6[index] = std::move(ipv6);
+                state->resolved[index] = true;
+                if (++state->done == state->domains.size()) {
+                    state->cv.notify_all();
+                }
+            }
+        }).detach();
+    }
+
+    resolveState = state;
+    resolver = std::thread([this, state] {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        bool completed = state->cv.wait_for(lock, std::chrono::seconds(RESOLVE_TIMEOUT_S),
+            [&state] { return state->stop || state->done == state->domains.size(); });
+        if (state->stop) {
+            return;
+        }
+        if (!completed) {
+            spdlog::warn("Only {} of {} domains resolved in {}s",
+                state->done, state->domains.size(), RESOLVE_TIMEOUT_S);
+        }
+        // Late resolver threads only check stop from now on
+        state->stop = true;
+        applyResolution(*state);
+    });
 }
 
-auto IpToFqdn::resolveDomains(const std::vector<std::string>& initialDomains,
-    std::map<uint32_t, std::string> ipToFqdn) -> void
+auto IpToFqdn::applyResolution(ResolveState const& state) -> void
 {
-    for (const auto& domain : initialDomains) {
-        std::vector<std::string> ips = resolveDns(domain);
-        for (auto& ip : ips) {
-            ipToFqdn[Tins::IPv4Address(ip)] = domain;
+    const std::lock_guard<std::mutex> lock(writeMutex);
+    for (size_t i = 0; i < state.domains.size(); ++i) {
+        if (!state.resolved[i]) {
+            continue;
+        }
+        auto entry = packEntry(internFqdn(state.domains[i]), 0);
+        for (auto const& ip : state.ips[i]) {
+            updateEntry(IPAddress(ip), entry, true);
+        }
+        for (auto const& ip : state.ipv6[i]) {
+            updateEntry(IPAddress(ip), entry, true);
         }
     }
 }
 
-auto IpToFqdn::updateDnsCache() -> void
+auto IpToFqdn::waitForResolution() -> void
 {
-    for (auto const& i : ipToFqdn) {
-        fmt::print(ipv4CacheFile, "{} {}",
-            i.first,
-            i.second);
+    if (resolver.joinable()) {
+        resolver.join();
     }
 }
 
-auto IpToFqdn::updateFqdn(std::string const& fqdn,
+auto IpToFqdn::updateFqdn(std::string_view fqdn,
     std::vector<Tins::IPv4Address> const& ips,
-    std::vector<Tins::IPv6Address> const& ipv6) -> void
+    std::vector<Tins::IPv6Address> const& ipv6,
+    std::optional<uint32_t> ttlS,
+    timeval now) -> void
 {
-    const std::lock_guard<std::mutex> lock(mutex);
+    uint32_t expiryS = 0;
+    if (ttlS.has_value()) {
+        expiryS = now.tv_sec + std::max(*ttlS, FQDN_MIN_TTL_S);
+    }
+    bool pinned = !ttlS.has_value();
+    // Names of expiring mappings are released with them, each mapping
+    // holds a reference
+    auto fqdnId = pinned ? internFqdn(fqdn) : FQDN_NONE;
+    auto entryFor = [&] {
+        return packEntry(pinned ? fqdnId : fqdnTable().acquire(fqdn), expiryS);
+    };
+
+    const std::lock_guard<std::mutex> lock(writeMutex);
     for (auto const& ip : ips) {
         SPDLOG_DEBUG("Fqdn mapping {} -> {}", ip.to_string(), fqdn);
-        ipToFqdn[ip] = fqdn;
+        updateEntry(IPAddress(ip), entryFor(), pinned);
     }
     for (auto const& ip : ipv6) {
         SPDLOG_DEBUG("Fqdn mapping {} -> {}", ip.to_string(), fqdn);
-        ipv6ToFqdn[ip] = fqdn;
+        updateEntry(IPAddress(ip), entryFor(), pinned);
     }
 }
 
-auto IpToFqdn::getFlowFqdn(IPAddress const& addr) -> std::optional<std::string>
+auto IpToFqdn::releaseFqdn(FqdnId fqdnId) -> void
+{
+    if (fqdnTable().release(fqdnId)) {
+        releasedFqdns.push_back(fqdnId);
+    }
+}
+
+auto IpToFqdn::recycleFqdns() -> void
+{
+    if (releasedFqdns.empty()) {
+        return;
+    }
+    // Lookups resolving a released id are done once both maps synchronized
+    ipToFqdn.synchronize();
+    ipv6ToFqdn.synchronize();
+    fqdnTable().recycle(releasedFqdns);
+    releasedFqdns.clear();
+}
+
+auto IpToFqdn::updateEntry(IPAddress const& ip, uint64_t entry, bool pinned) -> void
+{
+    // Pinned mappings are the ones without expiry. They come from the
+    // static or resolved domains, which win over the names seen in dns
+    // answers.
+    if (!pinned) {
+        auto current = ip.getIsV6() ? ipv6ToFqdn.peek(ip.getAddrV6()) : ipToFqdn.peek(ip.getAddrV4());
+        if (current.has_value() && entryExpiryS(*current) == 0) {
+            releaseFqdn(entryFqdnId(entry));
+            return;
+        }
+    }
+
+    std::optional<uint64_t> previous;
+    if (ip.getIsV6()) {
+        previous = ipv6ToFqdn.insert(ip.getAddrV6(), entry, pinned);
+    } else {
+        previous = ipToFqdn.insert(ip.getAddrV4(), entry, pinned);
+    }
+    if (previous.has_value()) {
+        releaseFqdn(entryFqdnId(*previous));
+    }
+
+    auto expiryS = entryExpiryS(entry);
+    if (expiryS == 0) {
+        return;
+    }
+    // A pending timer firing before the new expiry re-arms itself
+    if (previous.has_value() && entryExpiryS(*previous) != 0
+        && entryExpiryS(*previous) <= expiryS) {
+        return;
+    }
+    expiries.schedule(ip, static_cast<uint64_t>(expiryS) * 1000);
+}
+
+auto IpToFqdn::expireEntry(IPAddress const& ip, uint64_t nowMs) -> void
+{
+    auto entry = ip.getIsV6() ? ipv6ToFqdn.peek(ip.getAddrV6()) : ipToFqdn.peek(ip.getAddrV4());
+    if (!entry.has_value() || entryExpiryS(*entry) == 0) {
+        return;
+    }
+    auto expiryMs = static_cast<uint64_t>(entryExpiryS(*entry)) * 1000;
+    if (expiryMs > nowMs) {
+        expiries.schedule(ip, expiryMs);
+        return;
+    }
+    SPDLOG_DEBUG("Fqdn mapping of {} expired", ip.getAddrStr());
+    bool erased = ip.getIsV6() ? ipv6ToFqdn.erase(ip.getAddrV6()) : ipToFqdn.erase(ip.getAddrV4());
+    if (erased) {
+        releaseFqdn(entryFqdnId(*entry));
+        expirations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+auto IpToFqdn::advanceTick(timeval now) -> void
+{
+    // Called for every packet, only one caller per second goes further
+    auto lastS = lastTickS.load(std::memory_order_relaxed);
+    if (now.tv_sec <= lastS || !lastTickS.compare_exchange_strong(lastS, now.tv_sec)) {
+        return;
+    }
+    const std::lock_guard<std::mutex> lock(writeMutex);
+    auto nowMs = timevalInMs(now);
+    expiries.advance(nowMs, [&](IPAddress const& ip) { expireEntry(ip, nowMs); });
+    recycleFqdns();
+}
+
+auto IpToFqdn::getStats() const -> IpToFqdnStats
+{
+    IpToFqdnStats stats;
+    stats.entries = ipToFqdn.size() + ipv6ToFqdn.size();
+    stats.evictions = ipToFqdn.getEvictions() + ipv6ToFqdn.getEvictions();
+    stats.expirations = expirations.load(std::memory_order_relaxed);
+    for (auto const& counters : lookupCounters) {
+        stats.hits += counters.hits.load(std::memory_order_relaxed);
+        stats.prefixHits += counters.prefixHits.load(std::memory_order_relaxed);
+        stats.misses += counters.misses.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+auto IpToFqdn::addPrefix(std::string const& cidr, std::string const& name) -> bool
 {
-    std::optional<std::string> fqdn = {};
-    const std::lock_guard<std::mutex> lock(mutex);
-    if (addr.getIsV6()) {
-        auto it = ipv6ToFqdn.find(addr.getAddrV6());
-        if (it != ipv6ToFqdn.end()) {
-            fqdn = it->second;
+    auto slash = cidr.find('/');
+    auto addrStr = cidr.substr(0, slash);
+    std::array<uint8_t, 16> addr = {};
+    bool isV6 = addrStr.find(':') != std::string::npos;
+    if (inet_pton(isV6 ? AF_INET6 : AF_INET, addrStr.c_str(), addr.data()) != 1) {
+        return false;
+    }
+
+    int maxLen = isV6 ? 128 : 32;
+    int prefixLen = maxLen;
+    if (slash != std::string::npos) {
+        char* end = nullptr;
+        prefixLen = strtol(cidr.c_str() + slash + 1, &end, 10);
+        if (end == cidr.c_str() + slash + 1 || *end != '\0' || prefixLen < 0 || prefixLen > maxLen) {
+            return false;
         }
+    }
+
+    auto fqdnId = internFqdn(name);
+    if (isV6) {
+        ipv6Prefixes.insert(addr.data(), prefixLen, fqdnId);
     } else {
-        auto it = ipToFqdn.find(addr.getAddrV4());
-        if (it != ipToFqdn.end()) {
-            fqdn = it->second;
+        ipv4Prefixes.insert(addr.data(), prefixLen, fqdnId);
+    }
+    return true;
+}
+
+auto IpToFqdn::loadPrefixes(std::string const& path) -> bool
+{
+    std::ifstream in(path);
+    if (!in) {
+        spdlog::error("Could not open prefix file {}", path);
+        return false;
+    }
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        auto comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.resize(comment);
+        }
+        std::istringstream fields(line);
+        std::string cidr;
+        std::string name;
+        if (!(fields >> cidr)) {
+            continue;
+        }
+        if (!(fields >> name) || !addPrefix(cidr, name)) {
+            spdlog::error("Invalid prefix at {}:{}", path, lineNumber);
         }
     }
-    if (fqdn->empty()) {
+    SPDLOG_INFO("Loaded {} ipv4 and {} ipv6 prefixes from {}",
+        ipv4Prefixes.size(), ipv6Prefixes.size(), path);
+    return true;
+}
+
+/**
+ * Flows and keys keep the id past the mapping, it's pinned before the
+ * lookup ends so it can't be recycled in between
+ */
+auto IpToFqdn::getFlowFqdnId(IPAddress const& addr) -> std::optional<FqdnId>
+{
+    auto lookup = [](auto const& map, auto const& key) {
+        auto guard = map.readGuard();
+        auto found = map.find(key);
+        if (!found.has_value() || !fqdnTable().pin(entryFqdnId(*found))) {
+            return FQDN_NONE;
+        }
+        return entryFqdnId(*found);
+    };
+    auto fqdnId = addr.getIsV6() ? lookup(ipv6ToFqdn, addr.getAddrV6()) : lookup(ipToFqdn, addr.getAddrV4());
+    auto& counters = lookupCounters[threadSlot()];
+    if (fqdnId == FQDN_NONE) {
+        auto const* bytes = addr.getAddress().data();
+        auto prefixFqdnId = addr.getIsV6() ? ipv6Prefixes.find(bytes) : ipv4Prefixes.find(bytes);
+        if (prefixFqdnId.has_value()) {
+            counters.prefixHits.fetch_add(1, std::memory_order_relaxed);
+            return *prefixFqdnId;
+        }
+        if (reverseResolver != nullptr) {
+            reverseResolver->enqueue(addr);
+        }
+        counters.misses.fetch_add(1, std::memory_order_relaxed);
         if (conf.getDisplayUnknownFqdn() == false) {
             return {};
         }
-        return "Unknown";
+        return FQDN_UNKNOWN;
+    }
+    counters.hits.fetch_add(1, std::memory_order_relaxed);
+    return fqdnId;
+}
+
+auto IpToFqdn::getFlowFqdn(IPAddress const& addr) -> std::optional<std::string>
+{
+    auto fqdnId = getFlowFqdnId(addr);
+    if (!fqdnId.has_value()) {
+        return {};
     }
-    return fqdn;
+    return fqdnString(*fqdnId);
 }
 
 } // namespace flowstats
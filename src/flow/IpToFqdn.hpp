@@ -1,43 +1,172 @@
 #pragma once
 
 #include "Configuration.hpp"
+#include "FqdnTable.hpp"
 #include "IPAddress.hpp"
+#include "PrefixTable.hpp"
+#include "RcuHashMap.hpp"
+#include "ThreadSlots.hpp"
+#include "TimerWheel.hpp"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <condition_variable>
 #include <cstdint> // for uint16_t, uint32_t
 #include <fstream>
-#include <map> // for map
 #include <mutex> // for mutex
 #include <string> // for string, allocator
+#include <thread>
 #include <tins/ip_address.h>
 #include <tins/ipv6_address.h>
 #include <vector>
 
 namespace flowstats {
 
+class ReverseResolver;
+
+// Answers with a shorter ttl are kept this long, clients commonly keep
+// using an address past its ttl
+uint32_t const FQDN_MIN_TTL_S = 60;
+// Period between two saves of the fqdn cache file
+uint32_t const FQDN_CACHE_SAVE_INTERVAL_S = 60;
+// Startup resolution of the initial domains
+size_t const RESOLVER_THREADS = 8;
+uint32_t const RESOLVE_TIMEOUT_S = 10;
+
+struct IpToFqdnStats {
+    size_t entries = 0;
+    uint64_t evictions = 0;
+    uint64_t expirations = 0;
+    uint64_t hits = 0;
+    // Dns mapping misses resolved by a prefix
+    uint64_t prefixHits = 0;
+    uint64_t misses = 0;
+
+    [[nodiscard]] auto getHitRate() const -> double
+    {
+        auto lookups = hits + prefixHits + misses;
+        return lookups == 0 ? 0 : static_cast<double>(hits + prefixHits) / lookups;
+    }
+};
+
 class IpToFqdn {
 public:
     explicit IpToFqdn(FlowstatsConfiguration const& flowstatsConfiguration,
         std::vector<std::string> const& initialDomains = {},
         std::string const& localhostIp = "");
-    virtual ~IpToFqdn() = default;
+    virtual ~IpToFqdn();
 
+    /**
+     * Id of the fqdn to use for flows to addr, empty when unknown fqdns
+     * are not displayed
+     */
+    auto getFlowFqdnId(IPAddress const& addr) -> std::optional<FqdnId>;
     auto getFlowFqdn(IPAddress const& addr) -> std::optional<std::string>;
-    auto updateFqdn(std::string const& fqdn,
+    /**
+     * Map the addresses to fqdn. Without ttl, the mappings never expire
+     * nor get evicted.
+     */
+    auto updateFqdn(std::string_view fqdn,
         std::vector<Tins::IPv4Address> const& ips,
-        std::vector<Tins::IPv6Address> const& ipv6) -> void;
+        std::vector<Tins::IPv6Address> const& ipv6,
+        std::optional<uint32_t> ttlS = {},
+        timeval now = {}) -> void;
+    /**
+     * Drop the expired mappings, at most once per second
+     */
+    auto advanceTick(timeval now) -> void;
+
+    [[nodiscard]] auto getStats() const -> IpToFqdnStats;
+
+    /**
+     * Block until the initial domains are resolved or the resolution
+     * deadline passed
+     */
+    auto waitForResolution() -> void;
+
+    /**
+     * Binary snapshot of the mappings, loaded with a single mmap
+     */
+    auto saveCache(std::string const& path) const -> bool;
+    auto loadCache(std::string const& path) -> bool;
+
+    /**
+     * Load "<cidr> <name>" lines, names are used for addresses without
+     * dns mapping. Prefixes must be loaded before lookups start.
+     */
+    auto loadPrefixes(std::string const& path) -> bool;
+    auto addPrefix(std::string const& cidr, std::string const& name) -> bool;
 
 private:
     FlowstatsConfiguration const& conf;
 
-    std::mutex mutex;
-    std::map<Tins::IPv4Address, std::string> ipToFqdn;
-    std::map<Tins::IPv6Address, std::string> ipv6ToFqdn;
-    std::ofstream ipv4CacheFile;
-    std::ofstream ipv6CacheFile;
+    // Fqdn id in the low half, expiry time in seconds in the high half,
+    // 0 when the mapping doesn't expire
+    static auto packEntry(FqdnId fqdnId, uint32_t expiryS) -> uint64_t { return (static_cast<uint64_t>(expiryS) << 32) | fqdnId; }
+    static auto entryFqdnId(uint64_t entry) -> FqdnId { return entry & 0xffffffff; }
+    static auto entryExpiryS(uint64_t entry) -> uint32_t { return entry >> 32; }
+
+    /**
+     * Takes over the reference on the fqdn of entry
+     */
+    auto updateEntry(IPAddress const& ip, uint64_t entry, bool pinned) -> void;
+    auto expireEntry(IPAddress const& ip, uint64_t nowMs) -> void;
+    auto releaseFqdn(FqdnId fqdnId) -> void;
+    /**
+     * Give the released fqdns back to the table once no lookup can
+     * resolve them
+     */
+    auto recycleFqdns() -> void;
+
+    // Looked up by every new flow without locking, only the dns
+    // responses updating them serialize
+    RcuHashMap<Tins::IPv4Address, uint64_t> ipToFqdn;
+    RcuHashMap<Tins::IPv6Address, uint64_t> ipv6ToFqdn;
+
+    // Guards the writes, the expiry wheel and the released fqdns
+    std::mutex writeMutex;
+    TimerWheel<IPAddress> expiries { 1000 };
+    std::vector<FqdnId> releasedFqdns;
+    std::atomic<int64_t> lastTickS = 0;
+
+    // Longest prefix match fallback, read only after loading
+    PrefixTable<4> ipv4Prefixes;
+    PrefixTable<16> ipv6Prefixes;
+
+    std::atomic<uint64_t> expirations = 0;
+    // Lookups come from every collector thread, each counts in its own
+    // cache line
+    struct alignas(CACHE_LINE_SIZE) LookupCounters {
+        std::atomic<uint64_t> hits = 0;
+        // Dns mapping misses resolved by a prefix
+        std::atomic<uint64_t> prefixHits = 0;
+        std::atomic<uint64_t> misses = 0;
+    };
+    std::array<LookupCounters, THREAD_SLOTS> lookupCounters;
+
+    // Saves the cache file periodically when one is configured
+    auto cacheSaverLoop() -> void;
+    std::thread cacheSaver;
+    std::mutex cacheSaverMutex;
+    std::condition_variable cacheSaverCv;
+    bool stopCacheSaver = false;
+
+    // Shared with the resolver threads which may outlive the deadline
+    struct ResolveState;
+    auto resolveDomains(std::vector<std::string> const& domains) -> void;
+    auto applyResolution(ResolveState const& state) -> void;
+    /**
+     * Returns the getaddrinfo error code, logs nothing as it may return
+     * after shutdown
+     */
+    static auto resolveDns(std::string const& domain,
+        std::vector<Tins::IPv4Address>* ips,
+        std::vector<Tins::IPv6Address>* ipv6) -> int;
+    std::shared_ptr<ResolveState> resolveState;
+    std::thread resolver;
 
-    auto updateDnsCache() -> void;
-    auto resolveDomains(const std::vector<std::string>& initialDomains,
-        std::map<uint32_t, std::string> ipToFqdn) -> void;
-    auto resolveDns(std::string const& domain) -> std::vector<std::string>;
+    // Queries PTR records of the misses when a server is configured
+    std::unique_ptr<ReverseResolver> reverseResolver;
 };
 
 } // namespace flowstats
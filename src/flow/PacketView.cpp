@@ -0,0 +1,260 @@
+#include "PacketView.hpp"
+#include <algorithm>
+#include <pcap/pcap.h>
+
+namespace flowstats {
+
+namespace {
+
+    uint16_t const ETHERTYPE_IPV4 = 0x0800;
+    uint16_t const ETHERTYPE_ARP = 0x0806;
+    uint16_t const ETHERTYPE_VLAN = 0x8100;
+    uint16_t const ETHERTYPE_IPV6 = 0x86dd;
+    uint16_t const ETHERTYPE_QINQ = 0x88a8;
+    uint16_t const ETHERTYPE_LLDP = 0x88cc;
+    uint16_t const ETHERTYPE_QINQ_OLD = 0x9100;
+
+    uint32_t const ETHERNET_HEADER_SIZE = 14;
+    uint32_t const ETHERNET_MIN_SIZE = 60;
+    uint32_t const VLAN_HEADER_SIZE = 4;
+    uint32_t const SLL_HEADER_SIZE = 16;
+    uint32_t const NULL_HEADER_SIZE = 4;
+    int const MAX_VLAN_TAGS = 3;
+    int const MAX_IPV6_EXTENSIONS = 8;
+
+    uint8_t const IPPROTO_HOPOPTS_NUM = 0;
+    uint8_t const IPPROTO_TCP_NUM = 6;
+    uint8_t const IPPROTO_UDP_NUM = 17;
+    uint8_t const IPPROTO_ROUTING_NUM = 43;
+    uint8_t const IPPROTO_FRAGMENT_NUM = 44;
+    uint8_t const IPPROTO_AH_NUM = 51;
+    uint8_t const IPPROTO_DSTOPTS_NUM = 60;
+
+    auto readBe16(uint8_t const* data) -> uint16_t
+    {
+        return static_cast<uint16_t>((data[0] << 8) | data[1]);
+    }
+
+    auto readBe32(uint8_t const* data) -> uint32_t
+    {
+        return (static_cast<uint32_t>(data[0]) << 24)
+            | (static_cast<uint32_t>(data[1]) << 16)
+            | (static_cast<uint32_t>(data[2]) << 8)
+            | static_cast<uint32_t>(data[3]);
+    }
+
+} // namespace
+
+auto PacketView::getSrcIp() const -> IPAddress
+{
+    return isV6 ? IPAddress::fromIpv6(srcIp) : IPAddress::fromIpv4(srcIp);
+}
+
+auto PacketView::getDstIp() const -> IPAddress
+{
+    return isV6 ? IPAddress::fromIpv6(dstIp) : IPAddress::fromIpv4(dstIp);
+}
+
+auto PacketView::parseFrame(int linkType, uint8_t const* data, uint32_t capLen, timeval pktTs) -> PacketViewStatus
+{
+    ts = pktTs;
+    switch (linkType) {
+        case DLT_EN10MB: {
+            auto status = parseEthernet(data, capLen);
+            // Match the libtins frame size which accounts for ethernet padding
+            advertisedSize = std::max(advertisedSize, ETHERNET_MIN_SIZE);
+            return status;
+        }
+        case DLT_LINUX_SLL: {
+            if (capLen < SLL_HEADER_SIZE) {
+                return PACKET_SKIP;
+            }
+            auto protocol = readBe16(data + 14);
+            if (protocol != ETHERTYPE_IPV4 && protocol != ETHERTYPE_IPV6) {
+                return PACKET_SKIP;
+            }
+            return parseIp(data + SLL_HEADER_SIZE, capLen - SLL_HEADER_SIZE, SLL_HEADER_SIZE, pktTs);
+        }
+        case DLT_NULL:
+        case DLT_LOOP:
+            if (capLen < NULL_HEADER_SIZE) {
+                return PACKET_SKIP;
+            }
+            return parseIp(data + NULL_HEADER_SIZE, capLen - NULL_HEADER_SIZE, NULL_HEADER_SIZE, pktTs);
+        case DLT_RAW:
+        case DLT_IPV4:
+        case DLT_IPV6:
+            return parseIp(data, capLen, 0, pktTs);
+        default:
+            return PACKET_UNSUPPORTED;
+    }
+}
+
+auto PacketView::parseEthernet(uint8_t const* data, uint32_t capLen) -> PacketViewStatus
+{
+    if (capLen < ETHERNET_HEADER_SIZE) {
+        return PACKET_SKIP;
+    }
+    uint32_t offset = ETHERNET_HEADER_SIZE;
+    auto etherType = readBe16(data + 12);
+    for (int i = 0; i < MAX_VLAN_TAGS; ++i) {
+        if (etherType != ETHERTYPE_VLAN && etherType != ETHERTYPE_QINQ
+            && etherType != ETHERTYPE_QINQ_OLD) {
+            break;
+        }
+        if (capLen < offset + VLAN_HEADER_SIZE) {
+            return PACKET_SKIP;
+        }
+        etherType = readBe16(data + offset + 2);
+        offset += VLAN_HEADER_SIZE;
+    }
+
+    switch (etherType) {
+        case ETHERTYPE_IPV4:
+            return parseIpv4(data + offset, capLen - offset, offset);
+        case ETHERTYPE_IPV6:
+            return parseIpv6(data + offset, capLen - offset, offset);
+        case ETHERTYPE_ARP:
+        case ETHERTYPE_LLDP:
+            return PACKET_SKIP;
+        default:
+            // 802.3 frames carry a length instead of an ethertype
+            if (etherType < 0x0600) {
+                return PACKET_SKIP;
+            }
+            return PACKET_UNSUPPORTED;
+    }
+}
+
+auto PacketView::parseIp(uint8_t const* data, uint32_t capLen, uint32_t linkHeaderSize, timeval pktTs) -> PacketViewStatus
+{
+    ts = pktTs;
+    if (capLen < 1) {
+        return PACKET_SKIP;
+    }
+    switch (data[0] >> 4) {
+        case 4:
+            return parseIpv4(data, capLen, linkHeaderSize);
+        case 6:
+            return parseIpv6(data, capLen, linkHeaderSize);
+        default:
+            return PACKET_SKIP;
+    }
+}
+
+auto PacketView::parseIpv4(uint8_t const* data, uint32_t capLen, uint32_t linkHeaderSize) -> PacketViewStatus
+{
+    if (capLen < 20 || (data[0] >> 4) != 4) {
+        return PACKET_SKIP;
+    }
+    uint32_t headerSize = (data[0] & 0x0f) * 4;
+    uint32_t totalLength = readBe16(data + 2);
+    if (headerSize < 20 || capLen < headerSize || totalLength < headerSize) {
+        return PACKET_SKIP;
+    }
+    // Only the first fragment holds the transport header
+    auto fragmentOffset = readBe16(data + 6) & 0x1fff;
+    if (fragmentOffset != 0) {
+        return PACKET_SKIP;
+    }
+
+    isV6 = false;
+    srcIp = data + 12;
+    dstIp = data + 16;
+    advertisedSize = linkHeaderSize + totalLength;
+
+    uint32_t capPayload = std::min(capLen, totalLength) - headerSize;
+    return parseTransport(data[9], data + headerSize, capPayload, totalLength - headerSize);
+}
+
+auto PacketView::parseIpv6(uint8_t const* data, uint32_t capLen, uint32_t linkHeaderSize) -> PacketViewStatus
+{
+    uint32_t const fixedHeaderSize = 40;
+    if (capLen < fixedHeaderSize || (data[0] >> 4) != 6) {
+        return PACKET_SKIP;
+    }
+    uint32_t totalLength = fixedHeaderSize + readBe16(data + 4);
+
+    isV6 = true;
+    srcIp = data + 8;
+    dstIp = data + 24;
+    advertisedSize = linkHeaderSize + totalLength;
+
+    auto nextHeader = data[6];
+    uint32_t offset = fixedHeaderSize;
+    for (int i = 0; i < MAX_IPV6_EXTENSIONS; ++i) {
+        if (nextHeader == IPPROTO_TCP_NUM || nextHeader == IPPROTO_UDP_NUM) {
+            break;
+        }
+        if (capLen < offset + 8) {
+            return PACKET_SKIP;
+        }
+        auto const* extension = data + offset;
+        switch (nextHeader) {
+            case IPPROTO_HOPOPTS_NUM:
+            case IPPROTO_ROUTING_NUM:
+            case IPPROTO_DSTOPTS_NUM:
+                offset += (extension[1] + 1) * 8;
+                break;
+            case IPPROTO_AH_NUM:
+                offset += (extension[1] + 2) * 4;
+                break;
+            case IPPROTO_FRAGMENT_NUM:
+                if ((readBe16(extension + 2) & 0xfff8) != 0) {
+                    return PACKET_SKIP;
+                }
+                offset += 8;
+                break;
+            default:
+                return PACKET_SKIP;
+        }
+        nextHeader = extension[0];
+    }
+    if (offset > totalLength || offset > capLen) {
+        return PACKET_SKIP;
+    }
+
+    uint32_t capPayload = std::min(capLen, totalLength) - offset;
+    return parseTransport(nextHeader, data + offset, capPayload, totalLength - offset);
+}
+
+auto PacketView::parseTransport(uint8_t protocol, uint8_t const* data,
+    uint32_t capLen, uint32_t wireLen) -> PacketViewStatus
+{
+    uint32_t headerSize;
+    if (protocol == IPPROTO_TCP_NUM) {
+        if (capLen < 20) {
+            return PACKET_SKIP;
+        }
+        headerSize = (data[12] >> 4) * 4;
+        if (headerSize < 20 || capLen < headerSize) {
+            return PACKET_SKIP;
+        }
+        tcp = true;
+        seq = readBe32(data + 4);
+        ackSeq = readBe32(data + 8);
+        tcpFlags = data[13];
+        window = readBe16(data + 14);
+    } else if (protocol == IPPROTO_UDP_NUM) {
+        headerSize = 8;
+        if (capLen < headerSize) {
+            return PACKET_SKIP;
+        }
+        tcp = false;
+        tcpFlags = 0;
+        seq = 0;
+        ackSeq = 0;
+        window = 0;
+    } else {
+        return PACKET_SKIP;
+    }
+
+    srcPort = readBe16(data);
+    dstPort = readBe16(data + 2);
+    payload = data + headerSize;
+    payloadSize = capLen - headerSize;
+    wirePayloadSize = wireLen > headerSize ? wireLen - headerSize : 0;
+    return PACKET_OK;
+}
+
+} // namespace flowstats
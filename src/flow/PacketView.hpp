@@ -0,0 +1,86 @@
+#pragma once
+
+#include "IPAddress.hpp"
+#include <cstdint>
+#include <sys/time.h>
+
+namespace flowstats {
+
+enum PacketViewStatus {
+    PACKET_OK,
+    PACKET_SKIP,
+    PACKET_UNSUPPORTED,
+};
+
+/**
+ * Header fields of a TCP or UDP packet decoded in place from the capture
+ * buffer. Nothing is copied, the view is only valid as long as the
+ * capture buffer is.
+ */
+class PacketView {
+public:
+    PacketView() = default;
+
+    /**
+     * Decode a frame of the given pcap link type. PACKET_UNSUPPORTED is
+     * returned for encapsulations that need the libtins slow path and
+     * PACKET_SKIP for frames that carry neither TCP nor UDP.
+     */
+    auto parseFrame(int linkType, uint8_t const* data, uint32_t capLen, timeval ts) -> PacketViewStatus;
+    auto parseIp(uint8_t const* data, uint32_t capLen, uint32_t linkHeaderSize, timeval ts) -> PacketViewStatus;
+
+    [[nodiscard]] auto getTimestamp() const -> timeval const& { return ts; };
+    [[nodiscard]] auto getAdvertisedSize() const -> uint32_t { return advertisedSize; };
+
+    [[nodiscard]] auto getIsV6() const -> bool { return isV6; };
+    [[nodiscard]] auto getSrcIp() const -> IPAddress;
+    [[nodiscard]] auto getDstIp() const -> IPAddress;
+    // Network order address bytes, 4 or 16 depending on the ip version
+    [[nodiscard]] auto getSrcIpData() const -> uint8_t const* { return srcIp; };
+    [[nodiscard]] auto getDstIpData() const -> uint8_t const* { return dstIp; };
+
+    [[nodiscard]] auto isTcp() const -> bool { return tcp; };
+    [[nodiscard]] auto isUdp() const -> bool { return !tcp; };
+    [[nodiscard]] auto getSrcPort() const -> uint16_t { return srcPort; };
+    [[nodiscard]] auto getDstPort() const -> uint16_t { return dstPort; };
+
+    [[nodiscard]] auto getTcpFlags() const -> uint8_t { return tcpFlags; };
+    [[nodiscard]] auto hasFlags(uint8_t flags) const -> bool { return (tcpFlags & flags) == flags; };
+    [[nodiscard]] auto getSeq() const -> uint32_t { return seq; };
+    [[nodiscard]] auto getAckSeq() const -> uint32_t { return ackSeq; };
+    [[nodiscard]] auto getWindow() const -> uint16_t { return window; };
+
+    // Captured payload, may be shorter than the payload on the wire
+    [[nodiscard]] auto getPayload() const -> uint8_t const* { return payload; };
+    [[nodiscard]] auto getPayloadSize() const -> uint32_t { return payloadSize; };
+    // Payload size computed from the ip headers
+    [[nodiscard]] auto getWirePayloadSize() const -> uint32_t { return wirePayloadSize; };
+
+private:
+    auto parseEthernet(uint8_t const* data, uint32_t capLen) -> PacketViewStatus;
+    auto parseIpv4(uint8_t const* data, uint32_t capLen, uint32_t linkHeaderSize) -> PacketViewStatus;
+    auto parseIpv6(uint8_t const* data, uint32_t capLen, uint32_t linkHeaderSize) -> PacketViewStatus;
+    auto parseTransport(uint8_t protocol, uint8_t const* data,
+        uint32_t capLen, uint32_t wireLen) -> PacketViewStatus;
+
+    timeval ts = {};
+    uint32_t advertisedSize = 0;
+
+    bool isV6 = false;
+    uint8_t const* srcIp = nullptr;
+    uint8_t const* dstIp = nullptr;
+
+    bool tcp = false;
+    uint16_t srcPort = 0;
+    uint16_t dstPort = 0;
+    uint8_t tcpFlags = 0;
+    uint16_t window = 0;
+    uint32_t seq = 0;
+    uint32_t ackSeq = 0;
+
+    uint8_t const* payload = nullptr;
+    uint32_t payloadSize = 0;
+    uint32_t wirePayloadSize = 0;
+};
+
+} // namespace flowstats
@@ -2,20 +2,9 @@
 
 namespace flowstats {
 
-auto getTcpPayloadSize(Tins::IP const* ip, Tins::IPv6 const* ipv6,
-    Tins::TCP const& tcp) -> uint32_t
+auto Cursor::checkSize(uint32_t requested) -> bool
 {
-    if (ip) {
-        return ip->advertised_size() - ip->header_size() - tcp.header_size();
-    } else if (ipv6) {
-        return ipv6->advertised_size() - ipv6->header_size() - tcp.header_size();
-    }
-    return 0;
-}
-
-auto Cursor::checkSize(uint32_t size) -> bool
-{
-    if (payload.size() - index < size) {
+    if (size - index < requested) {
         return false;
     }
     return true;
@@ -31,15 +20,12 @@ auto Cursor::readUint24() -> std::optional<uint32_t>
     return res;
 }
 
-auto Cursor::readString(int n) -> std::optional<std::string>
+auto Cursor::readString(int n) -> std::optional<std::string_view>
 {
     if (checkSize(n) == false) {
         return {};
     }
-    std::string res(n, 'x');
-    for (int i = 0; i < n; ++i) {
-        res[i] = payload[index + i];
-    }
+    std::string_view res(reinterpret_cast<char const*>(&payload[index]), n);
     index += n;
     return res;
 }
@@ -61,15 +47,4 @@ auto Cursor::skip(int n) -> bool
     return true;
 }
 
-auto getPorts(Tins::TCP const* tcp, Tins::UDP const* udp) -> std::array<int, 2>
-{
-    if (tcp) {
-        return { tcp->sport(), tcp->dport() };
-    }
-    if (udp) {
-        return { udp->sport(), udp->dport() };
-    }
-    return {};
-}
-
 } // namespace flowstats
@@ -1,24 +1,22 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <tins/endianness.h>
-#include <tins/ip.h>
-#include <tins/ipv6.h>
-#include <tins/tcp.h>
-#include <tins/udp.h>
 
 namespace flowstats {
 
-auto getTcpPayloadSize(Tins::IP const* ip,
-    Tins::IPv6 const* ipv6,
-    Tins::TCP const& tcp) -> uint32_t;
-
 class Cursor {
 public:
-    explicit Cursor(std::vector<uint8_t> const& payload)
-        : payload(payload) {};
+    Cursor(uint8_t const* payload, uint32_t size)
+        : payload(payload)
+        , size(size) {};
     virtual ~Cursor() = default;
 
-    auto remainingBytes() -> uint32_t { return payload.size() - index; };
+    auto remainingBytes() -> uint32_t { return size - index; };
 
     template <typename T>
     [[nodiscard]] auto read() -> std::optional<T>
@@ -46,17 +44,19 @@ public:
     }
 
     [[nodiscard]] auto readUint24() -> std::optional<uint32_t>;
-    [[nodiscard]] auto readString(int n) -> std::optional<std::string>;
+    /**
+     * View of the next n bytes, only valid as long as the payload is
+     */
+    [[nodiscard]] auto readString(int n) -> std::optional<std::string_view>;
 
     [[nodiscard]] auto skip(std::optional<int> n) -> bool;
     [[nodiscard]] auto skip(int n) -> bool;
-    [[nodiscard]] auto checkSize(uint32_t size) -> bool;
+    [[nodiscard]] auto checkSize(uint32_t requested) -> bool;
 
 private:
-    std::vector<uint8_t> const& payload;
-    int index = 0;
+    uint8_t const* payload;
+    uint32_t size;
+    uint32_t index = 0;
 };
 
-auto getPorts(Tins::TCP const* tcp, Tins::UDP const* udp) -> std::array<int, 2>;
-
 } // namespace flowstats
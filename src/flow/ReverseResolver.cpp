@@ -0,0 +1,224 @@
+#include "ReverseResolver.hpp"
+#include "IpToFqdn.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <array>
+#include <cstring>
+#include <fmt/format.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <spdlog/spdlog.h>
+#include <sys/time.h>
+#include <tins/dns.h>
+#include <unistd.h>
+
+namespace flowstats {
+
+namespace {
+    auto parseServer(std::string const& server, sockaddr_storage* addr) -> socklen_t
+    {
+        std::string host = server;
+        uint16_t port = 53;
+        auto portSep = std::string::npos;
+        if (!server.empty() && server[0] == '[') {
+            auto end = server.find(']');
+            if (end == std::string::npos) {
+                return 0;
+            }
+            host = server.substr(1, end - 1);
+            portSep = server.find(':', end);
+        } else if (std::count(server.begin(), server.end(), ':') == 1) {
+            portSep = server.find(':');
+            host = server.substr(0, portSep);
+        }
+        if (portSep != std::string::npos) {
+            port = static_cast<uint16_t>(atoi(server.c_str() + portSep + 1));
+        }
+
+        auto* sin = reinterpret_cast<sockaddr_in*>(addr);
+        if (inet_pton(AF_INET, host.c_str(), &sin->sin_addr) == 1) {
+            sin->sin_family = AF_INET;
+            sin->sin_port = htons(port);
+            return sizeof(sockaddr_in);
+        }
+        auto* sin6 = reinterpret_cast<sockaddr_in6*>(addr);
+        if (inet_pton(AF_INET6, host.c_str(), &sin6->sin6_addr) == 1) {
+            sin6->sin6_family = AF_INET6;
+            sin6->sin6_port = htons(port);
+            return sizeof(sockaddr_in6);
+        }
+        return 0;
+    }
+} // namespace
+
+ReverseResolver::ReverseResolver(IpToFqdn* ipToFqdn, std::string const& server, uint32_t qps)
+    : ipToFqdn(ipToFqdn)
+    , queryInterval(std::chrono::microseconds(1000000 / std::max<uint32_t>(qps, 1)))
+{
+    serverAddrLen = parseServer(server, &serverAddr);
+    if (serverAddrLen == 0) {
+        spdlog::error("Invalid reverse dns server {}", server);
+        return;
+    }
+    resolver = std::thread(&ReverseResolver::resolverLoop, this);
+}
+
+ReverseResolver::~ReverseResolver()
+{
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cv.notify_one();
+    if (resolver.joinable()) {
+        resolver.join();
+    }
+}
+
+auto ReverseResolver::enqueue(IPAddress const& ip) -> void
+{
+    if (serverAddrLen == 0) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock() || queue.size() >= REVERSE_DNS_MAX_PENDING) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    auto negative = negativeCache.find(ip);
+    if (negative != negativeCache.end()) {
+        if (negative->second > Clock::now()) {
+            return;
+        }
+        negativeCache.erase(negative);
+    }
+    if (!pending.insert(ip).second) {
+        return;
+    }
+    queue.push_back(ip);
+    queued.fetch_add(1, std::memory_order_relaxed);
+    lock.unlock();
+    cv.notify_one();
+}
+
+auto ReverseResolver::getStats() const -> ReverseResolverStats
+{
+    ReverseResolverStats stats;
+    stats.queued = queued.load(std::memory_order_relaxed);
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    stats.resolved = resolved.load(std::memory_order_relaxed);
+    stats.failed = failed.load(std::memory_order_relaxed);
+    return stats;
+}
+
+auto ReverseResolver::ptrName(IPAddress const& ip) -> std::string
+{
+    auto const& address = ip.getAddress();
+    if (!ip.getIsV6()) {
+        return fmt::format("{}.{}.{}.{}.in-addr.arpa",
+            address[3], address[2], address[1], address[0]);
+    }
+    std::string name;
+    name.reserve(72);
+    for (int i = 15; i >= 0; --i) {
+        name += fmt::format("{:x}.{:x}.", address[i] & 0xf, address[i] >> 4);
+    }
+    return name + "ip6.arpa";
+}
+
+auto ReverseResolver::resolverLoop() -> void
+{
+    int fd = socket(serverAddr.ss_family, SOCK_DGRAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr const*>(&serverAddr), serverAddrLen) != 0) {
+        spdlog::error("Could not open reverse dns socket: {}", strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+
+    auto nextQuery = Clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait_until(lock, nextQuery, [this] { return stop; });
+        cv.wait(lock, [this] { return stop || !queue.empty(); });
+        if (stop) {
+            break;
+        }
+        auto ip = queue.front();
+        queue.pop_front();
+        lock.unlock();
+
+        auto res = query(fd, ip);
+        nextQuery = Clock::now() + queryInterval;
+        if (res.has_value()) {
+            timeval now = {};
+            gettimeofday(&now, nullptr);
+            SPDLOG_DEBUG("Reverse resolved {} -> {}", ip.getAddrStr(), res->first);
+            if (ip.getIsV6()) {
+                ipToFqdn->updateFqdn(res->first, {}, { ip.getAddrV6() }, res->second, now);
+            } else {
+                ipToFqdn->updateFqdn(res->first, { ip.getAddrV4() }, {}, res->second, now);
+            }
+            resolved.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            failed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        lock.lock();
+        pending.erase(ip);
+        if (!res.has_value()) {
+            if (negativeCache.size() >= REVERSE_DNS_MAX_NEGATIVE) {
+                negativeCache.clear();
+            }
+            negativeCache[ip] = Clock::now() + std::chrono::seconds(REVERSE_DNS_NEGATIVE_TTL_S);
+        }
+    }
+    close(fd);
+}
+
+auto ReverseResolver::query(int fd, IPAddress const& ip) -> std::optional<std::pair<std::string, uint32_t>>
+{
+    auto name = ptrName(ip);
+    auto id = ++nextId;
+    Tins::DNS request;
+    request.id(id);
+    request.type(Tins::DNS::QUERY);
+    request.recursion_desired(1);
+    request.add_query(Tins::DNS::query(name, Tins::DNS::PTR, Tins::DNS::INTERNET));
+    auto buffer = request.serialize();
+    if (send(fd, buffer.data(), buffer.size(), 0) < 0) {
+        return {};
+    }
+
+    // Skip stale answers of timed out queries
+    auto deadline = Clock::now() + std::chrono::milliseconds(REVERSE_DNS_TIMEOUT_MS);
+    std::array<uint8_t, 4096> response;
+    while (true) {
+        auto remainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        pollfd pfd = { fd, POLLIN, 0 };
+        if (remainingMs <= 0 || poll(&pfd, 1, remainingMs) <= 0) {
+            return {};
+        }
+        auto len = recv(fd, response.data(), response.size(), 0);
+        if (len <= 0) {
+            return {};
+        }
+        try {
+            Tins::DNS dns(response.data(), len);
+            if (dns.id() != id || dns.type() != Tins::DNS::RESPONSE) {
+                continue;
+            }
+            for (auto const& answer : dns.answers()) {
+                if (answer.query_type() == Tins::DNS::PTR && !answer.data().empty()) {
+                    return std::make_pair(answer.data(), answer.ttl());
+                }
+            }
+            return {};
+        } catch (std::exception const& e) {
+            SPDLOG_DEBUG("Invalid reverse dns response: {}", e.what());
+        }
+    }
+}
+
+} // namespace flowstats
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "IPAddress.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace flowstats {
+
+class IpToFqdn;
+
+// Addresses waiting for a PTR query, new ones are dropped beyond
+size_t const REVERSE_DNS_MAX_PENDING = 4096;
+// Failed addresses are not queried again for this long
+uint32_t const REVERSE_DNS_NEGATIVE_TTL_S = 300;
+size_t const REVERSE_DNS_MAX_NEGATIVE = 65536;
+uint32_t const REVERSE_DNS_TIMEOUT_MS = 1000;
+uint32_t const REVERSE_DNS_QPS = 20;
+
+struct ReverseResolverStats {
+    uint64_t queued = 0;
+    uint64_t dropped = 0;
+    uint64_t resolved = 0;
+    uint64_t failed = 0;
+};
+
+/**
+ * Resolve the addresses without fqdn with PTR queries to a dns server
+ * and add the names to IpToFqdn.
+ *
+ * Queries are sent from a background thread at most qps per second.
+ * enqueue is called from the packet path and never waits: an address is
+ * dropped when the queue is contended or full.
+ */
+class ReverseResolver {
+public:
+    /**
+     * server is "ip", "ip:port" or "[ipv6]:port"
+     */
+    ReverseResolver(IpToFqdn* ipToFqdn, std::string const& server,
+        uint32_t qps = REVERSE_DNS_QPS);
+    ~ReverseResolver();
+    ReverseResolver(ReverseResolver const&) = delete;
+    auto operator=(ReverseResolver const&) -> ReverseResolver& = delete;
+
+    auto enqueue(IPAddress const& ip) -> void;
+
+    [[nodiscard]] auto getStats() const -> ReverseResolverStats;
+
+    /**
+     * Name of the PTR record of ip, like 4.3.2.1.in-addr.arpa
+     */
+    static auto ptrName(IPAddress const& ip) -> std::string;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    auto resolverLoop() -> void;
+    /**
+     * Name and ttl of ip, empty on failure
+     */
+    auto query(int fd, IPAddress const& ip) -> std::optional<std::pair<std::string, uint32_t>>;
+
+    IpToFqdn* ipToFqdn;
+    sockaddr_storage serverAddr = {};
+    socklen_t serverAddrLen = 0;
+    Clock::duration queryInterval;
+    uint16_t nextId = 0;
+
+    // Guards the queue, the pending and negative sets and stop
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<IPAddress> queue;
+    std::unordered_set<IPAddress> pending;
+    std::unordered_map<IPAddress, Clock::time_point> negativeCache;
+    bool stop = false;
+
+    std::atomic<uint64_t> queued = 0;
+    std::atomic<uint64_t> dropped = 0;
+    std::atomic<uint64_t> resolved = 0;
+    std::atomic<uint64_t> failed = 0;
+
+    std::thread resolver;
+};
+
+} // namespace flowstats
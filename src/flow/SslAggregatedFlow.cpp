@@ -4,8 +4,7 @@ namespace flowstats {
 
 auto SslAggregatedFlow::getFieldStr(Field field, Direction direction, int duration, int index) const -> std::string
 {
-    auto fqdn = getFqdn();
-    if (fqdn == "Total") {
+    if (getFqdnId() == FQDN_TOTAL) {
         if (direction == FROM_CLIENT || direction == MERGED) {
             switch (field) {
                 case Field::PORT:
@@ -58,6 +57,17 @@ void SslAggregatedFlow::resetFlow(bool resetTotal)
     }
 }
 
+auto SslAggregatedFlow::addAggregatedFlow(Flow const* flow) -> void
+{
+    Flow::addFlow(flow);
+
+    auto const* sslFlow = static_cast<const SslAggregatedFlow*>(flow);
+    numConnections += sslFlow->numConnections;
+    totalConnections += sslFlow->totalConnections;
+    connectionTimes.addPoints(sslFlow->connectionTimes);
+    totalConnectionTimes.addPoints(sslFlow->totalConnectionTimes);
+}
+
 auto SslAggregatedFlow::setTlsVersion(TLSVersion tlsVers) -> void
 {
     tlsVersion = tlsVers;
@@ -9,22 +9,30 @@ namespace flowstats {
 class SslAggregatedFlow : public Flow {
 public:
     SslAggregatedFlow()
-        : Flow("Total")
+        : Flow(FQDN_TOTAL)
         , tlsVersion(TLSVersion::UNKNOWN) {};
 
-    SslAggregatedFlow(FlowId const& flowId, std::string const& fqdn)
-        : Flow(flowId, fqdn)
+    SslAggregatedFlow(FlowId const& flowId, FqdnId fqdnId)
+        : Flow(flowId, fqdnId)
         , tlsVersion(TLSVersion::UNKNOWN) {};
 
     auto resetFlow(bool resetTotal) -> void override;
+    auto addAggregatedFlow(Flow const* flow) -> void override;
+    auto mergePercentiles() -> void override
+    {
+        connectionTimes.merge();
+        totalConnectionTimes.merge();
+    };
+    [[nodiscard]] auto clone() const -> Flow* override { return new SslAggregatedFlow(*this); };
+    auto copyTo(Flow* dst) const -> void override { *static_cast<SslAggregatedFlow*>(dst) = *this; };
     auto setTlsVersion(TLSVersion tlsVers) -> void;
-    auto setDomain(std::string _domain) -> void { domain = std::move(_domain); }
+    // Reuses the string capacity when the domain doesn't grow
+    auto setDomain(std::string_view _domain) -> void { domain.assign(_domain); }
     auto setSslCipherSuite(SSLCipherSuite _sslCipherSuite) -> void { sslCipherSuite = _sslCipherSuite; }
     auto addConnection(int delta) -> void;
-    auto merge() -> void { connectionTimes.merge(); };
 
     [[nodiscard]] auto getFieldStr(Field field, Direction direction, int duration, int index) const -> std::string override;
-    [[nodiscard]] auto getDomain() const { return domain; }
+    [[nodiscard]] auto getDomain() const -> std::string const& { return domain; }
 
     [[nodiscard]] static auto sortByConnections(Flow const* a, Flow const* b) -> bool
     {
@@ -1,10 +1,9 @@
 #include "SslFlow.hpp"
 #include "SslProto.hpp"
-#include <tins/rawpdu.h>
 
 namespace flowstats {
 
-auto SslFlow::addPacket(Tins::Packet const& packet, Direction const direction) -> void
+auto SslFlow::addPacket(PacketView const& packet, Direction const direction) -> void
 {
     Flow::addPacket(packet, direction);
     for (auto& subflow : aggregatedFlows) {
@@ -12,19 +11,16 @@ auto SslFlow::addPacket(Tins::Packet const& packet, Direction const direction) -
     }
 }
 
-auto SslFlow::updateFlow(Tins::Packet const& packet, Tins::TCP const& tcp) -> void
+auto SslFlow::updateFlow(PacketView const& packet) -> void
 {
     if (connectionEstablished) {
         return;
     }
 
-    auto const* rawData = tcp.find_pdu<Tins::RawPDU>();
-    if (rawData == nullptr) {
+    if (packet.getPayloadSize() == 0) {
         return;
     }
-
-    auto payload = rawData->payload();
-    auto cursor = Cursor(payload);
+    auto cursor = Cursor(packet.getPayload(), packet.getPayloadSize());
 
     auto mbTlsHeader = TlsHeader::parse(&cursor);
     if (!mbTlsHeader) {
@@ -53,7 +49,7 @@ auto SslFlow::updateFlow(Tins::Packet const& packet, Tins::TCP const& tcp) -> vo
     }
 }
 
-void SslFlow::processHandshake(Tins::Packet const& packet,
+void SslFlow::processHandshake(PacketView const& packet,
     Cursor* cursor)
 {
     auto mbTlsHandshake = TlsHandshake::parse(cursor);
@@ -63,7 +59,7 @@ void SslFlow::processHandshake(Tins::Packet const& packet,
     auto tlsHandshake = mbTlsHandshake.value();
 
     if (tlsHandshake.getHandshakeType() == +SSLHandshakeType::SSL_CLIENT_HELLO) {
-        startHandshake = packetToTimeval(packet);
+        startHandshake = packet.getTimestamp();
         SPDLOG_DEBUG("Start ssl connection at {}", timevalInMs(startHandshake));
 
         for (auto* aggregatedSslFlow : aggregatedFlows) {
@@ -78,14 +74,14 @@ void SslFlow::processHandshake(Tins::Packet const& packet,
     }
 }
 
-void SslFlow::processChangeCipherSpec(Tins::Packet const& packet,
+void SslFlow::processChangeCipherSpec(PacketView const& packet,
     Cursor* cursor)
 {
     if (checkSslChangeCipherSpec(cursor) == false) {
         return;
     }
     connectionEstablished = true;
-    uint32_t delta = getTimevalDeltaMs(startHandshake, packetToTimeval(packet));
+    uint32_t delta = getTimevalDeltaMs(startHandshake, packet.getTimestamp());
     for (auto* aggregatedSslFlow : aggregatedFlows) {
         aggregatedSslFlow->addConnection(delta);
     }
@@ -8,27 +8,29 @@
 
 namespace flowstats {
 
+// The aggregated flow and the total
+typedef std::array<SslAggregatedFlow*, 2> SslAggregatedFlows;
+
 class SslFlow : public Flow {
 public:
     SslFlow()
         : Flow() {};
     SslFlow(FlowId const& flowId,
-        std::string const& fqdn,
-        std::vector<SslAggregatedFlow*> _aggregatedFlows)
-        : Flow(flowId, fqdn)
-        , aggregatedFlows(std::move(_aggregatedFlows)) {};
+        FqdnId fqdnId,
+        SslAggregatedFlows _aggregatedFlows)
+        : Flow(flowId, fqdnId)
+        , aggregatedFlows(_aggregatedFlows) {};
 
-    void updateFlow(Tins::Packet const& packet,
-        Tins::TCP const& sslLayer);
+    void updateFlow(PacketView const& packet);
 
-    auto addPacket(Tins::Packet const& packet, Direction const direction) -> void override;
+    auto addPacket(PacketView const& packet, Direction const direction) -> void override;
 
 private:
-    void processHandshake(Tins::Packet const& packet, Cursor* cursor);
-    void processChangeCipherSpec(Tins::Packet const& packet,
+    void processHandshake(PacketView const& packet, Cursor* cursor);
+    void processChangeCipherSpec(PacketView const& packet,
         Cursor* cursor);
 
-    std::vector<SslAggregatedFlow*> aggregatedFlows;
+    SslAggregatedFlows aggregatedFlows = {};
     TLSVersion tlsVersion = TLSVersion::UNKNOWN;
     timeval startHandshake = {};
     bool connectionEstablished = false;
@@ -19,7 +19,7 @@ auto parseTlsVersion(Cursor* cursor) -> std::optional<TLSVersion>
     return mbVersion.value();
 }
 
-auto getSslDomainFromSni(Cursor* cursor) -> std::optional<std::string>
+auto getSslDomainFromSni(Cursor* cursor) -> std::optional<std::string_view>
 {
     auto listLength = cursor->read_be<uint16_t>();
     RETURN_EMPTY_IF_EMPTY(listLength);
@@ -45,7 +45,7 @@ auto getSslDomainFromSni(Cursor* cursor) -> std::optional<std::string>
     return "";
 }
 
-auto TlsHandshake::getSslDomainFromExtension(Cursor* cursor) -> std::optional<std::string>
+auto TlsHandshake::getSslDomainFromExtension(Cursor* cursor) -> std::optional<std::string_view>
 {
     auto length = cursor->read_be<uint16_t>();
     int initialSize = cursor->remainingBytes();
@@ -146,7 +146,7 @@ TlsHandshake::TlsHandshake(SSLHandshakeType handshakeType, uint16_t length, TLSV
         }
 
         auto extractedDomain = getSslDomainFromExtension(cursor);
-        if (extractedDomain.value_or("") != "") {
+        if (!extractedDomain.value_or("").empty()) {
             domain = extractedDomain.value();
         }
     } else if (handshakeType == +SSLHandshakeType::SSL_SERVER_HELLO) {
@@ -388,12 +388,13 @@ public:
 
 private:
     auto processClientHello(Cursor* cursor) -> void;
-    [[nodiscard]] auto getSslDomainFromExtension(Cursor* cursor) -> std::optional<std::string>;
+    [[nodiscard]] auto getSslDomainFromExtension(Cursor* cursor) -> std::optional<std::string_view>;
 
     SSLHandshakeType handshakeType;
     uint16_t length;
     TLSVersion version;
-    std::string domain;
+    // Points in the packet payload
+    std::string_view domain;
     SSLCipherSuite sslCipherSuite = SSLCipherSuite::NULL_WITH_NULL_NULL;
 };
 
@@ -14,33 +14,32 @@ TcpAggregatedFlow::~TcpAggregatedFlow()
     totalRequestSizes.resetAndShrink();
 }
 
-auto TcpAggregatedFlow::updateFlow(Tins::Packet const& packet,
-    FlowId const& flowId,
-    Tins::TCP const& tcp) -> void
+auto TcpAggregatedFlow::updateFlow(PacketView const& packet,
+    FlowId const& flowId) -> void
 {
     auto direction = flowId.getDirection();
-    if (tcp.has_flags(Tins::TCP::RST)) {
+    if (packet.hasFlags(Tins::TCP::RST)) {
         rsts[direction]++;
         totalRsts[direction]++;
     }
 
-    if (tcp.window() == 0 && !tcp.has_flags(Tins::TCP::RST)) {
+    if (packet.getWindow() == 0 && !packet.hasFlags(Tins::TCP::RST)) {
         zeroWins[direction]++;
         totalZeroWins[direction]++;
     }
 
-    if (tcp.has_flags(Tins::TCP::SYN | Tins::TCP::ACK)) {
+    if (packet.hasFlags(Tins::TCP::SYN | Tins::TCP::ACK)) {
         synAcks[direction]++;
         totalSynAcks[direction]++;
-    } else if (tcp.has_flags(Tins::TCP::SYN)) {
+    } else if (packet.hasFlags(Tins::TCP::SYN)) {
         syns[direction]++;
         totalSyns[direction]++;
-    } else if (tcp.has_flags(Tins::TCP::FIN)) {
+    } else if (packet.hasFlags(Tins::TCP::FIN)) {
         fins[direction]++;
         totalFins[direction]++;
     }
     mtu[direction] = std::max(mtu[direction],
-        packet.pdu()->advertised_size());
+        packet.getAdvertisedSize());
 }
 
 auto TcpAggregatedFlow::getSubfieldSize(Field field) const -> int
@@ -49,7 +48,7 @@ auto TcpAggregatedFlow::getSubfieldSize(Field field) const -> int
         case Field::TOP_CLIENT_IPS_IP:
         case Field::TOP_CLIENT_IPS_BYTES:
         case Field::TOP_CLIENT_IPS_PKTS:
-            return std::min(5, static_cast<int>(sourceIpToStats.size()));
+            return std::min(5, static_cast<int>(clientIpStats.size()));
         default:
             return 0;
     }
@@ -60,31 +59,14 @@ auto TcpAggregatedFlow::prepareSubfields(std::vector<Field> const& subfields) ->
 {
     for (auto field : subfields) {
         if (field == +Field::TOP_CLIENT_IPS_IP) {
-            computeTopClientIps(TrafficStatsTcp::PKTS);
+            computeTopClientIps();
         }
     }
 }
 
-auto TcpAggregatedFlow::computeTopClientIps(TrafficStatsTcp::TrafficType type) -> void
+auto TcpAggregatedFlow::computeTopClientIps() -> void
 {
-    int size = std::min(5, static_cast<int>(sourceIpToStats.size()));
-    topClientIps = std::vector<std::pair<IPAddress, TrafficStatsTcp>>(size);
-
-    bool (*sortFun)(std::pair<IPAddress, TrafficStatsTcp> const& l,
-        std::pair<IPAddress, TrafficStatsTcp> const& r)
-        = [](std::pair<IPAddress, TrafficStatsTcp> const& l,
-              std::pair<IPAddress, TrafficStatsTcp> const& r) {
-              return l.second.bytes > r.second.bytes;
-          };
-
-    if (type == TrafficStatsTcp::PKTS) {
-        sortFun = [](std::pair<IPAddress, TrafficStatsTcp> const& l,
-                      std::pair<IPAddress, TrafficStatsTcp> const& r) {
-            return l.second.pkts > r.second.pkts;
-        };
-    }
-    std::partial_sort_copy(sourceIpToStats.begin(), sourceIpToStats.end(),
-        topClientIps.begin(), topClientIps.end(), sortFun);
+    topClientIps = clientIpStats.top(5);
 }
 
 auto TcpAggregatedFlow::getTopClientIpsKey(int index) const -> std::string
@@ -116,8 +98,7 @@ auto TcpAggregatedFlow::getFieldStr(Field field, Direction direction, int durati
         }
     }
 
-    auto fqdn = getFqdn();
-    if (fqdn == "Total") {
+    if (getFqdnId() == FQDN_TOTAL) {
         if (direction == FROM_CLIENT || direction == MERGED) {
             switch (field) {
                 case Field::PORT: return "-";
@@ -227,19 +208,17 @@ auto TcpAggregatedFlow::addAggregatedFlow(Flow const* flow) -> void
     Flow::addFlow(flow);
 
     auto const* tcpFlow = static_cast<const TcpAggregatedFlow*>(flow);
-    for (auto const& sourceIt : tcpFlow->sourceIpToStats) {
-        auto* stats = &sourceIpToStats[sourceIt.first];
-        stats->bytes += sourceIt.second.bytes;
-        stats->pkts += sourceIt.second.pkts;
-    }
+    clientIpStats.merge(tcpFlow->clientIpStats);
 
     for (int i = 0; i <= FROM_SERVER; ++i) {
         syns[i] += tcpFlow->syns[i];
+        synAcks[i] += tcpFlow->synAcks[i];
         fins[i] += tcpFlow->fins[i];
         rsts[i] += tcpFlow->rsts[i];
         zeroWins[i] += tcpFlow->zeroWins[i];
 
         totalSyns[i] += tcpFlow->totalSyns[i];
+        totalSynAcks[i] += tcpFlow->totalSynAcks[i];
         totalFins[i] += tcpFlow->totalFins[i];
         totalRsts[i] += tcpFlow->totalRsts[i];
         totalZeroWins[i] += tcpFlow->totalZeroWins[i];
@@ -262,8 +241,9 @@ auto TcpAggregatedFlow::addAggregatedFlow(Flow const* flow) -> void
     connectionTimes.addPoints(tcpFlow->connectionTimes);
     totalConnectionTimes.addPoints(tcpFlow->totalConnectionTimes);
     srts.addPoints(tcpFlow->srts);
-    totalSrts.addPoints(tcpFlow->srts);
+    totalSrts.addPoints(tcpFlow->totalSrts);
     requestSizes.addPoints(tcpFlow->requestSizes);
+    totalRequestSizes.addPoints(tcpFlow->totalRequestSizes);
 }
 
 auto TcpAggregatedFlow::resetFlow(bool resetTotal) -> void
@@ -299,7 +279,7 @@ auto TcpAggregatedFlow::resetFlow(bool resetTotal) -> void
         totalConnectionTimes.reset();
         totalRequestSizes.reset();
 
-        sourceIpToStats.clear();
+        clientIpStats.clear();
     }
 
     connectionTimes.reset();
@@ -309,6 +289,8 @@ auto TcpAggregatedFlow::resetFlow(bool resetTotal) -> void
 
 auto TcpAggregatedFlow::failConnection() -> void
 {
+    // Flows can fail or close on timeout, without any packet
+    setChanged(true);
     failedConnections++;
 };
 
@@ -338,7 +320,7 @@ auto TcpAggregatedFlow::openConnection(int connectionTime) -> void
 
 auto TcpAggregatedFlow::addCltPacket(IPAddress const& cltIp, int numBytes) -> void
 {
-    auto* stats = &sourceIpToStats[cltIp];
+    auto* stats = clientIpStats.add(cltIp, 1);
     stats->bytes += numBytes;
     stats->pkts++;
 };
@@ -354,6 +336,7 @@ auto TcpAggregatedFlow::addSrt(int srt, int dataSize) -> void
 
 auto TcpAggregatedFlow::closeConnection() -> void
 {
+    setChanged(true);
     closes++;
     totalCloses++;
     activeConnections--;
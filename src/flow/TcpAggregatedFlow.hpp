@@ -3,6 +3,7 @@
 #include "AggregatedKeys.hpp"
 #include "Field.hpp"
 #include "Flow.hpp"
+#include "HeavyHitters.hpp"
 #include "Stats.hpp"
 #include <map>
 
@@ -17,18 +18,25 @@ public:
         BYTES,
         PKTS,
     };
+
+    auto operator+=(TrafficStatsTcp const& other) -> TrafficStatsTcp&
+    {
+        bytes += other.bytes;
+        pkts += other.pkts;
+        return *this;
+    }
 };
 
 class TcpAggregatedFlow : public Flow {
 public:
     TcpAggregatedFlow()
-        : Flow("Total") {};
+        : Flow(FQDN_TOTAL) {};
 
-    TcpAggregatedFlow(FlowId const& flowId, std::string const& fqdn)
-        : Flow(flowId, fqdn) {};
+    TcpAggregatedFlow(FlowId const& flowId, FqdnId fqdnId)
+        : Flow(flowId, fqdnId) {};
 
-    TcpAggregatedFlow(FlowId const& flowId, std::string const& fqdn, uint8_t srvDir)
-        : Flow(flowId, fqdn, srvDir) {};
+    TcpAggregatedFlow(FlowId const& flowId, FqdnId fqdnId, uint8_t srvDir)
+        : Flow(flowId, fqdnId, srvDir) {};
 
     ~TcpAggregatedFlow() override;
 
@@ -37,14 +45,15 @@ public:
         return totalSyns[0] < b.totalSyns[0];
     }
 
-    auto updateFlow(Tins::Packet const& packet,
-        FlowId const& flowId,
-        Tins::TCP const& tcpLayer) -> void;
+    auto updateFlow(PacketView const& packet,
+        FlowId const& flowId) -> void;
 
     auto resetFlow(bool resetTotal) -> void override;
     auto addAggregatedFlow(Flow const* flow) -> void override;
     auto mergePercentiles() -> void override;
     auto prepareSubfields(std::vector<Field> const& fields) -> void override;
+    [[nodiscard]] auto clone() const -> Flow* override { return new TcpAggregatedFlow(*this); };
+    auto copyTo(Flow* dst) const -> void override { *static_cast<TcpAggregatedFlow*>(dst) = *this; };
 
     auto failConnection() -> void;
     auto closeConnection() -> void;
@@ -234,7 +243,7 @@ public:
     }
 
 private:
-    auto computeTopClientIps(TrafficStatsTcp::TrafficType type) -> void;
+    auto computeTopClientIps() -> void;
     [[nodiscard]] auto getTopClientIpsKey(int index) const -> std::string;
     [[nodiscard]] auto getTopClientIpsValue(TrafficStatsTcp::TrafficType type, int index) const -> std::string;
     std::vector<std::pair<IPAddress, TrafficStatsTcp>> topClientIps;
@@ -253,7 +262,8 @@ private:
 
     std::array<uint32_t, 2> mtu = {};
 
-    std::map<IPAddress, TrafficStatsTcp> sourceIpToStats;
+    // Clients ranked by packets
+    HeavyHitters<IPAddress, TrafficStatsTcp, 32> clientIpStats;
 
     int closes = 0;
     int totalCloses = 0;
@@ -1,82 +1,90 @@
 #include "TcpFlow.hpp"
-#include "PduUtils.hpp"
 #include "Utils.hpp"
 
 namespace flowstats {
 
-auto TcpFlow::timeoutFlow() -> void
+auto TcpFlow::getOldestPacketMs() const -> uint64_t
 {
-    if (opening) {
+    auto oldestMs = std::numeric_limits<uint32_t>::max();
+    for (auto direction : { FROM_CLIENT, FROM_SERVER }) {
+        if (hasFlag(HAD_PACKET, direction)) {
+            oldestMs = std::min(oldestMs, lastPacketMs[direction]);
+        }
+    }
+    if (oldestMs == std::numeric_limits<uint32_t>::max()) {
+        oldestMs = 0;
+    }
+    return startMs + oldestMs;
+}
+
+auto TcpFlow::timeoutFlow(TcpAggregatedFlows const& aggregatedFlows) -> void
+{
+    if (hasFlag(OPENING)) {
         for (auto& subflow : aggregatedFlows) {
             subflow->failConnection();
         }
     }
-    if (opened) {
-        closeConnection();
+    if (hasFlag(OPENED)) {
+        closeConnection(aggregatedFlows);
     }
 }
 
-auto TcpFlow::closeConnection() -> void
+auto TcpFlow::closeConnection(TcpAggregatedFlows const& aggregatedFlows) -> void
 {
-    if (opened) {
-        SPDLOG_DEBUG("Closing connection {}", getFlowId().toString());
+    if (hasFlag(OPENED)) {
         for (auto& aggregatedFlow : aggregatedFlows) {
             aggregatedFlow->closeConnection();
         }
     }
-    closed = true;
-    opened = false;
-    opening = false;
+    // Only the server position and the last packet times survive a close
+    flags &= SRV_POS | (HAD_PACKET << FROM_CLIENT) | (HAD_PACKET << FROM_SERVER) | LAST_DIRECTION;
+    setFlag(CLOSED, true);
 
-    synTime = {};
+    synMs = {};
     seqNum = {};
     finSeqnum = {};
-    hadPacket = {};
-    finAcked = {};
-    synAcked = {};
-    closeTime = {};
-    lastPayloadTime = {};
+    lastPayloadMs = 0;
 }
 
-auto TcpFlow::nextSeqnum(Tins::TCP const& tcp, int tcpPayloadSize) -> uint32_t
+auto TcpFlow::nextSeqnum(PacketView const& packet, int tcpPayloadSize) -> uint32_t
 {
-    return tcp.seq() + tcpPayloadSize + tcp.has_flags(Tins::TCP::SYN) + tcp.has_flags(Tins::TCP::FIN);
+    return packet.getSeq() + tcpPayloadSize + packet.hasFlags(Tins::TCP::SYN) + packet.hasFlags(Tins::TCP::FIN);
 }
 
-auto TcpFlow::updateFlow(Tins::Packet const& packet, Direction direction,
-    Tins::IP const* ip,
-    Tins::IPv6 const* ipv6,
-    Tins::TCP const& tcp) -> void
+auto TcpFlow::updateFlow(PacketView const& packet, FlowId const& flowId,
+    TcpAggregatedFlows const& aggregatedFlows) -> void
 {
-    auto const flags = tcp.flags();
-    timeval tv = packetToTimeval(packet);
-
-    int tcpPayloadSize = getTcpPayloadSize(ip, ipv6, tcp);
-    lastPacketTime[direction] = tv;
-    uint32_t nextSeq = std::max(seqNum[direction], nextSeqnum(tcp, tcpPayloadSize));
+    auto const packetFlags = packet.getTcpFlags();
+    timeval const& tv = packet.getTimestamp();
+    auto const direction = flowId.getDirection();
+    auto const srvPos = getSrvPos();
+    auto const nowMs = relativeMs(tv);
+
+    int tcpPayloadSize = packet.getWirePayloadSize();
+    lastPacketMs[direction] = nowMs;
+    setFlag(HAD_PACKET, direction, true);
+    uint32_t nextSeq = std::max(seqNum[direction], nextSeqnum(packet, tcpPayloadSize));
     SPDLOG_DEBUG("Update flow {}, nextSeq {}, ts {}ms, direction {}, tcp {}, payload {}",
-        getFlowId().toString(), nextSeq, timevalInMs(tv), direction,
-        tcpToString(tcp), tcpPayloadSize);
-
-    auto currentDirection = static_cast<Direction>(direction == getSrvPort());
-    if (flags & Tins::TCP::SYN) {
-        synTime[direction] = tv;
-        opening = true;
-        closed = false;
+        flowId.toString(), nextSeq, timevalInMs(tv), direction,
+        tcpToString(packet), tcpPayloadSize);
+
+    auto currentDirection = static_cast<Direction>(direction == srvPos);
+    if (packetFlags & Tins::TCP::SYN) {
+        synMs[direction] = nowMs;
+        setFlag(OPENING, true);
+        setFlag(CLOSED, false);
         SPDLOG_DEBUG("Got syn for direction {}, srvPort {}, ts {}ms",
-            directionToString(currentDirection), getSrvPort(), timevalInMs(tv));
+            directionToString(currentDirection), flowId.getPort(srvPos), timevalInMs(tv));
     }
 
-    if (!opened && flags & Tins::TCP::ACK && tcp.ack_seq() == seqNum[!direction]
-        && synAcked[direction] == false) {
+    if (!hasFlag(OPENED) && packetFlags & Tins::TCP::ACK && packet.getAckSeq() == seqNum[!direction]
+        && !hasFlag(SYN_ACKED, direction)) {
         SPDLOG_DEBUG("syn acked for direction {}", directionToString(currentDirection));
-        synAcked[direction] = true;
-        if (synAcked[!direction]) {
-            timeval start = synTime[direction];
-            timeval end = tv;
-            uint32_t connectionTime = getTimevalDeltaMs(start, end);
-            opened = true;
-            opening = false;
+        setFlag(SYN_ACKED, direction, true);
+        if (hasFlag(SYN_ACKED, static_cast<Direction>(!direction))) {
+            uint32_t connectionTime = nowMs - synMs[direction];
+            setFlag(OPENED, true);
+            setFlag(OPENING, false);
             SPDLOG_DEBUG("Full tcp handshake, connection is now opened, ct {}", connectionTime);
             for (auto& aggregatedFlow : aggregatedFlows) {
                 aggregatedFlow->openConnection(connectionTime);
@@ -84,32 +92,33 @@ auto TcpFlow::updateFlow(Tins::Packet const& packet, Direction direction,
         }
     }
 
-    if (!(flags & Tins::TCP::RST)) {
+    if (!(packetFlags & Tins::TCP::RST)) {
         seqNum[direction] = std::max(seqNum[direction], nextSeq);
     } else {
-        opening = false;
-        lastPayloadTime = { 0, 0 };
+        setFlag(OPENING, false);
+        setFlag(HAD_PAYLOAD, false);
     }
 
-    uint32_t ackNumber = tcp.ack_seq();
+    uint32_t ackNumber = packet.getAckSeq();
     if (seqNum[!direction] > 0 && ackNumber > seqNum[!direction]) {
         SPDLOG_DEBUG("Got a gap, ack {}, expected seqNum {}", ackNumber, seqNum[!direction]);
         gap++;
         requestSize = 0;
-        lastPayloadTime = { 0, 0 };
-        opening = false;
+        setFlag(HAD_PAYLOAD, false);
+        setFlag(OPENING, false);
         seqNum[!direction] = std::max(seqNum[!direction], ackNumber);
-    } else if (!tcp.has_flags(Tins::TCP::SYN) && !tcp.has_flags(Tins::TCP::RST) && !opened && !opening && seqNum[!direction] == ackNumber) {
+    } else if (!packet.hasFlags(Tins::TCP::SYN) && !packet.hasFlags(Tins::TCP::RST) && !hasFlag(OPENED) && !hasFlag(OPENING) && seqNum[!direction] == ackNumber) {
         SPDLOG_DEBUG("Detected ongoing conversation");
-        opened = true;
+        setFlag(OPENED, true);
         for (auto& aggregatedFlow : aggregatedFlows) {
             aggregatedFlow->ongoingConnection();
         }
     }
 
     if (tcpPayloadSize > 0) {
-        if (lastDirection != direction && direction == getSrvPos() && lastPayloadTime.tv_sec > 0) {
-            uint32_t delta = getTimevalDeltaMs(lastPayloadTime, tv);
+        auto lastDirection = static_cast<Direction>(hasFlag(LAST_DIRECTION));
+        if (lastDirection != direction && direction == srvPos && hasFlag(HAD_PAYLOAD)) {
+            uint32_t delta = nowMs - lastPayloadMs;
             SPDLOG_DEBUG("Change of direction to {}, srt {}, requestSize {}",
                 directionToString(currentDirection),
                 delta, requestSize);
@@ -117,48 +126,50 @@ auto TcpFlow::updateFlow(Tins::Packet const& packet, Direction direction,
                 aggregatedFlow->addSrt(delta, requestSize);
             }
         }
-        lastPayloadTime = tv;
-        lastDirection = direction;
-        if (direction == getSrvPos()) {
+        lastPayloadMs = nowMs;
+        setFlag(HAD_PAYLOAD, true);
+        setFlag(LAST_DIRECTION, direction == FROM_SERVER);
+        if (direction == srvPos) {
             requestSize = 0;
         } else {
             requestSize += tcpPayloadSize;
         }
     }
 
-    if (tcp.has_flags(Tins::TCP::FIN)) {
-        uint32_t nextSeq = nextSeqnum(tcp, tcpPayloadSize);
+    if (packet.hasFlags(Tins::TCP::FIN)) {
+        uint32_t nextSeq = nextSeqnum(packet, tcpPayloadSize);
         SPDLOG_DEBUG("Got fin for direction {}, ts {}ms, nextSeq {}, ack {}",
-            directionToString(currentDirection), timevalInMs(tv), nextSeq, tcp.ack_seq());
+            directionToString(currentDirection), timevalInMs(tv), nextSeq, packet.getAckSeq());
         finSeqnum[direction] = nextSeq;
     }
 
-    if (tcp.has_flags(Tins::TCP::ACK)
-        && tcp.ack_seq() == finSeqnum[!direction]
-        && finAcked[direction] == false) {
-        finAcked[direction] = true;
-        if (finAcked[!direction]) {
-            closeConnection();
+    if (packet.hasFlags(Tins::TCP::ACK)
+        && packet.getAckSeq() == finSeqnum[!direction]
+        && !hasFlag(FIN_ACKED, direction)) {
+        setFlag(FIN_ACKED, direction, true);
+        if (hasFlag(FIN_ACKED, static_cast<Direction>(!direction))) {
+            closeConnection(aggregatedFlows);
         }
     }
 
-    if (tcp.has_flags(Tins::TCP::RST) && closed == false) {
-        closeConnection();
+    if (packet.hasFlags(Tins::TCP::RST) && !hasFlag(CLOSED)) {
+        closeConnection(aggregatedFlows);
     }
 
-    if (tcp.has_flags(Tins::TCP::SYN) && opening == false) {
-        opening = true;
+    if (packet.hasFlags(Tins::TCP::SYN) && !hasFlag(OPENING)) {
+        setFlag(OPENING, true);
     }
 
+    auto cltIp = flowId.getIp(!srvPos);
     for (auto& aggregatedFlow : aggregatedFlows) {
-        aggregatedFlow->addCltPacket(getCltIpInt(), packet.pdu()->advertised_size());
+        aggregatedFlow->addCltPacket(cltIp, packet.getAdvertisedSize());
     }
 }
 
-auto TcpFlow::tcpToString(Tins::TCP const& tcp) -> std::string
+auto TcpFlow::tcpToString(PacketView const& packet) -> std::string
 {
     std::string tcpFlag;
-    auto flags = tcp.flags();
+    auto flags = packet.getTcpFlags();
     if (flags & Tins::TCP::SYN) {
         if (flags & Tins::TCP::ACK) {
             tcpFlag = "[SYN, ACK], ";
@@ -177,8 +188,8 @@ auto TcpFlow::tcpToString(Tins::TCP const& tcp) -> std::string
         tcpFlag = "[RST], ";
     }
     return fmt::format("{}seq={}, ack={}, opened={}",
-        tcpFlag, tcp.seq(),
-        tcp.ack_seq(),
-        opened);
+        tcpFlag, packet.getSeq(),
+        packet.getAckSeq(),
+        hasFlag(OPENED));
 }
 } // namespace flowstats
@@ -1,59 +1,94 @@
 #pragma once
 
-#include "Flow.hpp"
-#include "Stats.hpp"
+#include "FlowId.hpp"
+#include "PacketView.hpp"
 #include "TcpAggregatedFlow.hpp"
+#include "Utils.hpp"
 
 namespace flowstats {
 
-class TcpFlow : public Flow {
+// The aggregated flow and the total, fixed so creating a flow doesn't allocate
+typedef std::array<TcpAggregatedFlow*, 2> TcpAggregatedFlows;
+
+/**
+ * Per connection state, one per entry of the tcp flow table.
+ *
+ * The flow id is the table key and the total is owned by the collector so
+ * only the aggregated flow is kept. Timestamps are ms relative to the
+ * first packet and flags are packed in a single word to keep a connection
+ * in one cache line.
+ */
+class TcpFlow {
 
 public:
-    TcpFlow()
-        : Flow() {};
-    TcpFlow(FlowId flowId,
-        uint8_t srvPos,
-        std::vector<TcpAggregatedFlow*> _aggregatedFlows)
-        : Flow(std::move(flowId), "", srvPos)
-        , aggregatedFlows(std::move(_aggregatedFlows))
+    TcpFlow() = default;
+    TcpFlow(uint8_t srvPos, TcpAggregatedFlow* aggregatedFlow, timeval start)
+        : aggregatedFlow(aggregatedFlow)
+        , startMs(timevalInMs(start))
     {
+        setFlag(SRV_POS, srvPos != 0);
     }
 
-    auto updateFlow(Tins::Packet const& packet, Direction direction,
-        Tins::IP const* ip,
-        Tins::IPv6 const* ipv6,
-        Tins::TCP const& tcp) -> void;
-    auto closeConnection() -> void;
-    auto timeoutFlow() -> void;
+    auto updateFlow(PacketView const& packet, FlowId const& flowId,
+        TcpAggregatedFlows const& aggregatedFlows) -> void;
+    auto closeConnection(TcpAggregatedFlows const& aggregatedFlows) -> void;
+    auto timeoutFlow(TcpAggregatedFlows const& aggregatedFlows) -> void;
 
-    [[nodiscard]] auto getTcpAggregatedFlows() const { return aggregatedFlows; }
-    [[nodiscard]] auto getLastPacketTime() const { return lastPacketTime; }
+    [[nodiscard]] auto getAggregatedFlow() const { return aggregatedFlow; }
+    [[nodiscard]] auto getSrvPos() const -> uint8_t { return hasFlag(SRV_POS); }
+    /**
+     * Time of the last packet of the most idle direction, the first packet
+     * if no direction was seen
+     */
+    [[nodiscard]] auto getOldestPacketMs() const -> uint64_t;
     [[nodiscard]] auto getGap() const { return gap; }
 
 private:
-    std::vector<TcpAggregatedFlow*> aggregatedFlows;
-    auto tcpToString(Tins::TCP const& hdr) -> std::string;
-    auto nextSeqnum(Tins::TCP const& tcp, int payloadSize) -> uint32_t;
+    enum Flags : uint16_t {
+        // Per direction flags, shifted by the direction
+        FIN_ACKED = 1 << 0,
+        SYN_ACKED = 1 << 2,
+        HAD_PACKET = 1 << 4,
+
+        CLOSED = 1 << 6,
+        OPENED = 1 << 7,
+        OPENING = 1 << 8,
+        // Direction of the last payload
+        LAST_DIRECTION = 1 << 9,
+        HAD_PAYLOAD = 1 << 10,
+        SRV_POS = 1 << 11,
+    };
+
+    [[nodiscard]] auto hasFlag(uint16_t flag) const -> bool { return (flags & flag) != 0; }
+    [[nodiscard]] auto hasFlag(Flags flag, Direction direction) const -> bool { return hasFlag(flag << direction); }
+    auto setFlag(uint16_t flag, bool value) -> void { flags = value ? flags | flag : flags & ~flag; }
+    auto setFlag(Flags flag, Direction direction, bool value) -> void { setFlag(flag << direction, value); }
+
+    // Packets older than the start are clamped to it
+    [[nodiscard]] auto relativeMs(timeval tv) const -> uint32_t
+    {
+        auto ms = timevalInMs(tv);
+        return ms > startMs ? static_cast<uint32_t>(ms - startMs) : 0;
+    }
+
+    auto tcpToString(PacketView const& packet) -> std::string;
+    auto nextSeqnum(PacketView const& packet, int payloadSize) -> uint32_t;
+
+    TcpAggregatedFlow* aggregatedFlow = nullptr;
+    uint64_t startMs = 0;
 
     std::array<uint32_t, 2> seqNum = {};
     std::array<uint32_t, 2> finSeqnum = {};
-    std::array<bool, 2> finAcked = {};
 
-    std::array<bool, 2> synAcked = {};
-    std::array<bool, 2> hadPacket = {};
+    std::array<uint32_t, 2> synMs = {};
+    std::array<uint32_t, 2> lastPacketMs = {};
+    uint32_t lastPayloadMs = 0;
 
     int requestSize = 0;
     int gap = 0;
+    uint16_t flags = 0;
+};
 
-    bool closed = false;
-    bool opened = false;
-    bool opening = false;
-
-    Direction lastDirection = FROM_CLIENT;
+static_assert(sizeof(TcpFlow) <= 64, "A tcp flow should fit in a cache line");
 
-    std::array<timeval, 2> synTime = {};
-    std::array<timeval, 2> closeTime = {};
-    std::array<timeval, 2> lastPacketTime = {};
-    timeval lastPayloadTime = {};
-};
 } // namespace flowstats
@@ -0,0 +1,231 @@
+#include "PacketRing.hpp"
+#include <spdlog/spdlog.h>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace flowstats {
+
+#ifdef __linux__
+
+PacketRing::~PacketRing()
+{
+    if (ring != nullptr) {
+        munmap(ring, ringSize);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+auto PacketRing::setupSocket() -> bool
+{
+    fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (fd < 0) {
+        spdlog::warn("Could not create packet socket: {}", strerror(errno));
+        return false;
+    }
+
+    int version = TPACKET_V3;
+    if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+        spdlog::warn("TPACKET_V3 is not supported: {}", strerror(errno));
+        return false;
+    }
+
+    uint32_t pageSize = getpagesize();
+    if (blockSize == 0 || blockSize % pageSize != 0 || blockCount == 0) {
+        spdlog::warn("Invalid ring geometry, block size {} should be a multiple of {}",
+            blockSize, pageSize);
+        return false;
+    }
+    // Frames are variable sized in V3, the frame size is only used by the
+    // kernel to check the block geometry
+    uint32_t frameSize = 1 << 11;
+    tpacket_req3 req = {};
+    req.tp_block_size = blockSize;
+    req.tp_block_nr = blockCount;
+    req.tp_frame_size = frameSize;
+    req.tp_frame_nr = (blockSize / frameSize) * blockCount;
+    req.tp_retire_blk_tov = 10;
+    if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+        spdlog::warn("Could not setup rx ring: {}", strerror(errno));
+        return false;
+    }
+
+    ringSize = static_cast<size_t>(blockSize) * blockCount;
+    auto* map = mmap(nullptr, ringSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_LOCKED, fd, 0);
+    if (map == MAP_FAILED) {
+        spdlog::warn("Could not mmap rx ring: {}", strerror(errno));
+        ringSize = 0;
+        return false;
+    }
+    ring = static_cast<uint8_t*>(map);
+
+    int ifIndex = 0;
+    if (!iface.empty() && iface != "any") {
+        ifIndex = if_nametoindex(iface.c_str());
+        if (ifIndex == 0) {
+            spdlog::warn("Unknown interface {}", iface);
+            return false;
+        }
+        packet_mreq mreq = {};
+        mreq.mr_ifindex = ifIndex;
+        mreq.mr_type = PACKET_MR_PROMISC;
+        if (setsockopt(fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            spdlog::warn("Could not set promisc mode on {}: {}", iface, strerror(errno));
+        }
+    }
+
+    sockaddr_ll addr = {};
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = ifIndex;
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        spdlog::warn("Could not bind packet socket to {}: {}", iface, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+auto PacketRing::attachFilter(std::string const& bpfFilter) -> bool
+{
+    if (bpfFilter.empty()) {
+        return true;
+    }
+    auto* deadHandle = pcap_open_dead(DLT_EN10MB, 1 << 16);
+    bpf_program program = {};
+    if (pcap_compile(deadHandle, &program, bpfFilter.c_str(), 1, PCAP_NETMASK_UNKNOWN) < 0) {
+        spdlog::error("Could not compile filter \"{}\": {}", bpfFilter, pcap_geterr(deadHandle));
+        pcap_close(deadHandle);
+        return false;
+    }
+    sock_fprog fprog = {};
+    fprog.len = program.bf_len;
+    fprog.filter = reinterpret_cast<sock_filter*>(program.bf_insns);
+    auto res = setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog));
+    if (res < 0) {
+        spdlog::warn("Could not attach filter: {}", strerror(errno));
+    }
+    pcap_freecode(&program);
+    pcap_close(deadHandle);
+    return res == 0;
+}
+
+auto PacketRing::open(std::string const& bpfFilter) -> bool
+{
+    if (!setupSocket()) {
+        return false;
+    }
+    if (!attachFilter(bpfFilter)) {
+        return false;
+    }
+    SPDLOG_INFO("Opened TPACKET_V3 ring on {} with {} blocks of {} bytes",
+        iface, blockCount, blockSize);
+    return true;
+}
+
+/**
+ * Share the traffic with the other sockets of the group. The kernel hashes
+ * flows symmetrically so both directions of a flow land on the same socket.
+ */
+auto PacketRing::joinFanout(uint16_t groupId) -> bool
+{
+    int fanoutArg = groupId | ((PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG) << 16);
+    if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &fanoutArg, sizeof(fanoutArg)) < 0) {
+        spdlog::error("Could not join fanout group {}: {}", groupId, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+auto PacketRing::waitBlock(int timeoutMs) -> uint8_t*
+{
+    auto* block = ring + static_cast<size_t>(currentBlock) * blockSize;
+    auto* desc = reinterpret_cast<tpacket_block_desc*>(block);
+    if ((__atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+        pollfd pfd = {};
+        pfd.fd = fd;
+        pfd.events = POLLIN | POLLERR;
+        poll(&pfd, 1, timeoutMs);
+        if ((__atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+            return nullptr;
+        }
+    }
+    return block;
+}
+
+auto PacketRing::releaseBlock(uint8_t* block) -> void
+{
+    auto* desc = reinterpret_cast<tpacket_block_desc*>(block);
+    __atomic_store_n(&desc->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    currentBlock = (currentBlock + 1) % blockCount;
+}
+
+auto PacketRing::blockNumFrames(uint8_t const* block) const -> uint32_t
+{
+    return reinterpret_cast<tpacket_block_desc const*>(block)->hdr.bh1.num_pkts;
+}
+
+auto PacketRing::blockFirstFrame(uint8_t const* block) const -> uint8_t const*
+{
+    auto const* desc = reinterpret_cast<tpacket_block_desc const*>(block);
+    return block + desc->hdr.bh1.offset_to_first_pkt;
+}
+
+auto PacketRing::readFrame(uint8_t const* frame, RingFrame* ringFrame) const -> uint8_t const*
+{
+    auto const* hdr = reinterpret_cast<tpacket3_hdr const*>(frame);
+    ringFrame->data = frame + hdr->tp_mac;
+    ringFrame->capLen = hdr->tp_snaplen;
+    ringFrame->wireLen = hdr->tp_len;
+    ringFrame->ts.tv_sec = hdr->tp_sec;
+    ringFrame->ts.tv_usec = hdr->tp_nsec / 1000;
+    return frame + hdr->tp_next_offset;
+}
+
+auto PacketRing::getCaptureStat() -> CaptureStat
+{
+    // Kernel counters are reset on each read, keep the running sum
+    std::lock_guard<std::mutex> lock(statMutex);
+    tpacket_stats_v3 stats = {};
+    socklen_t len = sizeof(stats);
+    if (fd >= 0 && getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) == 0) {
+        totalRecv += stats.tp_packets;
+        totalDrop += stats.tp_drops;
+    }
+    return CaptureStat(totalRecv, totalDrop, 0);
+}
+
+#else
+
+PacketRing::~PacketRing() = default;
+
+auto PacketRing::open(std::string const& /*bpfFilter*/) -> bool
+{
+    spdlog::warn("Packet ring is only available on linux");
+    return false;
+}
+
+auto PacketRing::joinFanout(uint16_t /*groupId*/) -> bool { return false; }
+auto PacketRing::waitBlock(int /*timeoutMs*/) -> uint8_t* { return nullptr; }
+auto PacketRing::releaseBlock(uint8_t* /*block*/) -> void {}
+auto PacketRing::blockNumFrames(uint8_t const* /*block*/) const -> uint32_t { return 0; }
+auto PacketRing::blockFirstFrame(uint8_t const* block) const -> uint8_t const* { return block; }
+auto PacketRing::readFrame(uint8_t const* frame, RingFrame* /*ringFrame*/) const -> uint8_t const* { return frame; }
+auto PacketRing::getCaptureStat() -> CaptureStat { return {}; }
+
+#endif
+
+} // namespace flowstats
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Stats.hpp"
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+
+namespace flowstats {
+
+struct RingFrame {
+    uint8_t const* data;
+    uint32_t capLen;
+    uint32_t wireLen;
+    timeval ts;
+};
+
+/**
+ * AF_PACKET TPACKET_V3 receive ring. The kernel fills whole blocks of
+ * frames which are handed back to userspace once retired, removing the
+ * per packet copy and syscall of the libpcap path.
+ */
+class PacketRing {
+public:
+    PacketRing(std::string iface, uint32_t blockSize, uint32_t blockCount)
+        : iface(std::move(iface))
+        , blockSize(blockSize)
+        , blockCount(blockCount) {};
+    virtual ~PacketRing();
+
+    PacketRing(PacketRing const&) = delete;
+    auto operator=(PacketRing const&) -> PacketRing& = delete;
+
+    auto open(std::string const& bpfFilter) -> bool;
+    auto joinFanout(uint16_t groupId) -> bool;
+
+    /**
+     * Wait up to timeoutMs for the next retired block and call
+     * processFrame on each of its frames before giving the block back to
+     * the kernel. Returns the number of frames processed.
+     */
+    template <typename F>
+    auto processNextBlock(int timeoutMs, F&& processFrame) -> int;
+
+    [[nodiscard]] auto getCaptureStat() -> CaptureStat;
+
+private:
+    auto setupSocket() -> bool;
+    auto attachFilter(std::string const& bpfFilter) -> bool;
+    auto waitBlock(int timeoutMs) -> uint8_t*;
+    auto releaseBlock(uint8_t* block) -> void;
+    auto blockNumFrames(uint8_t const* block) const -> uint32_t;
+    auto blockFirstFrame(uint8_t const* block) const -> uint8_t const*;
+    auto readFrame(uint8_t const* frame, RingFrame* ringFrame) const -> uint8_t const*;
+
+    std::string iface;
+    uint32_t blockSize;
+    uint32_t blockCount;
+
+    int fd = -1;
+    uint8_t* ring = nullptr;
+    size_t ringSize = 0;
+    uint32_t currentBlock = 0;
+
+    std::mutex statMutex;
+    uint64_t totalRecv = 0;
+    uint64_t totalDrop = 0;
+};
+
+template <typename F>
+auto PacketRing::processNextBlock(int timeoutMs, F&& processFrame) -> int
+{
+    auto* block = waitBlock(timeoutMs);
+    if (block == nullptr) {
+        return 0;
+    }
+    auto numFrames = blockNumFrames(block);
+    auto const* frame = blockFirstFrame(block);
+    RingFrame ringFrame = {};
+    for (uint32_t i = 0; i < numFrames; ++i) {
+        frame = readFrame(frame, &ringFrame);
+        processFrame(ringFrame);
+    }
+    releaseBlock(block);
+    return numFrames;
+}
+
+} // namespace flowstats
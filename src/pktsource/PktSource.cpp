@@ -2,8 +2,11 @@
 #include "Utils.hpp"
 #include <cstdint>
 #include <sys/stat.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
 #include <tins/ipv6.h>
 #include <tins/network_interface.h>
+#include <unistd.h>
 #include <utility>
 
 namespace flowstats {
@@ -23,6 +26,12 @@ auto listInterfaces() -> void
     exit(0);
 }
 
+PktSource::~PktSource()
+{
+    delete packetRing;
+    delete liveDevice;
+}
+
 auto PktSource::getLocalIps() -> std::vector<Tins::IPv4Address>
 {
     std::vector<Tins::IPv4Address> res;
@@ -37,6 +46,13 @@ auto PktSource::getLocalIps() -> std::vector<Tins::IPv4Address>
 
 auto PktSource::getCaptureStatus() -> std::optional<CaptureStat>
 {
+    if (packetRing != nullptr) {
+        auto captureStat = packetRing->getCaptureStat();
+        for (auto* worker : fanoutWorkers) {
+            captureStat += worker->packetRing->getCaptureStat();
+        }
+        return captureStat;
+    }
     if (liveDevice == nullptr) {
         return {};
     }
@@ -63,55 +79,143 @@ auto PktSource::getLiveDevice() -> Tins::Sniffer*
     return nullptr;
 }
 
-auto PktSource::updateScreen(timeval currentTime) -> void
+auto PktSource::getPacketRing() -> PacketRing*
 {
-    if (lastUpdate.tv_sec < currentTime.tv_sec) {
-        lastUpdate = currentTime;
-        auto captureStatus = getCaptureStatus();
-        screen->updateDisplay(currentTime, true, captureStatus);
+    auto* ring = new PacketRing(conf.getInterfaceName(),
+        conf.getRingBlockSize(), conf.getRingBlockCount());
+    if (!ring->open(conf.getBpfFilter())) {
+        delete ring;
+        return nullptr;
+    }
+    if (conf.getCaptureWorkers() > 1 && !ring->joinFanout(getpid() & 0xffff)) {
+        delete ring;
+        return nullptr;
     }
+    return ring;
 }
 
-auto PktSource::processPacketSource(Tins::Packet const& packet) -> void
+/**
+ * Once per second, hand the collectors' state to the screen thread.
+ * Formatting happens there, away from the packet path.
+ */
+auto PktSource::publishSnapshots(timeval currentTime) -> void
 {
-    auto const* pdu = packet.pdu();
-    auto const* ip = pdu->find_pdu<Tins::IP>();
-    Tins::IPv6 const* ipv6 = nullptr;
-    Tins::PDU const* ipPdu;
-    if (ip == nullptr) {
-        ipv6 = pdu->find_pdu<Tins::IPv6>();
-        if (ipv6 == nullptr) {
-            return;
-        }
-        ipPdu = ipv6;
-    } else {
-        ipPdu = ip;
-    }
-    auto const* tcp = ipPdu->find_pdu<Tins::TCP>();
-    Tins::UDP const* udp = nullptr;
-    if (tcp == nullptr) {
-        udp = ipPdu->find_pdu<Tins::UDP>();
-        if (udp == nullptr) {
-            return;
-        }
+    lastUpdate = currentTime;
+    for (auto* collector : collectors) {
+        collector->publishSnapshot();
     }
+    if (screen) {
+        screen->publishUpdate(currentTime, getCaptureStatus());
+    }
+}
 
-    auto flowId = FlowId(ip, ipv6, tcp, udp);
-    timeval pktTs = packetToTimeval(packet);
+auto PktSource::processPacketView(PacketView const& packet) -> void
+{
+    auto flowId = FlowId(packet);
+    auto const& pktTs = packet.getTimestamp();
     for (auto* collector : collectors) {
         collector->advanceTick(pktTs);
         try {
-            collector->processPacket(packet, flowId, ip, ipv6, tcp, udp);
+            collector->processPacket(packet, flowId);
         } catch (const Tins::malformed_packet&) {
-            SPDLOG_INFO("Malformed packet: {}", packet);
+            SPDLOG_INFO("Malformed packet: {}", flowId.toString());
         }
     }
-    if (screen) {
-        auto ts = packet.timestamp();
-        updateScreen({ ts.seconds(), ts.microseconds() / 1000 });
+    if (lastUpdate.tv_sec < pktTs.tv_sec) {
+        publishSnapshots(pktTs);
+    }
+}
+
+/**
+ * Decode the frame headers in place. Libtins is only used for the
+ * encapsulations PacketView doesn't know about.
+ */
+auto PktSource::processFrame(int linkType, uint8_t const* data, uint32_t capLen, timeval ts) -> void
+{
+    PacketView packet;
+    switch (packet.parseFrame(linkType, data, capLen, ts)) {
+        case PACKET_OK:
+            processPacketView(packet);
+            break;
+        case PACKET_UNSUPPORTED:
+            processSlowPath(linkType, data, capLen, ts);
+            break;
+        case PACKET_SKIP:
+            break;
     }
 }
 
+auto PktSource::processSlowPath(int linkType, uint8_t const* data, uint32_t capLen, timeval ts) -> void
+{
+    if (linkType != DLT_EN10MB) {
+        return;
+    }
+    try {
+        Tins::EthernetII eth(data, capLen);
+        Tins::PDU* ipPdu = eth.find_pdu<Tins::IP>();
+        if (ipPdu == nullptr) {
+            ipPdu = eth.find_pdu<Tins::IPv6>();
+        }
+        if (ipPdu == nullptr) {
+            return;
+        }
+        slowPathBuffer = ipPdu->serialize();
+    } catch (const Tins::malformed_packet&) {
+        SPDLOG_DEBUG("Malformed frame of {} bytes", capLen);
+        return;
+    }
+    PacketView packet;
+    if (packet.parseIp(slowPathBuffer.data(), slowPathBuffer.size(), 0, ts) == PACKET_OK) {
+        processPacketView(packet);
+    }
+}
+
+auto PktSource::processRingFrame(RingFrame const& frame) -> void
+{
+    processFrame(DLT_EN10MB, frame.data, frame.capLen, frame.ts);
+}
+
+/**
+ * Feed all frames of a pcap file to the collectors, returns the number of
+ * frames read
+ */
+auto PktSource::readPcapFile(std::string const& fileName, std::string const& bpfFilter) -> int
+{
+    char errbuf[PCAP_ERRBUF_SIZE];
+    auto* handle = pcap_open_offline(fileName.c_str(), errbuf);
+    if (handle == nullptr) {
+        spdlog::error("Could not open {}: {}", fileName, errbuf);
+        return -1;
+    }
+    if (!bpfFilter.empty()) {
+        bpf_program program = {};
+        if (pcap_compile(handle, &program, bpfFilter.c_str(), 1, PCAP_NETMASK_UNKNOWN) < 0
+            || pcap_setfilter(handle, &program) < 0) {
+            spdlog::error("Could not set filter \"{}\": {}", bpfFilter, pcap_geterr(handle));
+            pcap_freecode(&program);
+            pcap_close(handle);
+            return -1;
+        }
+        pcap_freecode(&program);
+    }
+
+    int linkType = pcap_datalink(handle);
+    pcap_pkthdr* header;
+    uint8_t const* data;
+    time_t lastSecond = 0;
+    int numFrames = 0;
+    while (pcap_next_ex(handle, &header, &data) == 1) {
+        if (lastSecond != header->ts.tv_sec && shouldStop->load()) {
+            break;
+        }
+        lastSecond = header->ts.tv_sec;
+        processFrame(linkType, data, header->caplen, header->ts);
+        numFrames++;
+    }
+    pcap_close(handle);
+    return numFrames;
+}
+
 /**
  * analysis pcap file
  */
@@ -122,24 +226,14 @@ auto PktSource::analyzePcapFile() -> int
         SPDLOG_ERROR("File {} doesn't exist", conf.getPcapFileName());
         return -1;
     }
-    auto reader = Tins::FileSniffer(conf.getPcapFileName(), conf.getBpfFilter());
-
-    int lastSecond = 0;
-    for (auto const& packet : reader) {
-        auto pktSecond = packet.timestamp().seconds();
-        if (packet.timestamp().seconds() == 0) {
-            break;
-        }
-        if (lastSecond != pktSecond && shouldStop->load()) {
-            break;
-        }
-        lastSecond = pktSecond;
-        processPacketSource(packet);
+    if (readPcapFile(conf.getPcapFileName(), conf.getBpfFilter()) < 0) {
+        return -1;
     }
 
     for (auto* collector : collectors) {
         collector->resetMetrics();
     }
+    publishSnapshots(lastUpdate);
     if (screen->getNoCurses()) {
         return 0;
     }
@@ -151,6 +245,29 @@ auto PktSource::analyzePcapFile() -> int
     return 0;
 }
 
+/**
+ * Open the capture ring, falling back to libpcap when possible
+ */
+auto PktSource::openLiveCapture() -> bool
+{
+    if (packetRing != nullptr || liveDevice != nullptr) {
+        return true;
+    }
+    if (conf.getUseRing() || conf.getCaptureWorkers() > 1) {
+        packetRing = getPacketRing();
+        if (packetRing != nullptr) {
+            return true;
+        }
+        if (conf.getCaptureWorkers() > 1) {
+            spdlog::error("Multiple capture workers need the TPACKET_V3 ring");
+            return false;
+        }
+        spdlog::warn("Falling back to libpcap capture");
+    }
+    liveDevice = getLiveDevice();
+    return liveDevice != nullptr;
+}
+
 /**
  * analysis live traffic
  */
@@ -158,19 +275,42 @@ auto PktSource::analyzeLiveTraffic() -> int
 {
     SPDLOG_INFO("Start live traffic capture with filter {}",
         conf.getBpfFilter());
-    liveDevice = getLiveDevice();
-    if (liveDevice == nullptr) {
+    if (!openLiveCapture()) {
         return -1;
     }
-    for (const auto& packet : *liveDevice) {
-        if (shouldStop->load()) {
+    if (packetRing != nullptr) {
+        return analyzeRingTraffic();
+    }
+    auto* handle = liveDevice->get_pcap_handle();
+    int linkType = pcap_datalink(handle);
+    pcap_pkthdr* header;
+    uint8_t const* data;
+    while (!shouldStop->load()) {
+        auto res = pcap_next_ex(handle, &header, &data);
+        if (res == 0) {
+            continue;
+        }
+        if (res < 0) {
             break;
         }
-        processPacketSource(packet);
+        processFrame(linkType, data, header->caplen, header->ts);
     }
 
     SPDLOG_INFO("Stop capture");
     liveDevice->stop_sniff();
     return 0;
 }
+
+/**
+ * analysis live traffic from the mmap ring, one retired block at a time
+ */
+auto PktSource::analyzeRingTraffic() -> int
+{
+    auto processFrame = [this](RingFrame const& frame) { processRingFrame(frame); };
+    while (!shouldStop->load()) {
+        packetRing->processNextBlock(100, processFrame);
+    }
+    SPDLOG_INFO("Stop capture");
+    return 0;
+}
 } // namespace flowstats
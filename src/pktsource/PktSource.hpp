@@ -2,6 +2,8 @@
 
 #include "Collector.hpp"
 #include "Configuration.hpp"
+#include "PacketRing.hpp"
+#include "PacketView.hpp"
 #include "Screen.hpp"
 #include "Stats.hpp"
 #include <tins/ip_address.h>
@@ -24,15 +26,19 @@ public:
     {
         lastPcapStat.ps_recv = 0;
     };
-    virtual ~PktSource() = default;
+    virtual ~PktSource();
 
-    auto updateScreen(timeval currentTime) -> void;
+    auto publishSnapshots(timeval currentTime) -> void;
     [[nodiscard]] auto getCaptureStatus() -> std::optional<CaptureStat>;
     [[nodiscard]] auto getLocalIps() -> std::vector<Tins::IPv4Address>;
+    auto addFanoutWorker(PktSource* worker) -> void { fanoutWorkers.push_back(worker); };
 
+    auto openLiveCapture() -> bool;
     auto analyzeLiveTraffic() -> int;
     auto analyzePcapFile() -> int;
-    auto processPacketSource(Tins::Packet const& packet) -> void;
+    auto readPcapFile(std::string const& fileName, std::string const& bpfFilter) -> int;
+    auto processFrame(int linkType, uint8_t const* data, uint32_t capLen, timeval ts) -> void;
+    auto processRingFrame(RingFrame const& frame) -> void;
 
 private:
     Screen* screen;
@@ -43,8 +49,16 @@ private:
     timeval lastUpdate = {};
     pcap_stat lastPcapStat = {};
 
+    auto processPacketView(PacketView const& packet) -> void;
+    auto processSlowPath(int linkType, uint8_t const* data, uint32_t capLen, timeval ts) -> void;
+    std::vector<uint8_t> slowPathBuffer;
+
     auto getLiveDevice() -> Tins::Sniffer*;
+    auto getPacketRing() -> PacketRing*;
+    auto analyzeRingTraffic() -> int;
     Tins::Sniffer* liveDevice = nullptr;
+    PacketRing* packetRing = nullptr;
+    std::vector<PktSource*> fanoutWorkers;
 };
 
 } // namespace flowstats
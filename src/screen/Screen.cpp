@@ -68,8 +68,12 @@ auto Screen::updateDisplay(timeval tv, bool updateOutput,
     }
     updateBottomMenu();
 
-    if (!shouldFreeze && updateOutput) {
-        collectorOutput = activeCollector->outputStatus(tv.tv_sec - firstTv.tv_sec);
+    // Only the visible rows are formatted, scrolling may need new ones
+    availableLines = (LINES - (STATUS_LINES + TOP_MENU_LINES + HEADER_LINES + BOTTOM_LINES));
+    bool windowMissing = !collectorOutput.hasRows(startLine, availableLines);
+    if ((!shouldFreeze && updateOutput) || windowMissing) {
+        collectorOutput = activeCollector->outputStatus(tv.tv_sec - firstTv.tv_sec,
+            startLine, availableLines);
     }
 
     updateHeaders();
@@ -78,24 +82,36 @@ auto Screen::updateDisplay(timeval tv, bool updateOutput,
     refreshPads();
 }
 
+auto Screen::publishUpdate(timeval tv, std::optional<CaptureStat> const& captureStat) -> void
+{
+    if (noCurses) {
+        return;
+    }
+    const std::lock_guard<std::mutex> lock(pendingMutex);
+    pendingTv = tv;
+    pendingCaptureStat = captureStat;
+    hasPendingUpdate.store(true);
+}
+
 auto Screen::updateBody() -> void
 {
     werase(bodyWin);
 
     auto const& lineGroups = collectorOutput.getValues();
+    int firstRow = collectorOutput.getFirstRow();
     bool strip = false;
     int screenLine = 0;
-    numberElements = lineGroups.size();
+    numberElements = collectorOutput.getNumRows();
     availableLines = (LINES - (STATUS_LINES + TOP_MENU_LINES + HEADER_LINES + BOTTOM_LINES));
-    endLine = lineGroups.size();
+    endLine = firstRow + lineGroups.size();
     displayedElements = endLine - startLine;
-    for (int lineGroupIndex = startLine; lineGroupIndex < lineGroups.size(); ++lineGroupIndex) {
+    for (int lineGroupIndex = std::max(startLine, firstRow); lineGroupIndex < endLine; ++lineGroupIndex) {
         if (lineGroupIndex == selectedLine) {
             wattron(bodyWin, COLOR_PAIR(SELECTED_LINE_COLOR));
         } else if (strip) {
             wattron(bodyWin, COLOR_PAIR(UNSELECTED_LINE_STRIP_COLOR));
         }
-        for (auto& line : lineGroups[lineGroupIndex]) {
+        for (auto& line : lineGroups[lineGroupIndex - firstRow]) {
             mvwprintw(bodyWin, screenLine++, 0, fmt::format("{:<" STR(DEFAULT_COLUMNS) "}", line).c_str());
         }
         if (lineGroupIndex == selectedLine) {
@@ -564,6 +580,17 @@ auto Screen::displayLoop() -> void
 
         c = getch();
         if (c == ERR) {
+            if (hasPendingUpdate.exchange(false)) {
+                timeval tv = {};
+                std::optional<CaptureStat> captureStat;
+                {
+                    const std::lock_guard<std::mutex> lock(pendingMutex);
+                    tv = pendingTv;
+                    captureStat = pendingCaptureStat;
+                }
+                updateDisplay(tv, true, captureStat);
+                continue;
+            }
             if (pcapReplay) {
                 continue;
             }
@@ -29,6 +29,11 @@ public:
     auto stopDisplay() -> void;
     auto updateDisplay(timeval tv, bool updateOutput,
         std::optional<CaptureStat> const& captureStatus) -> void;
+    /**
+     * Called from the packet thread once the collectors published their
+     * snapshots, the display is refreshed by the screen thread
+     */
+    auto publishUpdate(timeval tv, std::optional<CaptureStat> const& captureStatus) -> void;
 
     [[nodiscard]] auto getCurrentChoice() -> std::string;
     [[nodiscard]] auto getNoCurses() const { return noCurses; };
@@ -120,5 +125,10 @@ private:
     bool reversedSort = false;
 
     std::mutex screenMutex;
+
+    std::mutex pendingMutex;
+    std::atomic_bool hasPendingUpdate = false;
+    timeval pendingTv = {};
+    std::optional<CaptureStat> pendingCaptureStat;
 };
 } // namespace flowstats
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Configuration.hpp"
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -10,19 +11,35 @@ struct CollectorOutput {
     CollectorOutput() = default;
     CollectorOutput(std::string name,
         std::string headers,
-        std::vector<std::vector<std::string>> values)
+        std::vector<std::vector<std::string>> values,
+        size_t firstRow, size_t numRows)
         : name(std::move(name))
         , headers(std::move(headers))
-        , values(std::move(values)) {};
+        , values(std::move(values))
+        , firstRow(firstRow)
+        , numRows(numRows) {};
 
     auto print() const -> void;
 
     [[nodiscard]] auto getHeaders() const& -> std::string { return headers; };
-    [[nodiscard]] auto getValues() const& -> std::vector<std::vector<std::string>> { return values; };
+    [[nodiscard]] auto getValues() const& -> std::vector<std::vector<std::string>> const& { return values; };
+    [[nodiscard]] auto getFirstRow() const -> size_t { return firstRow; };
+    [[nodiscard]] auto getNumRows() const -> size_t { return numRows; };
+    /**
+     * Whether rows [start, start + count) are formatted, or don't exist
+     */
+    [[nodiscard]] auto hasRows(size_t start, size_t count) const -> bool
+    {
+        auto end = std::min(start + count, numRows);
+        return start >= firstRow && end <= firstRow + values.size();
+    };
 
 private:
     std::string name;
     std::string headers;
     std::vector<std::vector<std::string>> values;
+    // Values are the rows [firstRow, firstRow + values.size()) of numRows
+    size_t firstRow = 0;
+    size_t numRows = 0;
 };
 } // namespace flowstats
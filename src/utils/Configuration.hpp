@@ -31,7 +31,20 @@ public:
     [[nodiscard]] auto getDomainToServerPort() const -> std::map<std::string, uint16_t> const& { return domainToServerPort; };
     [[nodiscard]] auto getPerIpAggr() const -> bool const& { return perIpAggr; };
     [[nodiscard]] auto getDisplayUnknownFqdn() const -> bool const& { return displayUnknownFqdn; };
-    [[nodiscard]] auto getTimeoutFlow() const -> int const& { return timeoutFlow; };
+    [[nodiscard]] auto getTimeoutFlowMs() const -> uint32_t const& { return timeoutFlowMs; };
+    [[nodiscard]] auto getUseRing() const -> bool const& { return useRing; };
+    [[nodiscard]] auto getRingBlockSize() const -> uint32_t const& { return ringBlockSize; };
+    [[nodiscard]] auto getRingBlockCount() const -> uint32_t const& { return ringBlockCount; };
+    [[nodiscard]] auto getCaptureWorkers() const -> int const& { return captureWorkers; };
+    [[nodiscard]] auto getMaxFlows() const -> uint32_t const& { return maxFlows; };
+    [[nodiscard]] auto getMaxFqdnEntries() const -> uint32_t const& { return maxFqdnEntries; };
+    [[nodiscard]] auto getFqdnCacheFile() const -> std::string const& { return fqdnCacheFile; };
+    [[nodiscard]] auto getPrefixFile() const -> std::string const& { return prefixFile; };
+    [[nodiscard]] auto getReverseDnsServer() const -> std::string const& { return reverseDnsServer; };
+    [[nodiscard]] auto getDnsRollupDepth() const -> uint32_t const& { return dnsRollupDepth; };
+    [[nodiscard]] auto getDnsRollupRegistered() const -> bool const& { return dnsRollupRegistered; };
+    [[nodiscard]] auto getDnsMaxKeys() const -> uint32_t const& { return dnsMaxKeys; };
+    [[nodiscard]] auto getDnsPerResolver() const -> bool const& { return dnsPerResolver; };
 
     auto setBpfFilter(std::string b) { bpfFilter = std::move(b); };
     auto setPcapFileName(std::string p) { pcapFileName = std::move(p); };
@@ -39,6 +52,20 @@ public:
     auto setDisplayUnknownFqdn(bool d) { displayUnknownFqdn = d; };
     auto setPerIpAggr(bool p) { perIpAggr = p; };
     auto setDomainToServerPort(std::map<std::string, uint16_t> d) { domainToServerPort = std::move(d); };
+    auto setUseRing(bool r) { useRing = r; };
+    auto setRingBlockSize(uint32_t s) { ringBlockSize = s; };
+    auto setRingBlockCount(uint32_t c) { ringBlockCount = c; };
+    auto setCaptureWorkers(int w) { captureWorkers = w; };
+    auto setMaxFlows(uint32_t m) { maxFlows = m; };
+    auto setMaxFqdnEntries(uint32_t m) { maxFqdnEntries = m; };
+    auto setFqdnCacheFile(std::string f) { fqdnCacheFile = std::move(f); };
+    auto setPrefixFile(std::string f) { prefixFile = std::move(f); };
+    auto setReverseDnsServer(std::string s) { reverseDnsServer = std::move(s); };
+    auto setTimeoutFlowMs(uint32_t t) { timeoutFlowMs = t; };
+    auto setDnsRollupDepth(uint32_t d) { dnsRollupDepth = d; };
+    auto setDnsRollupRegistered(bool r) { dnsRollupRegistered = r; };
+    auto setDnsMaxKeys(uint32_t m) { dnsMaxKeys = m; };
+    auto setDnsPerResolver(bool r) { dnsPerResolver = r; };
 
 private:
     std::string iface = "";
@@ -49,7 +76,25 @@ private:
     bool perIpAggr = false;
 
     bool displayUnknownFqdn = false;
-    int timeoutFlow = 15;
+    uint32_t timeoutFlowMs = 15000;
+    uint32_t maxFlows = 1 << 18;
+    uint32_t maxFqdnEntries = 1 << 18;
+    std::string fqdnCacheFile = "";
+    std::string prefixFile = "";
+    std::string reverseDnsServer = "";
+
+    // Dns names are aggregated on their last labels or registered domain
+    // when set, 0 keeps the full name
+    uint32_t dnsRollupDepth = 0;
+    bool dnsRollupRegistered = false;
+    uint32_t dnsMaxKeys = 1 << 14;
+    // Dns flows are aggregated on their resolver instead of their fqdn
+    bool dnsPerResolver = false;
+
+    bool useRing = true;
+    uint32_t ringBlockSize = 1 << 20;
+    uint32_t ringBlockCount = 64;
+    int captureWorkers = 1;
 };
 
 class FlowReplayConfiguration : public LogConfiguration {
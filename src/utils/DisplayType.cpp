@@ -10,6 +10,7 @@ auto displayTypeToString(enum DisplayType displayType) -> std::string
         case DisplayClients: return "Clients";
         case DisplaySsl: return "Ssl details";
         case DisplayDnsResourceRecords: return "Resource Records";
+        case DisplayDnsResponseCodes: return "Response Codes";
 
         case DisplayTcpFlags: return "Tcp Flags";
         case DisplayOtherFlags: return "Rst/0win";
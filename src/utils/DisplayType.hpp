@@ -9,6 +9,7 @@ enum DisplayType {
     DisplayRequests,
     DisplayResponses,
     DisplayDnsResourceRecords,
+    DisplayDnsResponseCodes,
     DisplayClients,
     DisplayConnections,
     DisplayConnectionTimes,
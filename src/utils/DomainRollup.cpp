@@ -0,0 +1,75 @@
+#include "DomainRollup.hpp"
+#include <unordered_set>
+
+namespace flowstats {
+
+namespace {
+
+    // Multi-label public suffixes of the most common country code domains
+    // and hosting providers. Single label suffixes don't need an entry.
+    auto publicSuffixes() -> std::unordered_set<std::string_view> const&
+    {
+        static std::unordered_set<std::string_view> const suffixes = {
+            "ac.uk", "co.uk", "gov.uk", "ltd.uk", "me.uk", "net.uk", "org.uk", "plc.uk",
+            "com.au", "edu.au", "gov.au", "net.au", "org.au",
+            "co.nz", "govt.nz", "net.nz", "org.nz",
+            "ac.jp", "co.jp", "go.jp", "ne.jp", "or.jp",
+            "co.kr", "go.kr", "or.kr",
+            "com.cn", "edu.cn", "gov.cn", "net.cn", "org.cn",
+            "com.hk", "com.sg", "com.tw", "com.my", "com.ph", "com.vn",
+            "ac.in", "co.in", "net.in", "org.in", "gov.in",
+            "co.id", "co.il", "co.th", "co.za",
+            "com.ar", "com.br", "com.co", "com.mx", "com.pe",
+            "gov.br", "net.br", "org.br",
+            "com.pl", "com.tr", "com.ua", "com.ru",
+            "appspot.com", "azurewebsites.net", "blogspot.com", "cloudfront.net",
+            "github.io", "herokuapp.com",
+        };
+        return suffixes;
+    }
+
+    // Offset of the label before pos, 0 for the first label
+    auto previousLabel(std::string_view fqdn, size_t pos) -> size_t
+    {
+        if (pos < 2) {
+            return 0;
+        }
+        auto dot = fqdn.rfind('.', pos - 2);
+        return dot == std::string_view::npos ? 0 : dot + 1;
+    }
+
+} // namespace
+
+auto registeredDomain(std::string_view fqdn) -> std::string_view
+{
+    if (fqdn.empty()) {
+        return fqdn;
+    }
+    // Longest public suffix, the last label by default
+    auto suffixPos = previousLabel(fqdn, fqdn.size() + 1);
+    auto const& suffixes = publicSuffixes();
+    for (size_t pos = 0; pos < suffixPos; pos = fqdn.find('.', pos) + 1) {
+        if (suffixes.count(fqdn.substr(pos))) {
+            suffixPos = pos;
+            break;
+        }
+    }
+    if (suffixPos == 0) {
+        return fqdn;
+    }
+    return fqdn.substr(previousLabel(fqdn, suffixPos));
+}
+
+auto domainSuffix(std::string_view fqdn, uint32_t depth) -> std::string_view
+{
+    if (depth == 0) {
+        return fqdn;
+    }
+    auto pos = fqdn.size() + 1;
+    for (uint32_t i = 0; i < depth && pos > 0; ++i) {
+        pos = previousLabel(fqdn, pos);
+    }
+    return fqdn.substr(pos);
+}
+
+} // namespace flowstats
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace flowstats {
+
+/**
+ * Registered domain of fqdn, its public suffix and one more label, like
+ * example.co.uk for www.example.co.uk. Public suffixes come from a
+ * compiled subset of the public suffix list, a name matching none of them
+ * uses its last label. A name without a label left of its public suffix
+ * is returned as is.
+ *
+ * fqdn is expected lowercased, as decoded by DnsMessage, so every case
+ * variant of a name rolls up to the same string.
+ */
+auto registeredDomain(std::string_view fqdn) -> std::string_view;
+
+/**
+ * Last depth labels of fqdn, the whole name if it has fewer labels or
+ * depth is 0
+ */
+auto domainSuffix(std::string_view fqdn, uint32_t depth) -> std::string_view;
+
+} // namespace flowstats
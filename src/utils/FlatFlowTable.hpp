@@ -0,0 +1,290 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace flowstats {
+
+/**
+ * Open addressing hash table with a capacity fixed at construction.
+ *
+ * Every slot has a control byte holding the low 7 bits of the key hash or
+ * EMPTY. Lookups compare a group of 16 control bytes at once and only
+ * touch the slots whose control byte matches. Collisions are resolved by
+ * linear probing and erase shifts the following entries back, so there
+ * are no tombstones and probe lengths don't degrade with churn.
+ *
+ * The table never grows: emplace fails once maxEntries keys are stored.
+ * Pointers to values stay valid until the next erase.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>>
+class FlatFlowTable {
+public:
+    using value_type = std::pair<K, V>;
+
+    template <typename Table, typename Value>
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Value*;
+        using reference = Value&;
+
+        Iterator(Table* table, size_t index)
+            : table(table)
+            , index(index)
+        {
+            skipEmpty();
+        }
+
+        auto operator*() const -> reference { return table->slots[index].value; }
+        auto operator->() const -> pointer { return &table->slots[index].value; }
+        auto operator++() -> Iterator&
+        {
+            ++index;
+            skipEmpty();
+            return *this;
+        }
+        auto operator==(Iterator const& other) const -> bool { return index == other.index; }
+        auto operator!=(Iterator const& other) const -> bool { return index != other.index; }
+
+    private:
+        auto skipEmpty() -> void
+        {
+            while (index < table->capacity && table->ctrl[index] == EMPTY) {
+                ++index;
+            }
+        }
+
+        Table* table;
+        size_t index;
+    };
+
+    using iterator = Iterator<FlatFlowTable, value_type>;
+    using const_iterator = Iterator<FlatFlowTable const, value_type const>;
+
+    explicit FlatFlowTable(size_t maxEntries)
+        : maxEntries(maxEntries)
+    {
+        // Keep the load factor under 7/8 so a probe always finds an empty slot
+        size_t minCapacity = maxEntries + maxEntries / 7 + 1;
+        capacity = GROUP_SIZE;
+        while (capacity < minCapacity) {
+            capacity <<= 1;
+        }
+        mask = capacity - 1;
+        ctrl = std::make_unique<int8_t[]>(capacity + GROUP_SIZE - 1);
+        memset(ctrl.get(), EMPTY, capacity + GROUP_SIZE - 1);
+        // Slots are left uninitialized so untouched pages are never committed
+        slots.reset(new Slot[capacity]);
+    }
+
+    ~FlatFlowTable() { clear(); }
+
+    FlatFlowTable(FlatFlowTable const&) = delete;
+    auto operator=(FlatFlowTable const&) -> FlatFlowTable& = delete;
+
+    [[nodiscard]] auto size() const -> size_t { return numEntries; }
+    [[nodiscard]] auto empty() const -> bool { return numEntries == 0; }
+    [[nodiscard]] auto full() const -> bool { return numEntries >= maxEntries; }
+    [[nodiscard]] auto maxSize() const -> size_t { return maxEntries; }
+
+    auto begin() -> iterator { return iterator(this, 0); }
+    auto end() -> iterator { return iterator(this, capacity); }
+    auto begin() const -> const_iterator { return const_iterator(this, 0); }
+    auto end() const -> const_iterator { return const_iterator(this, capacity); }
+
+    auto find(K const& key) -> iterator { return iterator(this, findIndex(key)); }
+    auto find(K const& key) const -> const_iterator { return const_iterator(this, findIndex(key)); }
+
+    auto at(K const& key) const -> V const&
+    {
+        auto index = findIndex(key);
+        if (index == capacity) {
+            throw std::out_of_range("FlatFlowTable::at");
+        }
+        return slots[index].value.second;
+    }
+
+    /**
+     * Insert a value constructed from args if key is missing. Returns
+     * end() when the table is full.
+     */
+    template <typename... Args>
+    auto emplace(K const& key, Args&&... args) -> std::pair<iterator, bool>
+    {
+        auto hash = hasher(key);
+        auto index = findIndex(key, hash);
+        if (index != capacity) {
+            return { iterator(this, index), false };
+        }
+        if (full()) {
+            return { end(), false };
+        }
+        index = findEmpty(hash);
+        new (&slots[index].value) value_type(std::piecewise_construct,
+            std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+        setCtrl(index, h2(hash));
+        ++numEntries;
+        return { iterator(this, index), true };
+    }
+
+    /**
+     * Remove key, shifting back the entries of the same probe sequence.
+     * Erasing while iterating is not supported.
+     */
+    auto erase(K const& key) -> size_t
+    {
+        auto index = findIndex(key);
+        if (index == capacity) {
+            return 0;
+        }
+        destroySlot(index);
+        auto hole = index;
+        auto next = index;
+        while (true) {
+            next = (next + 1) & mask;
+            if (ctrl[next] == EMPTY) {
+                break;
+            }
+            auto home = h1(hasher(slots[next].value.first));
+            // Entries whose home is cyclically within (hole, next] can't move
+            bool canMove = hole <= next
+                ? (home <= hole || home > next)
+                : (home <= hole && home > next);
+            if (!canMove) {
+                continue;
+            }
+            new (&slots[hole].value) value_type(std::move(slots[next].value));
+            setCtrl(hole, ctrl[next]);
+            destroySlot(next);
+            hole = next;
+        }
+        --numEntries;
+        return 1;
+    }
+
+    auto clear() -> void
+    {
+        for (size_t i = 0; i < capacity; ++i) {
+            if (ctrl[i] != EMPTY) {
+                destroySlot(i);
+            }
+        }
+        numEntries = 0;
+    }
+
+private:
+    static size_t const GROUP_SIZE = 16;
+    static int8_t const EMPTY = -128;
+
+    union Slot {
+        Slot() {};
+        ~Slot() {};
+        value_type value;
+    };
+
+    [[nodiscard]] auto h1(size_t hash) const -> size_t { return (hash >> 7) & mask; }
+    [[nodiscard]] static auto h2(size_t hash) -> int8_t { return static_cast<int8_t>(hash & 0x7f); }
+
+    /**
+     * Bitmask of the slots of the group starting at pos whose control byte
+     * matches value
+     */
+    [[nodiscard]] auto matchGroup(size_t pos, int8_t value) const -> uint32_t
+    {
+#ifdef __SSE2__
+        auto group = _mm_loadu_si128(reinterpret_cast<__m128i const*>(&ctrl[pos]));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(value)));
+#else
+        uint32_t res = 0;
+        for (size_t i = 0; i < GROUP_SIZE; ++i) {
+            res |= static_cast<uint32_t>(ctrl[pos + i] == value) << i;
+        }
+        return res;
+#endif
+    }
+
+    [[nodiscard]] auto matchEmpty(size_t pos) const -> uint32_t
+    {
+        return matchGroup(pos, EMPTY);
+    }
+
+    [[nodiscard]] auto findIndex(K const& key) const -> size_t
+    {
+        return findIndex(key, hasher(key));
+    }
+
+    [[nodiscard]] auto findIndex(K const& key, size_t hash) const -> size_t
+    {
+        auto pos = h1(hash);
+        auto tag = h2(hash);
+        while (true) {
+            auto empties = matchEmpty(pos);
+            auto candidates = matchGroup(pos, tag);
+            // The probe sequence ends at the first empty slot
+            if (empties) {
+                candidates &= (empties & -empties) - 1;
+            }
+            while (candidates) {
+                auto index = (pos + __builtin_ctz(candidates)) & mask;
+                if (slots[index].value.first == key) {
+                    return index;
+                }
+                candidates &= candidates - 1;
+            }
+            if (empties) {
+                return capacity;
+            }
+            pos = (pos + GROUP_SIZE) & mask;
+        }
+    }
+
+    [[nodiscard]] auto findEmpty(size_t hash) const -> size_t
+    {
+        auto pos = h1(hash);
+        while (true) {
+            auto empties = matchEmpty(pos);
+            if (empties) {
+                return (pos + __builtin_ctz(empties)) & mask;
+            }
+            pos = (pos + GROUP_SIZE) & mask;
+        }
+    }
+
+    auto setCtrl(size_t index, int8_t value) -> void
+    {
+        ctrl[index] = value;
+        // The first group is mirrored after the end for unaligned group loads
+        if (index < GROUP_SIZE - 1) {
+            ctrl[capacity + index] = value;
+        }
+    }
+
+    auto destroySlot(size_t index) -> void
+    {
+        slots[index].value.~value_type();
+        setCtrl(index, EMPTY);
+    }
+
+    size_t maxEntries;
+    size_t capacity;
+    size_t mask;
+    size_t numEntries = 0;
+    std::unique_ptr<int8_t[]> ctrl;
+    std::unique_ptr<Slot[]> slots;
+    Hash hasher;
+};
+
+} // namespace flowstats
@@ -0,0 +1,135 @@
+#include "FqdnTable.hpp"
+#include <mutex>
+#include <spdlog/spdlog.h>
+
+namespace flowstats {
+
+FqdnTable::FqdnTable()
+{
+    intern("");
+    intern("Unknown");
+    intern("Total");
+}
+
+FqdnTable::~FqdnTable()
+{
+    for (auto& block : blocks) {
+        delete[] block.load();
+    }
+}
+
+auto FqdnTable::find(std::string_view fqdn) -> std::optional<FqdnId>
+{
+    const std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(fqdn);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    return {};
+}
+
+auto FqdnTable::intern(std::string_view fqdn) -> FqdnId
+{
+    {
+        const std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(fqdn);
+        if (it != ids.end() && entry(it->second).refs.load(std::memory_order_acquire) == PERMANENT) {
+            return it->second;
+        }
+    }
+    const std::lock_guard<std::shared_mutex> lock(mutex);
+    return addLocked(fqdn, PERMANENT);
+}
+
+auto FqdnTable::acquire(std::string_view fqdn) -> FqdnId
+{
+    const std::lock_guard<std::shared_mutex> lock(mutex);
+    return addLocked(fqdn, 1);
+}
+
+auto FqdnTable::addLocked(std::string_view fqdn, uint32_t refs) -> FqdnId
+{
+    auto it = ids.find(fqdn);
+    if (it != ids.end()) {
+        auto& current = entry(it->second).refs;
+        auto currentRefs = current.load(std::memory_order_relaxed);
+        if (currentRefs != PERMANENT) {
+            current.store(refs == PERMANENT ? PERMANENT : currentRefs + 1, std::memory_order_release);
+        }
+        return it->second;
+    }
+
+    FqdnId id;
+    if (!freeIds.empty()) {
+        id = freeIds.back();
+        freeIds.pop_back();
+    } else {
+        id = count.load(std::memory_order_relaxed);
+        if (id >= BLOCK_SIZE * MAX_BLOCKS) {
+            // Logged on powers of 2 so a full table doesn't flood the log
+            auto numDropped = dropped.fetch_add(1, std::memory_order_relaxed) + 1;
+            if ((numDropped & (numDropped - 1)) == 0) {
+                spdlog::error("Fqdn table is full, {} fqdns stored as Unknown", numDropped);
+            }
+            return FQDN_UNKNOWN;
+        }
+        if (blocks[id >> BLOCK_BITS].load(std::memory_order_relaxed) == nullptr) {
+            blocks[id >> BLOCK_BITS].store(new Entry[BLOCK_SIZE], std::memory_order_release);
+        }
+        count.store(id + 1, std::memory_order_release);
+    }
+    auto& newEntry = entry(id);
+    newEntry.fqdn = fqdn;
+    newEntry.refs.store(refs, std::memory_order_release);
+    ids.emplace(newEntry.fqdn, id);
+    live.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+auto FqdnTable::release(FqdnId id) -> bool
+{
+    const std::lock_guard<std::shared_mutex> lock(mutex);
+    auto& released = entry(id);
+    auto refs = released.refs.load(std::memory_order_relaxed);
+    if (refs == PERMANENT || refs == 0) {
+        return false;
+    }
+    released.refs.store(refs - 1, std::memory_order_relaxed);
+    if (refs > 1) {
+        return false;
+    }
+    ids.erase(released.fqdn);
+    live.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+auto FqdnTable::recycle(std::vector<FqdnId> const& released) -> void
+{
+    const std::lock_guard<std::shared_mutex> lock(mutex);
+    for (auto id : released) {
+        entry(id).fqdn.clear();
+        freeIds.push_back(id);
+    }
+}
+
+auto FqdnTable::pin(FqdnId id) -> bool
+{
+    auto& pinned = entry(id);
+    if (pinned.refs.load(std::memory_order_acquire) == PERMANENT) {
+        return true;
+    }
+    const std::lock_guard<std::shared_mutex> lock(mutex);
+    if (pinned.refs.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+    pinned.refs.store(PERMANENT, std::memory_order_release);
+    return true;
+}
+
+auto fqdnTable() -> FqdnTable&
+{
+    static FqdnTable table;
+    return table;
+}
+
+} // namespace flowstats
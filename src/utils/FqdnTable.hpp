@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace flowstats {
+
+typedef uint32_t FqdnId;
+
+// Interned on creation of the table
+FqdnId const FQDN_NONE = 0;
+FqdnId const FQDN_UNKNOWN = 1;
+FqdnId const FQDN_TOTAL = 2;
+
+/**
+ * Intern table giving a stable id to each fqdn. An id can be resolved
+ * without locking from any thread that got it.
+ *
+ * Interned fqdns are permanent. Acquired fqdns, like the names of dns
+ * answers, are reference counted: once the last reference is released,
+ * their id is recycled for another fqdn. Pinning an acquired id makes it
+ * permanent, for keys and flows keeping it.
+ */
+class FqdnTable {
+public:
+    FqdnTable();
+    ~FqdnTable();
+    FqdnTable(FqdnTable const&) = delete;
+    auto operator=(FqdnTable const&) -> FqdnTable& = delete;
+
+    auto intern(std::string_view fqdn) -> FqdnId;
+    /**
+     * Take a reference on fqdn, made permanent if it's interned later
+     */
+    auto acquire(std::string_view fqdn) -> FqdnId;
+    /**
+     * Drop a reference taken by acquire. Returns true for the last one,
+     * the id is then passed to recycle once no reader can still see it.
+     */
+    auto release(FqdnId id) -> bool;
+    auto recycle(std::vector<FqdnId> const& released) -> void;
+    /**
+     * Make an acquired id permanent, fails if it was released meanwhile
+     */
+    auto pin(FqdnId id) -> bool;
+
+    // Id of an already interned or acquired fqdn
+    [[nodiscard]] auto find(std::string_view fqdn) -> std::optional<FqdnId>;
+    [[nodiscard]] auto get(FqdnId id) const -> std::string const& { return entry(id).fqdn; }
+    // Fqdns currently stored
+    [[nodiscard]] auto size() const -> size_t { return live.load(std::memory_order_relaxed); }
+    // Ids ever allocated, recycled ids included
+    [[nodiscard]] auto getNumIds() const -> size_t { return count.load(std::memory_order_acquire); }
+
+private:
+    static size_t const BLOCK_BITS = 12;
+    static size_t const BLOCK_SIZE = 1 << BLOCK_BITS;
+    static size_t const MAX_BLOCKS = 4096;
+    static uint32_t const PERMANENT = UINT32_MAX;
+
+    struct Entry {
+        std::string fqdn;
+        // References of an acquired fqdn, PERMANENT once interned
+        std::atomic<uint32_t> refs = 0;
+    };
+
+    [[nodiscard]] auto entry(FqdnId id) const -> Entry&
+    {
+        return blocks[id >> BLOCK_BITS].load(std::memory_order_acquire)[id & (BLOCK_SIZE - 1)];
+    }
+    auto addLocked(std::string_view fqdn, uint32_t refs) -> FqdnId;
+
+    // Entries are stored in fixed blocks and never move
+    std::array<std::atomic<Entry*>, MAX_BLOCKS> blocks {};
+    std::atomic<uint32_t> count = 0;
+    std::atomic<size_t> live = 0;
+    // Fqdns stored as Unknown once the table is full
+    std::atomic<uint64_t> dropped = 0;
+
+    std::shared_mutex mutex;
+    std::unordered_map<std::string_view, FqdnId> ids;
+    std::vector<FqdnId> freeIds;
+};
+
+/**
+ * Process wide table used by keys and flows
+ */
+auto fqdnTable() -> FqdnTable&;
+
+inline auto internFqdn(std::string_view fqdn) -> FqdnId
+{
+    return fqdnTable().intern(fqdn);
+}
+
+inline auto fqdnString(FqdnId id) -> std::string const&
+{
+    return fqdnTable().get(id);
+}
+
+} // namespace flowstats
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace flowstats {
+
+/**
+ * Space-Saving summary of the heaviest keys.
+ *
+ * At most Capacity keys are tracked. A new key replaces the one with the
+ * lowest count and inherits that count, so a count overestimates the real
+ * weight by at most the minimum count. Any key weighing more than
+ * total / Capacity is guaranteed to be tracked.
+ *
+ * Next to its count, each key has a Stats filled by the caller. Stats only
+ * accumulate from the moment the key entered the summary and need
+ * an operator+= for merges.
+ */
+template <typename Key, typename Stats, size_t Capacity>
+class HeavyHitters {
+public:
+    HeavyHitters() = default;
+
+    [[nodiscard]] auto size() const -> size_t { return used; }
+
+    /**
+     * Add weight to key and return its stats
+     */
+    auto add(Key const& key, uint64_t weight) -> Stats*
+    {
+        return &stats[slotFor(key, weight)];
+    }
+
+    /**
+     * A key missing from a full summary weighs at most its minimum count,
+     * which is added to the key's count from the other summary. The
+     * Capacity heaviest keys of both summaries are kept.
+     */
+    auto merge(HeavyHitters const& other) -> void
+    {
+        auto minCount = getMinCount();
+        auto otherMinCount = other.getMinCount();
+        std::array<bool, Capacity> merged {};
+        for (size_t i = 0; i < used; ++i) {
+            auto j = other.find(keys[i]);
+            if (j == other.used) {
+                counts[i] += otherMinCount;
+                continue;
+            }
+            counts[i] += other.counts[j];
+            stats[i] += other.stats[j];
+            merged[j] = true;
+        }
+
+        for (size_t j = 0; j < other.used; ++j) {
+            if (merged[j]) {
+                continue;
+            }
+            auto count = other.counts[j] + minCount;
+            size_t slot = used;
+            if (used < Capacity) {
+                used++;
+            } else {
+                slot = std::min_element(counts.begin(), counts.end()) - counts.begin();
+                if (counts[slot] >= count) {
+                    continue;
+                }
+            }
+            keys[slot] = other.keys[j];
+            counts[slot] = count;
+            stats[slot] = other.stats[j];
+        }
+    }
+
+    auto clear() -> void { used = 0; }
+
+    /**
+     * The k keys with the highest counts, heaviest first
+     */
+    [[nodiscard]] auto top(size_t k) const -> std::vector<std::pair<Key, Stats>>
+    {
+        std::array<size_t, Capacity> order;
+        for (size_t i = 0; i < used; ++i) {
+            order[i] = i;
+        }
+        k = std::min(k, used);
+        std::partial_sort(order.begin(), order.begin() + k, order.begin() + used,
+            [this](size_t l, size_t r) { return counts[l] > counts[r]; });
+
+        std::vector<std::pair<Key, Stats>> res;
+        res.reserve(k);
+        for (size_t i = 0; i < k; ++i) {
+            res.emplace_back(keys[order[i]], stats[order[i]]);
+        }
+        return res;
+    }
+
+private:
+    [[nodiscard]] auto find(Key const& key) const -> size_t
+    {
+        for (size_t i = 0; i < used; ++i) {
+            if (keys[i] == key) {
+                return i;
+            }
+        }
+        return used;
+    }
+
+    [[nodiscard]] auto getMinCount() const -> uint64_t
+    {
+        if (used < Capacity) {
+            return 0;
+        }
+        return *std::min_element(counts.begin(), counts.end());
+    }
+
+    auto slotFor(Key const& key, uint64_t weight) -> size_t
+    {
+        auto i = find(key);
+        if (i < used) {
+            counts[i] += weight;
+            return i;
+        }
+
+        size_t slot = used;
+        uint64_t inherited = 0;
+        if (used < Capacity) {
+            used++;
+        } else {
+            slot = std::min_element(counts.begin(), counts.end()) - counts.begin();
+            inherited = counts[slot];
+        }
+        keys[slot] = key;
+        counts[slot] = inherited + weight;
+        stats[slot] = {};
+        return slot;
+    }
+
+    size_t used = 0;
+    std::array<Key, Capacity> keys;
+    std::array<uint64_t, Capacity> counts;
+    std::array<Stats, Capacity> stats;
+};
+
+} // namespace flowstats
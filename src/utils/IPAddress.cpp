@@ -1,8 +1,24 @@
 #include "IPAddress.hpp"
+#include <cstring>
 #include <functional>
 
 namespace flowstats {
 
+auto IPAddress::fromIpv4(uint8_t const* data) -> IPAddress
+{
+    IPAddress res;
+    memcpy(res.address.data(), data, 4);
+    return res;
+}
+
+auto IPAddress::fromIpv6(uint8_t const* data) -> IPAddress
+{
+    IPAddress res;
+    memcpy(res.address.data(), data, 16);
+    res.isV6 = true;
+    return res;
+}
+
 auto IPAddress::getAddrStr() const -> std::string
 {
     return getAddrV4().to_string();
@@ -20,14 +36,4 @@ auto IPAddress::getAddrV6() const -> Tins::IPv6Address
     return stream.read<Tins::IPv6Address>();
 }
 
-auto IPAddress::operator=(IPAddress&& ipAddress) noexcept -> IPAddress&
-{
-    if (this == &ipAddress) {
-        return *this;
-    }
-    address = ipAddress.address;
-    isV6 = ipAddress.isV6;
-    return *this;
-}
-
 } // namespace flowstats
@@ -1,8 +1,10 @@
 #pragma once
+#include <cstring>
 #include <tins/ip.h>
 #include <tins/ip_address.h>
 #include <tins/ipv6_address.h>
 #include <tins/memory_helpers.h>
+#include <type_traits>
 
 namespace flowstats {
 
@@ -10,8 +12,6 @@ class IPAddress {
 
 public:
     IPAddress() = default;
-    IPAddress(IPAddress const& other) = default;
-    virtual ~IPAddress() = default;
 
     explicit IPAddress(Tins::IPv4Address ipv4)
     {
@@ -30,7 +30,12 @@ public:
     explicit IPAddress(std::array<uint8_t, 16> address)
         : address(address) {};
 
+    // Build from network order bytes, same layout as the Tins constructors
+    static auto fromIpv4(uint8_t const* data) -> IPAddress;
+    static auto fromIpv6(uint8_t const* data) -> IPAddress;
+
     [[nodiscard]] auto getIsV6() const -> bool { return isV6; };
+    [[nodiscard]] auto getAddress() const -> std::array<uint8_t, 16> const& { return address; };
     [[nodiscard]] auto getAddrV4() const -> Tins::IPv4Address;
     [[nodiscard]] auto getAddrV6() const -> Tins::IPv6Address;
     [[nodiscard]] auto getAddrStr() const -> std::string;
@@ -45,14 +50,13 @@ public:
         return address == b.address;
     }
 
-    auto operator=(IPAddress&& other) noexcept -> IPAddress&;
-    auto operator=(IPAddress const& other) noexcept -> IPAddress& = default;
-
 private:
     std::array<uint8_t, 16> address = {};
     bool isV6 = false;
 };
 
+static_assert(std::is_trivially_copyable_v<IPAddress>, "Addresses are copied with the flow keys");
+
 typedef std::array<IPAddress, 2> IPAddressPair;
 
 } // namespace flowstats
@@ -63,10 +67,14 @@ template <>
 struct hash<flowstats::IPAddress> {
     auto operator()(const flowstats::IPAddress& addr) const -> size_t
     {
-        if (addr.getIsV6()) {
-            return std::hash<Tins::IPv6Address>()(addr.getAddrV6());
-        }
-        return std::hash<Tins::IPv4Address>()(addr.getAddrV4());
+        // Hash the bytes in place rather than building Tins addresses
+        auto const& bytes = addr.getAddress();
+        uint64_t low;
+        uint64_t high;
+        memcpy(&low, bytes.data(), sizeof(low));
+        memcpy(&high, bytes.data() + sizeof(low), sizeof(high));
+        uint64_t hash = (low ^ (high * 0x9e3779b97f4a7c15ULL)) * 0xff51afd7ed558ccdULL;
+        return hash ^ (hash >> 32);
     }
 };
 
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace flowstats {
+
+/**
+ * Longest prefix match over Bytes long addresses in network order.
+ *
+ * Multibit trie with a 16 bits root and 8 bits strides, prefixes are
+ * expanded to the entries they cover so a lookup is one load per level:
+ * at most 3 for an ipv4 address. An entry either holds a value or points
+ * to a 256 entries chunk of the next byte.
+ *
+ * Lookups don't modify the table and can run concurrently once all
+ * prefixes are inserted.
+ */
+template <size_t Bytes>
+class PrefixTable {
+    static_assert(Bytes >= 2, "The root consumes 2 bytes");
+
+public:
+    PrefixTable()
+        : entries(ROOT_SIZE, 0)
+        , lengths(ROOT_SIZE, 0)
+    {
+    }
+
+    /**
+     * Map addresses starting with the prefixLen first bits of addr to a
+     * non zero value, a longer prefix wins regardless of insertion order
+     */
+    auto insert(uint8_t const* addr, size_t prefixLen, uint32_t value) -> void
+    {
+        assert(value != 0 && (value & CHILD) == 0);
+        prefixLen = std::min(prefixLen, Bytes * 8);
+        size_t base = 0;
+        size_t index = (addr[0] << 8) | addr[1];
+        size_t levelEnd = ROOT_BITS;
+        for (size_t byte = 2; prefixLen > levelEnd; ++byte) {
+            if ((entries[base + index] & CHILD) == 0) {
+                entries[base + index] = CHILD | addChunk(entries[base + index], lengths[base + index]);
+            }
+            base = chunkBase(entries[base + index]);
+            index = addr[byte];
+            levelEnd += 8;
+        }
+
+        size_t freeBits = levelEnd - prefixLen;
+        size_t first = (index >> freeBits) << freeBits;
+        for (size_t i = first; i < first + (size_t(1) << freeBits); ++i) {
+            fill(base + i, prefixLen, value);
+        }
+        numPrefixes++;
+    }
+
+    [[nodiscard]] auto find(uint8_t const* addr) const -> std::optional<uint32_t>
+    {
+        auto entry = entries[(addr[0] << 8) | addr[1]];
+        for (size_t byte = 2; (entry & CHILD) != 0; ++byte) {
+            entry = entries[chunkBase(entry) + addr[byte]];
+        }
+        if (entry == 0) {
+            return {};
+        }
+        return entry;
+    }
+
+    [[nodiscard]] auto size() const -> size_t { return numPrefixes; }
+    [[nodiscard]] auto empty() const -> bool { return numPrefixes == 0; }
+
+private:
+    static size_t const ROOT_BITS = 16;
+    static size_t const ROOT_SIZE = size_t(1) << ROOT_BITS;
+    static size_t const CHUNK_SIZE = 256;
+    static uint32_t const CHILD = 0x80000000;
+
+    static auto chunkBase(uint32_t entry) -> size_t
+    {
+        return ROOT_SIZE + static_cast<size_t>(entry & ~CHILD) * CHUNK_SIZE;
+    }
+
+    /**
+     * New chunk inheriting the value of the entry it replaces
+     */
+    auto addChunk(uint32_t value, uint8_t length) -> uint32_t
+    {
+        auto chunk = static_cast<uint32_t>((entries.size() - ROOT_SIZE) / CHUNK_SIZE);
+        entries.resize(entries.size() + CHUNK_SIZE, value);
+        lengths.resize(lengths.size() + CHUNK_SIZE, length);
+        return chunk;
+    }
+
+    /**
+     * Set the entry unless a longer prefix already covers it
+     */
+    auto fill(size_t pos, size_t prefixLen, uint32_t value) -> void
+    {
+        if ((entries[pos] & CHILD) != 0) {
+            auto base = chunkBase(entries[pos]);
+            for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+                fill(base + i, prefixLen, value);
+            }
+            return;
+        }
+        if (lengths[pos] <= prefixLen) {
+            entries[pos] = value;
+            lengths[pos] = static_cast<uint8_t>(prefixLen);
+        }
+    }
+
+    std::vector<uint32_t> entries;
+    // Length of the prefix an entry was expanded from, only used by inserts
+    std::vector<uint8_t> lengths;
+    size_t numPrefixes = 0;
+};
+
+} // namespace flowstats
@@ -0,0 +1,372 @@
+#pragma once
+
+#include "ThreadSlots.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+
+namespace flowstats {
+
+/**
+ * Grace periods for readers of an atomically swapped pointer.
+ *
+ * Readers announce themselves in the counter of the current epoch and
+ * never block. Each thread counts itself in its own cache line so
+ * concurrent lookups don't bounce a shared counter. synchronize flips the
+ * epoch and waits until no reader is left in the previous one, after
+ * which a retired version can be freed.
+ */
+class Rcu {
+    struct alignas(CACHE_LINE_SIZE) Readers {
+        std::array<std::atomic<uint64_t>, 2> count {};
+    };
+
+public:
+    class ReadGuard {
+    public:
+        explicit ReadGuard(Rcu const& rcu)
+            : readers(rcu.readers[threadSlot()])
+        {
+            // Retry if the epoch flipped before we were counted, so
+            // synchronize never misses us
+            while (true) {
+                parity = rcu.epoch.load() & 1;
+                readers.count[parity].fetch_add(1);
+                if ((rcu.epoch.load() & 1) == parity) {
+                    break;
+                }
+                readers.count[parity].fetch_sub(1, std::memory_order_release);
+            }
+        }
+        ~ReadGuard() { readers.count[parity].fetch_sub(1, std::memory_order_release); }
+        ReadGuard(ReadGuard const&) = delete;
+        auto operator=(ReadGuard const&) -> ReadGuard& = delete;
+
+    private:
+        Readers& readers;
+        uint64_t parity = 0;
+    };
+
+    /**
+     * Wait for the readers that may see a version replaced before the call.
+     * Writers need to be serialized.
+     */
+    auto synchronize() -> void
+    {
+        auto parity = epoch.fetch_add(1) & 1;
+        for (auto const& slot : readers) {
+            while (slot.count[parity].load() != 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    std::atomic<uint64_t> epoch = 0;
+    mutable std::array<Readers, THREAD_SLOTS> readers {};
+};
+
+/**
+ * Hash map with lock free lookups and a bounded number of entries.
+ *
+ * A slot is bound to its key for the lifetime of a table and values are
+ * updated in place with atomic stores, so a lookup never waits on a
+ * writer. Erased keys leave a deleted slot that a new insert of the same
+ * key revives. Writers are serialized by an internal mutex.
+ *
+ * Once maxEntries keys are stored, inserting a new key evicts one with
+ * the CLOCK algorithm: lookups set a reference bit, the hand clears it
+ * and evicts the first unreferenced and unpinned entry. onEvict is called
+ * with its value, under the writer lock.
+ *
+ * When used and deleted slots reach half the table, a compacted table,
+ * larger if needed, is published and the previous one is freed after a
+ * grace period.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class RcuHashMap {
+    static_assert(std::is_trivially_copyable<Key>::value, "Keys are read while published");
+    static_assert(std::atomic<Value>::is_always_lock_free, "Values are updated in place");
+
+public:
+    explicit RcuHashMap(size_t initialCapacity = 1024,
+        size_t maxEntries = std::numeric_limits<size_t>::max(),
+        std::function<void(Value const&)> onEvict = {})
+        : maxEntries(std::max<size_t>(maxEntries, 1))
+        , onEvict(std::move(onEvict))
+    {
+        size_t capacity = 16;
+        while (capacity < initialCapacity) {
+            capacity *= 2;
+        }
+        table.store(new Table(capacity));
+    }
+
+    ~RcuHashMap() { delete table.load(); }
+    RcuHashMap(RcuHashMap const&) = delete;
+    auto operator=(RcuHashMap const&) -> RcuHashMap& = delete;
+
+    [[nodiscard]] auto find(Key const& key) const -> std::optional<Value>
+    {
+        Rcu::ReadGuard guard(rcu);
+        auto const* current = table.load(std::memory_order_acquire);
+        auto const* slot = findSlot(current, key);
+        if (slot == nullptr || slot->state.load(std::memory_order_acquire) == DELETED) {
+            return {};
+        }
+        // Avoid dirtying the cache line when the bit is already set
+        if (!slot->referenced.load(std::memory_order_relaxed)) {
+            slot->referenced.store(true, std::memory_order_relaxed);
+        }
+        return slot->value.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Keep what a value refers to alive past a lookup: writers calling
+     * synchronize wait for the guard to be released
+     */
+    [[nodiscard]] auto readGuard() const -> Rcu::ReadGuard { return Rcu::ReadGuard(rcu); }
+
+    auto synchronize() -> void
+    {
+        const std::lock_guard<std::mutex> lock(writeMutex);
+        rcu.synchronize();
+    }
+
+    /**
+     * Like find, without counting as a reference for eviction
+     */
+    [[nodiscard]] auto peek(Key const& key) const -> std::optional<Value>
+    {
+        Rcu::ReadGuard guard(rcu);
+        auto const* slot = findSlot(table.load(std::memory_order_acquire), key);
+        if (slot == nullptr || slot->state.load(std::memory_order_acquire) == DELETED) {
+            return {};
+        }
+        return slot->value.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Insert or update key and return the previous value. Pinned entries
+     * are never evicted.
+     */
+    auto insert(Key const& key, Value const& value, bool pinned = false) -> std::optional<Value>
+    {
+        const std::lock_guard<std::mutex> lock(writeMutex);
+        auto* current = table.load(std::memory_order_relaxed);
+        auto* slot = findSlot(current, key);
+        if (slot != nullptr && slot->state.load(std::memory_order_relaxed) != DELETED) {
+            auto previous = slot->value.load(std::memory_order_relaxed);
+            slot->value.store(value, std::memory_order_relaxed);
+            slot->pinned = slot->pinned || pinned;
+            return previous;
+        }
+
+        if (numEntries.load(std::memory_order_relaxed) >= maxEntries) {
+            evictLocked();
+        }
+        if (slot == nullptr) {
+            if ((usedSlots + 1) * 2 > current->mask + 1) {
+                current = rebuildLocked(1);
+            }
+            slot = store(current, key, value);
+            usedSlots++;
+        } else {
+            slot->value.store(value, std::memory_order_relaxed);
+            slot->state.store(USED, std::memory_order_release);
+        }
+        slot->pinned = pinned;
+        slot->referenced.store(false, std::memory_order_relaxed);
+        numEntries.fetch_add(1, std::memory_order_relaxed);
+        return {};
+    }
+
+    /**
+     * Size the table for numKeys entries, avoiding rebuilds on bulk loads
+     */
+    auto reserve(size_t numKeys) -> void
+    {
+        const std::lock_guard<std::mutex> lock(writeMutex);
+        auto const* current = table.load(std::memory_order_relaxed);
+        if ((usedSlots + numKeys) * 2 > current->mask + 1) {
+            rebuildLocked(numKeys);
+        }
+    }
+
+    auto erase(Key const& key) -> bool
+    {
+        const std::lock_guard<std::mutex> lock(writeMutex);
+        auto* slot = findSlot(table.load(std::memory_order_relaxed), key);
+        if (slot == nullptr || slot->state.load(std::memory_order_relaxed) == DELETED) {
+            return false;
+        }
+        slot->state.store(DELETED, std::memory_order_release);
+        numEntries.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    [[nodiscard]] auto size() const -> size_t { return numEntries.load(std::memory_order_relaxed); }
+    [[nodiscard]] auto getEvictions() const -> uint64_t { return evictions.load(std::memory_order_relaxed); }
+
+    /**
+     * Visit all entries, concurrent updates may or may not be seen
+     */
+    template <typename Fun>
+    auto forEach(Fun fun) const -> void
+    {
+        Rcu::ReadGuard guard(rcu);
+        auto const* current = table.load(std::memory_order_acquire);
+        for (size_t i = 0; i <= current->mask; ++i) {
+            auto const& slot = current->slots[i];
+            if (slot.state.load(std::memory_order_acquire) == USED) {
+                fun(slot.key, slot.value.load(std::memory_order_relaxed));
+            }
+        }
+    }
+
+private:
+    enum State : uint8_t {
+        EMPTY,
+        USED,
+        DELETED,
+    };
+
+    struct Slot {
+        std::atomic<State> state = EMPTY;
+        mutable std::atomic<bool> referenced = false;
+        // Only accessed by writers
+        bool pinned = false;
+        Key key = {};
+        std::atomic<Value> value = {};
+    };
+
+    struct Table {
+        explicit Table(size_t capacity)
+            : mask(capacity - 1)
+            , slots(new Slot[capacity])
+        {
+        }
+        size_t mask;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    static auto slotIndex(Key const& key, size_t mask) -> size_t
+    {
+        // Spread keys whose hash is the identity, like ip addresses
+        uint64_t h = Hash()(key);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h & mask;
+    }
+
+    /**
+     * The used or deleted slot of key
+     */
+    static auto findSlot(Table* current, Key const& key) -> Slot*
+    {
+        for (size_t i = slotIndex(key, current->mask);; i = (i + 1) & current->mask) {
+            auto& slot = current->slots[i];
+            if (slot.state.load(std::memory_order_acquire) == EMPTY) {
+                return nullptr;
+            }
+            if (slot.key == key) {
+                return &slot;
+            }
+        }
+    }
+
+    static auto findSlot(Table const* current, Key const& key) -> Slot const*
+    {
+        return findSlot(const_cast<Table*>(current), key);
+    }
+
+    static auto store(Table* dest, Key const& key, Value const& value) -> Slot*
+    {
+        for (size_t i = slotIndex(key, dest->mask);; i = (i + 1) & dest->mask) {
+            auto& slot = dest->slots[i];
+            if (slot.state.load(std::memory_order_relaxed) == EMPTY) {
+                slot.key = key;
+                slot.value.store(value, std::memory_order_relaxed);
+                slot.state.store(USED, std::memory_order_release);
+                return &slot;
+            }
+        }
+    }
+
+    auto evictLocked() -> void
+    {
+        auto* current = table.load(std::memory_order_relaxed);
+        // Two turns clear every reference bit, pinned entries may fill the
+        // table in which case nothing is evicted
+        for (size_t n = 0; n < 2 * (current->mask + 1); ++n) {
+            auto& slot = current->slots[clockHand];
+            clockHand = (clockHand + 1) & current->mask;
+            if (slot.state.load(std::memory_order_relaxed) != USED || slot.pinned) {
+                continue;
+            }
+            if (slot.referenced.load(std::memory_order_relaxed)) {
+                slot.referenced.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            slot.state.store(DELETED, std::memory_order_release);
+            numEntries.fetch_sub(1, std::memory_order_relaxed);
+            evictions.fetch_add(1, std::memory_order_relaxed);
+            if (onEvict) {
+                onEvict(slot.value.load(std::memory_order_relaxed));
+            }
+            return;
+        }
+    }
+
+    /**
+     * Publish a table without deleted slots, keeping the live entries and
+     * the newEntries to come under a quarter of it
+     */
+    auto rebuildLocked(size_t newEntries) -> Table*
+    {
+        auto* current = table.load(std::memory_order_relaxed);
+        size_t capacity = current->mask + 1;
+        while ((numEntries.load(std::memory_order_relaxed) + newEntries) * 4 > capacity) {
+            capacity *= 2;
+        }
+        auto* rebuilt = new Table(capacity);
+        usedSlots = 0;
+        for (size_t i = 0; i <= current->mask; ++i) {
+            auto const& slot = current->slots[i];
+            if (slot.state.load(std::memory_order_relaxed) != USED) {
+                continue;
+            }
+            auto* copy = store(rebuilt, slot.key, slot.value.load(std::memory_order_relaxed));
+            copy->pinned = slot.pinned;
+            copy->referenced.store(slot.referenced.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            usedSlots++;
+        }
+        clockHand = 0;
+        table.store(rebuilt, std::memory_order_release);
+        rcu.synchronize();
+        delete current;
+        return rebuilt;
+    }
+
+    std::atomic<Table*> table;
+    size_t const maxEntries;
+    std::function<void(Value const&)> onEvict;
+    std::atomic<size_t> numEntries = 0;
+    std::atomic<uint64_t> evictions = 0;
+    // Used and deleted slots of the current table
+    size_t usedSlots = 0;
+    size_t clockHand = 0;
+    std::mutex writeMutex;
+    Rcu rcu;
+};
+
+} // namespace flowstats
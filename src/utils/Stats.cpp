@@ -5,40 +5,93 @@
 
 namespace flowstats {
 
+auto Percentile::bucketIndex(uint32_t point) -> size_t
+{
+    if (point < EXACT_LIMIT) {
+        return point;
+    }
+    int shift = 31 - __builtin_clz(point) - SUB_BUCKET_BITS;
+    return EXACT_LIMIT + (shift - 1) * SUB_BUCKETS + ((point >> shift) - SUB_BUCKETS);
+}
+
+/**
+ * Middle of the range of values counted by the bucket
+ */
+auto Percentile::bucketValue(size_t index) -> uint32_t
+{
+    if (index < EXACT_LIMIT) {
+        return index;
+    }
+    auto shift = (index - EXACT_LIMIT) / SUB_BUCKETS + 1;
+    uint64_t low = static_cast<uint64_t>(index % SUB_BUCKETS + SUB_BUCKETS) << shift;
+    return low + (uint64_t(1) << (shift - 1));
+}
+
 auto Percentile::merge() -> void
 {
-    std::sort(points.begin(), points.end());
+    // Buckets are always ready to be read
 }
 
 auto Percentile::addPoint(uint32_t point) -> void
 {
-    return points.push_back(point);
+    auto index = bucketIndex(point);
+    if (index >= buckets.size()) {
+        buckets.resize(index + 1);
+    }
+    buckets[index]++;
+    if (count == 0 || point < minPoint) {
+        minPoint = point;
+    }
+    maxPoint = std::max(maxPoint, point);
+    count++;
 }
 
 auto Percentile::addPoints(Percentile const& perc) -> void
 {
-    points.insert(points.end(), perc.points.begin(), perc.points.end());
+    if (perc.count == 0) {
+        return;
+    }
+    if (perc.buckets.size() > buckets.size()) {
+        buckets.resize(perc.buckets.size());
+    }
+    for (size_t i = 0; i < perc.buckets.size(); ++i) {
+        buckets[i] += perc.buckets[i];
+    }
+    minPoint = count == 0 ? perc.minPoint : std::min(minPoint, perc.minPoint);
+    maxPoint = std::max(maxPoint, perc.maxPoint);
+    count += perc.count;
 }
 
 auto Percentile::getCount() const -> int
 {
-    return points.size();
+    return count;
 }
 
 auto Percentile::getPercentile(float p) const -> uint32_t
 {
-    if (points.size() == 0) {
+    if (count == 0) {
         return 0;
     }
     if (p == 0) {
-        return points[0];
+        return minPoint;
+    }
+    auto rank = static_cast<uint64_t>(floor(count * p + 0.5));
+    if (rank >= count) {
+        return maxPoint;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::clamp(bucketValue(i), minPoint, maxPoint);
+        }
     }
-    return points[floor(points.size() * p + 0.5) - 1];
+    return maxPoint;
 }
 
 auto Percentile::getPercentileStr(float p) const -> std::string
 {
-    if (points.size() == 0) {
+    if (count == 0) {
         return "-";
     }
     uint32_t res = getPercentile(p);
@@ -47,12 +100,16 @@ auto Percentile::getPercentileStr(float p) const -> std::string
 
 auto Percentile::reset() -> void
 {
-    points.clear();
+    std::fill(buckets.begin(), buckets.end(), 0);
+    count = 0;
+    minPoint = 0;
+    maxPoint = 0;
 }
 
 auto Percentile::resetAndShrink() -> void
 {
-    points.clear();
-    points.shrink_to_fit();
+    reset();
+    buckets.clear();
+    buckets.shrink_to_fit();
 }
 } // namespace flowstats
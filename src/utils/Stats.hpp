@@ -7,6 +7,14 @@
 
 namespace flowstats {
 
+/**
+ * Log-linear histogram of points.
+ *
+ * Values under 128 are counted exactly, above that every power of two is
+ * split in 64 buckets, so a percentile is within 1% of the real value.
+ * Memory is bounded by the largest value seen (at most ~1700 buckets) and
+ * merging two percentiles only adds their buckets.
+ */
 class Percentile {
 public:
     Percentile() = default;
@@ -21,10 +29,19 @@ public:
     [[nodiscard]] auto getPercentile(float percentile) const -> uint32_t;
     [[nodiscard]] auto getPercentileStr(float p) const -> std::string;
     [[nodiscard]] auto getCount() const -> int;
-    [[nodiscard]] auto getPoints() const -> std::vector<uint32_t> { return points; };
 
 private:
-    std::vector<uint32_t> points;
+    static int const SUB_BUCKET_BITS = 6;
+    static uint32_t const SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static uint32_t const EXACT_LIMIT = 2 * SUB_BUCKETS;
+
+    [[nodiscard]] static auto bucketIndex(uint32_t point) -> size_t;
+    [[nodiscard]] static auto bucketValue(size_t index) -> uint32_t;
+
+    std::vector<uint64_t> buckets;
+    uint64_t count = 0;
+    uint32_t minPoint = 0;
+    uint32_t maxPoint = 0;
 };
 
 class CaptureStat {
@@ -34,8 +51,20 @@ public:
         : recv(pcapStat.ps_recv)
         , drop(pcapStat.ps_drop)
         , ifDrop(pcapStat.ps_ifdrop) {};
+    CaptureStat(unsigned int recv, unsigned int drop, unsigned int ifDrop)
+        : recv(recv)
+        , drop(drop)
+        , ifDrop(ifDrop) {};
     virtual ~CaptureStat() = default;
 
+    auto operator+=(CaptureStat const& other) -> CaptureStat&
+    {
+        recv += other.recv;
+        drop += other.drop;
+        ifDrop += other.ifDrop;
+        return *this;
+    }
+
     [[nodiscard]] auto getRate(std::optional<CaptureStat> const& previousStat)
     {
         auto rateRecv = recv;
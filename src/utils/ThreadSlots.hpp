@@ -0,0 +1,23 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace flowstats {
+
+// Threads get their own slot in per thread counters, worker threads
+// beyond this share slots
+size_t const THREAD_SLOTS = 64;
+size_t const CACHE_LINE_SIZE = 64;
+
+/**
+ * Slot of the calling thread, assigned on its first call
+ */
+inline auto threadSlot() -> size_t
+{
+    static std::atomic<size_t> nextSlot = 0;
+    thread_local size_t const slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % THREAD_SLOTS;
+    return slot;
+}
+
+} // namespace flowstats
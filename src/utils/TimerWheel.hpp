@@ -0,0 +1,202 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace flowstats {
+
+/**
+ * Hierarchical timer wheel with 4 levels of 256 slots.
+ *
+ * Level 0 has one slot per tick, every level above covers 256 times the
+ * span of the previous one. Each time the lower level wraps, the current
+ * slot of the upper level is cascaded down. Advancing the clock only
+ * touches the slots whose time has come, and stretches without timers are
+ * skipped, so expiry costs O(expired) instead of O(timers).
+ *
+ * Timers can't be cancelled. Owners are expected to re-arm lazily: keep
+ * a single timer per key, and when it fires, check the real deadline and
+ * schedule again if it moved.
+ */
+template <typename Key>
+class TimerWheel {
+public:
+    explicit TimerWheel(uint64_t tickMs = 10)
+        : tickMs(tickMs) {};
+
+    [[nodiscard]] auto size() const -> size_t { return numTimers; }
+
+    /**
+     * Fire onExpire(key) once deadlineMs is reached. Deadlines in the past
+     * fire on the next tick.
+     */
+    auto schedule(Key const& key, uint64_t deadlineMs) -> void
+    {
+        auto deadlineTick = deadlineMs / tickMs;
+        if (deadlineTick <= currentTick) {
+            deadlineTick = currentTick + 1;
+        }
+        insert({ key, deadlineTick });
+    }
+
+    /**
+     * Move the clock to nowMs and call onExpire on all timers expired
+     * meanwhile. onExpire may schedule new timers.
+     */
+    template <typename F>
+    auto advance(uint64_t nowMs, F&& onExpire) -> void
+    {
+        auto nowTick = nowMs / tickMs;
+        if (nowTick <= currentTick) {
+            return;
+        }
+        if (numTimers == 0) {
+            currentTick = nowTick;
+            return;
+        }
+        if (nowTick - currentTick >= WHEEL_RANGE) {
+            drain(nowTick, onExpire);
+            return;
+        }
+
+        while (currentTick < nowTick) {
+            int level = lowestUsedLevel();
+            if (level == LEVELS) {
+                currentTick = nowTick;
+                return;
+            }
+            if (level > 0) {
+                // Nothing can fire before the next cascade of this level
+                uint64_t nextCascade = (currentTick | (levelSpan(level) - 1)) + 1;
+                if (nextCascade > nowTick) {
+                    currentTick = nowTick;
+                    return;
+                }
+                currentTick = nextCascade - 1;
+            }
+            currentTick++;
+            cascade();
+            expireCurrentSlot(onExpire);
+        }
+    }
+
+private:
+    static int const LEVELS = 4;
+    static int const SLOT_BITS = 8;
+    static size_t const SLOTS = 1 << SLOT_BITS;
+    static uint64_t const SLOT_MASK = SLOTS - 1;
+    static uint64_t const WHEEL_RANGE = uint64_t(1) << (SLOT_BITS * LEVELS);
+
+    struct Timer {
+        Key key;
+        uint64_t deadlineTick;
+    };
+
+    static auto levelSpan(int level) -> uint64_t
+    {
+        return uint64_t(1) << (SLOT_BITS * level);
+    }
+
+    [[nodiscard]] auto lowestUsedLevel() const -> int
+    {
+        int level = 0;
+        while (level < LEVELS && levelSizes[level] == 0) {
+            level++;
+        }
+        return level;
+    }
+
+    /**
+     * Place a timer whose deadline is not before the current tick
+     */
+    auto insert(Timer timer) -> void
+    {
+        auto delta = timer.deadlineTick - currentTick;
+        int level = 0;
+        while (level < LEVELS - 1 && delta >= levelSpan(level + 1)) {
+            level++;
+        }
+        auto shift = SLOT_BITS * level;
+        uint64_t slot;
+        if (delta >= WHEEL_RANGE) {
+            // Out of range, park it in the top level slot cascaded last
+            slot = (currentTick >> shift) & SLOT_MASK;
+        } else {
+            slot = (timer.deadlineTick >> shift) & SLOT_MASK;
+        }
+        wheels[level][slot].push_back(std::move(timer));
+        levelSizes[level]++;
+        numTimers++;
+    }
+
+    auto takeSlot(int level, uint64_t slot, std::vector<Timer>* dst) -> void
+    {
+        auto& timers = wheels[level][slot];
+        levelSizes[level] -= timers.size();
+        numTimers -= timers.size();
+        dst->swap(timers);
+    }
+
+    auto cascade() -> void
+    {
+        for (int level = LEVELS - 1; level > 0; --level) {
+            if ((currentTick & (levelSpan(level) - 1)) != 0) {
+                continue;
+            }
+            auto slot = (currentTick >> (SLOT_BITS * level)) & SLOT_MASK;
+            takeSlot(level, slot, &scratch);
+            for (auto& timer : scratch) {
+                insert(std::move(timer));
+            }
+            scratch.clear();
+        }
+    }
+
+    template <typename F>
+    auto expireCurrentSlot(F&& onExpire) -> void
+    {
+        takeSlot(0, currentTick & SLOT_MASK, &scratch);
+        for (auto const& timer : scratch) {
+            onExpire(timer.key);
+        }
+        scratch.clear();
+    }
+
+    /**
+     * The clock jumped past the whole wheel, check every timer
+     */
+    template <typename F>
+    auto drain(uint64_t nowTick, F&& onExpire) -> void
+    {
+        std::vector<Timer> timers;
+        for (int level = 0; level < LEVELS; ++level) {
+            for (uint64_t slot = 0; slot < SLOTS; ++slot) {
+                auto& slotTimers = wheels[level][slot];
+                std::move(slotTimers.begin(), slotTimers.end(), std::back_inserter(timers));
+                slotTimers.clear();
+            }
+            levelSizes[level] = 0;
+        }
+        numTimers = 0;
+        currentTick = nowTick;
+        for (auto& timer : timers) {
+            if (timer.deadlineTick <= nowTick) {
+                onExpire(timer.key);
+            } else {
+                insert(std::move(timer));
+            }
+        }
+    }
+
+    uint64_t tickMs;
+    uint64_t currentTick = 0;
+    size_t numTimers = 0;
+    std::array<size_t, LEVELS> levelSizes = {};
+    std::array<std::array<std::vector<Timer>, SLOTS>, LEVELS> wheels;
+    std::vector<Timer> scratch;
+};
+
+} // namespace flowstats
@@ -19,10 +19,13 @@ auto getTimevalDeltaMs(timeval start, timeval end) -> uint32_t
     return (end.tv_sec * 1000 + end.tv_usec / 1000) - (start.tv_sec * 1000 + start.tv_usec / 1000);
 }
 
-auto timevalInMs(timeval tv) -> uint32_t
+auto timevalInMs(timeval tv) -> uint64_t
 {
-    uint32_t ms = 1000 * tv.tv_sec + tv.tv_usec / 1000;
-    return ms;
+    // Saturate so maxTimeval stays after every other timestamp
+    if (tv.tv_sec >= std::numeric_limits<time_t>::max() / 1000) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return 1000 * static_cast<uint64_t>(tv.tv_sec) + tv.tv_usec / 1000;
 }
 
 auto getTimevalDeltaS(timeval start, timeval end) -> uint32_t
@@ -150,12 +153,6 @@ auto prettyFormatBytesAverage(int bytes, int duration) -> std::string
     return prettyFormatBytes(bytes / duration);
 }
 
-auto packetToTimeval(const Tins::Packet& packet) -> timeval
-{
-    auto ts = packet.timestamp();
-    return { ts.seconds(), ts.microseconds() };
-}
-
 auto ipv4ToString(uint32_t ipv4) -> std::string
 {
     std::array<uint8_t, 4> ipParts = {
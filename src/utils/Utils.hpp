@@ -12,7 +12,6 @@
 #include <string>
 #include <tins/ip.h>
 #include <tins/ip_address.h>
-#include <tins/packet.h>
 #include <tins/tcp.h>
 #include <tins/udp.h>
 #include <vector>
@@ -25,7 +24,7 @@ namespace flowstats {
 auto caseInsensitiveComp(char c1, char c2) -> bool;
 auto getTimevalDeltaMs(timeval start, timeval end) -> uint32_t;
 auto getTimevalDeltaS(timeval start, timeval end) -> uint32_t;
-auto timevalInMs(timeval tv) -> uint32_t;
+auto timevalInMs(timeval tv) -> uint64_t;
 
 enum Direction {
     FROM_CLIENT,
@@ -57,7 +56,6 @@ auto prettyFormatMs(int ms) -> std::string;
 auto getIpToFqdn(std::vector<std::string> const& initialDomains) -> std::map<uint32_t, std::string>;
 auto getDomainToServerPort(std::vector<std::string> const& initialServerPorts) -> std::map<std::string, uint16_t>;
 
-auto packetToTimeval(Tins::Packet const& packet) -> timeval;
 auto ipv4ToString(uint32_t ipv4) -> std::string;
 auto getTopMapPair(std::map<IPAddress, uint64_t> const& src, int num) -> std::vector<std::pair<IPAddress, uint64_t>>;
 auto getWithWarparound(int currentValue, int max, int delta) -> int;
@@ -0,0 +1,160 @@
+#include "DnsParser.hpp"
+#include "MainTest.hpp"
+#include "PktSource.hpp"
+#include <catch2/catch.hpp>
+#include <cstdlib>
+#include <new>
+#include <pcap/pcap.h>
+
+using namespace flowstats;
+
+namespace {
+thread_local bool countAllocations = false;
+thread_local uint64_t allocations = 0;
+
+auto countedAlloc(std::size_t size) -> void*
+{
+    if (countAllocations) {
+        allocations++;
+    }
+    auto* ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+} // namespace
+
+auto operator new(std::size_t size) -> void* { return countedAlloc(size); }
+auto operator new[](std::size_t size) -> void* { return countedAlloc(size); }
+auto operator delete(void* ptr) noexcept -> void { std::free(ptr); }
+auto operator delete[](void* ptr) noexcept -> void { std::free(ptr); }
+auto operator delete(void* ptr, std::size_t) noexcept -> void { std::free(ptr); }
+auto operator delete[](void* ptr, std::size_t) noexcept -> void { std::free(ptr); }
+
+namespace {
+auto flowCount(TcpStatsCollector const& collector) { return collector.getTcpFlow().size(); }
+auto flowCount(SslStatsCollector const& collector) { return collector.getSslFlow().size(); }
+auto flowCount(DnsStatsCollector const& collector)
+{
+    return collector.getNumPendingQueries() + collector.getNumTcpStreams();
+}
+
+/**
+ * Count the allocations of packets hitting an existing flow. Creating a
+ * flow may allocate the first time its aggregation is seen. Flows closed
+ * by a packet, like an answered dns query, are still counted.
+ */
+template <typename C>
+class AllocationCounter : public C {
+public:
+    using C::C;
+
+    auto processPacket(PacketView const& packet, FlowId const& flowId) -> void override
+    {
+        auto flowsBefore = flowCount(*this);
+        auto allocationsBefore = allocations;
+        countAllocations = counting;
+        C::processPacket(packet, flowId);
+        countAllocations = false;
+        if (flowCount(*this) > flowsBefore) {
+            allocations = allocationsBefore;
+        }
+    }
+
+    bool counting = false;
+};
+} // namespace
+
+TEST_CASE("Packet path doesn't allocate", "[allocation]")
+{
+    if (SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG) {
+        WARN("Debug logs format their arguments, skipping");
+        return;
+    }
+
+    auto pcap = GENERATE(as<std::string> {}, "tcp_simple.pcap", "https.pcap",
+        "ssl_simple.pcap", "tcp_mtu.pcap", "0_win.pcap", "rst_close.pcap",
+        "ipv6.pcap", "testcom.pcap");
+    INFO("Replaying " << pcap);
+    auto fullPath = fmt::format("{}/pcaps/{}", TEST_PATH, pcap);
+
+    FlowstatsConfiguration conf;
+    conf.setDisplayUnknownFqdn(true);
+    DisplayConfiguration displayConf;
+    IpToFqdn ipToFqdn(conf);
+    AllocationCounter<TcpStatsCollector> tcpStatsCollector(conf, displayConf, &ipToFqdn);
+    AllocationCounter<SslStatsCollector> sslStatsCollector(conf, displayConf, &ipToFqdn);
+    std::atomic_bool shouldStop = false;
+    PktSource pktSource(nullptr, conf, { &tcpStatsCollector, &sslStatsCollector }, &shouldStop);
+
+    // The first replay sizes the flow tables, aggregations and percentiles.
+    // Flows are then timed out so the second replay goes through the same
+    // states.
+    REQUIRE(pktSource.readPcapFile(fullPath, "") > 0);
+    tcpStatsCollector.advanceTick(maxTimeval);
+    sslStatsCollector.advanceTick(maxTimeval);
+    tcpStatsCollector.counting = true;
+    sslStatsCollector.counting = true;
+    allocations = 0;
+    REQUIRE(pktSource.readPcapFile(fullPath, "") > 0);
+    CHECK(allocations == 0);
+}
+
+TEST_CASE("Dns path doesn't allocate", "[allocation]")
+{
+    if (SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG) {
+        WARN("Debug logs format their arguments, skipping");
+        return;
+    }
+
+    auto pcap = GENERATE(as<std::string> {}, "dns_simple.pcap", "dns_rcrds.pcap",
+        "dns_tcp.pcap");
+    INFO("Replaying " << pcap);
+    auto fullPath = fmt::format("{}/pcaps/{}", TEST_PATH, pcap);
+
+    FlowstatsConfiguration conf;
+    DisplayConfiguration displayConf;
+    IpToFqdn ipToFqdn(conf);
+    AllocationCounter<DnsStatsCollector> dnsStatsCollector(conf, displayConf, &ipToFqdn);
+    std::atomic_bool shouldStop = false;
+    PktSource pktSource(nullptr, conf, { &dnsStatsCollector }, &shouldStop);
+
+    // The first replay creates the aggregations and the fqdn mappings.
+    // They are kept so responses of the second replay only update them,
+    // while its queries create new transactions.
+    REQUIRE(pktSource.readPcapFile(fullPath, "") > 0);
+    dnsStatsCollector.counting = true;
+    allocations = 0;
+    REQUIRE(pktSource.readPcapFile(fullPath, "") > 0);
+    CHECK(allocations == 0);
+}
+
+TEST_CASE("Dns parser doesn't allocate", "[allocation]")
+{
+    auto pcap = GENERATE(as<std::string> {}, "dns_simple.pcap", "dns_rcrds.pcap");
+    INFO("Parsing " << pcap);
+    auto fullPath = fmt::format("{}/pcaps/{}", TEST_PATH, pcap);
+
+    char errbuf[PCAP_ERRBUF_SIZE];
+    auto* handle = pcap_open_offline(fullPath.c_str(), errbuf);
+    REQUIRE(handle != nullptr);
+    pcap_pkthdr* header;
+    uint8_t const* data;
+    int parsed = 0;
+    allocations = 0;
+    while (pcap_next_ex(handle, &header, &data) == 1) {
+        PacketView packet;
+        if (packet.parseFrame(pcap_datalink(handle), data, header->caplen, header->ts) != PACKET_OK
+            || !packet.isUdp()) {
+            continue;
+        }
+        DnsMessage message;
+        countAllocations = true;
+        parsed += message.parse(packet.getPayload(), packet.getPayloadSize());
+        countAllocations = false;
+    }
+    pcap_close(handle);
+    CHECK(parsed > 0);
+    CHECK(allocations == 0);
+}
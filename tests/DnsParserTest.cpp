@@ -0,0 +1,124 @@
+#include "DnsParser.hpp"
+#include <catch2/catch.hpp>
+#include <vector>
+
+using namespace flowstats;
+
+namespace {
+
+auto header(uint16_t flags, uint16_t numQueries, uint16_t numAnswers) -> std::vector<uint8_t>
+{
+    return {
+        0x12, 0x34, uint8_t(flags >> 8), uint8_t(flags & 0xff),
+        0, uint8_t(numQueries), 0, uint8_t(numAnswers),
+        0, 0, 0, 0
+    };
+}
+
+auto append(std::vector<uint8_t>* dst, std::vector<uint8_t> const& src) -> void
+{
+    dst->insert(dst->end(), src.begin(), src.end());
+}
+
+// www.example.com, A, IN
+std::vector<uint8_t> const QUESTION = {
+    3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+    0, 1, 0, 1
+};
+
+} // namespace
+
+TEST_CASE("DnsMessage query", "[dnsparser]")
+{
+    auto query = header(0x0100, 1, 0);
+    append(&query, QUESTION);
+
+    DnsMessage message;
+    REQUIRE(message.parse(query.data(), query.size()));
+    CHECK(message.getId() == 0x1234);
+    CHECK_FALSE(message.isResponse());
+    CHECK(message.getQname() == "www.example.com");
+    CHECK(message.getQueryType() == Tins::DNS::A);
+
+    // Truncated question
+    CHECK_FALSE(message.parse(query.data(), query.size() - 3));
+    CHECK_FALSE(message.parse(query.data(), 8));
+}
+
+TEST_CASE("DnsMessage lowercases names", "[dnsparser]")
+{
+    auto query = header(0x0100, 1, 0);
+    append(&query, { 3, 'W', 'w', 'W', 7, 'E', 'x', 'A', 'm', 'p', 'l', 'e', 3, 'C', 'O', 'm', 0, 0, 1, 0, 1 });
+
+    DnsMessage message;
+    REQUIRE(message.parse(query.data(), query.size()));
+    CHECK(message.getQname() == "www.example.com");
+}
+
+TEST_CASE("DnsMessage compressed answers", "[dnsparser]")
+{
+    auto response = header(0x8383, 1, 3);
+    append(&response, QUESTION);
+    // CNAME to cdn.example.com, pointing to the question name suffix
+    append(&response, { 0xc0, 12, 0, 5, 0, 1, 0, 0, 0, 60, 0, 6, 3, 'c', 'd', 'n', 0xc0, 16 });
+    // A and AAAA of cdn.example.com
+    append(&response, { 0xc0, 45, 0, 1, 0, 1, 0, 0, 0, 30, 0, 4, 10, 0, 0, 1 });
+    append(&response, { 0xc0, 45, 0, 28, 0, 1, 0, 0, 0, 20, 0, 16 });
+    response.resize(response.size() + 15, 0);
+    response.push_back(1);
+
+    DnsMessage message;
+    REQUIRE(message.parse(response.data(), response.size()));
+    CHECK(message.isResponse());
+    CHECK(message.getTruncated());
+    CHECK(message.getRcode() == 3);
+    CHECK(toResponseCodeType(message.getRcode()) == +ResponseCodeType::RCODE_NXDOMAIN);
+    CHECK(message.getAnswerCount(ResourceRecordType::CNAME) == 1);
+    CHECK(message.getAnswerCount(ResourceRecordType::A) == 1);
+    CHECK(message.getAnswerCount(ResourceRecordType::AAAA) == 1);
+    REQUIRE(message.getNumAddresses() == 2);
+    CHECK_FALSE(message.getAddress(0).isV6);
+    CHECK(message.getAddress(0).ttl == 30);
+    CHECK(message.getAddress(0).data[0] == 10);
+    CHECK(message.getAddress(1).isV6);
+    CHECK(message.getAddress(1).data[15] == 1);
+
+    // rdata past the end of the payload
+    CHECK_FALSE(message.parse(response.data(), response.size() - 1));
+}
+
+TEST_CASE("DnsMessage compression loops", "[dnsparser]")
+{
+    // The question name points to itself
+    auto selfLoop = header(0x0100, 1, 0);
+    append(&selfLoop, { 0xc0, 12, 0, 1, 0, 1 });
+    DnsMessage message;
+    CHECK_FALSE(message.parse(selfLoop.data(), selfLoop.size()));
+
+    // Pointer to a later label
+    auto forward = header(0x0100, 1, 0);
+    append(&forward, { 1, 'a', 0xc0, 18, 0, 1, 0, 1, 0 });
+    CHECK_FALSE(message.parse(forward.data(), forward.size()));
+
+    // Pointer cut by the end of the payload
+    auto cut = header(0x0100, 1, 0);
+    append(&cut, { 1, 'a', 0xc0 });
+    CHECK_FALSE(message.parse(cut.data(), cut.size()));
+
+    // Reserved label type
+    auto reserved = header(0x0100, 1, 0);
+    append(&reserved, { 0x40, 'a', 0, 0, 1, 0, 1 });
+    CHECK_FALSE(message.parse(reserved.data(), reserved.size()));
+}
+
+TEST_CASE("DnsMessage name too long", "[dnsparser]")
+{
+    auto query = header(0x0100, 1, 0);
+    for (int i = 0; i < 5; ++i) {
+        query.push_back(63);
+        query.resize(query.size() + 63, 'a');
+    }
+    append(&query, { 0, 0, 1, 0, 1 });
+    DnsMessage message;
+    CHECK_FALSE(message.parse(query.data(), query.size()));
+}
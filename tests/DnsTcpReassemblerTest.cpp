@@ -0,0 +1,96 @@
+#include "DnsTcpReassembler.hpp"
+#include <catch2/catch.hpp>
+#include <vector>
+
+using namespace flowstats;
+
+namespace {
+
+auto framed(std::vector<uint8_t> const& message) -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> res = { uint8_t(message.size() >> 8), uint8_t(message.size() & 0xff) };
+    res.insert(res.end(), message.begin(), message.end());
+    return res;
+}
+
+auto toVector(DnsTcpMessage const& message) -> std::vector<uint8_t>
+{
+    return { message.data, message.data + message.size };
+}
+
+} // namespace
+
+TEST_CASE("Dns tcp messages in one segment", "[dnstcp]")
+{
+    DnsTcpReassembler reassembler(16);
+    DnsStreamKey key;
+
+    auto segment = framed({ 1, 2, 3 });
+    auto second = framed({ 4, 5 });
+    segment.insert(segment.end(), second.begin(), second.end());
+
+    auto const& messages = reassembler.addSegment(key, 1000, segment.data(), segment.size(), segment.size(), 0);
+    REQUIRE(messages.size() == 2);
+    // Used in place
+    CHECK(messages[0].data == segment.data() + 2);
+    CHECK(toVector(messages[1]) == std::vector<uint8_t> { 4, 5 });
+    CHECK(reassembler.getNumStreams() == 0);
+}
+
+TEST_CASE("Dns tcp messages across segments", "[dnstcp]")
+{
+    DnsTcpReassembler reassembler(16);
+    DnsStreamKey key;
+    auto stream = framed({ 1, 2, 3, 4 });
+    auto next = framed({ 5 });
+    stream.insert(stream.end(), next.begin(), next.end());
+
+    // Length split between segments
+    CHECK(reassembler.addSegment(key, 1000, stream.data(), 1, 1, 0).empty());
+    CHECK(reassembler.getNumStreams() == 1);
+    CHECK(reassembler.addSegment(key, 1001, stream.data() + 1, 3, 3, 0).empty());
+
+    // Retransmission of a seen segment
+    CHECK(reassembler.addSegment(key, 1001, stream.data() + 1, 3, 3, 0).empty());
+
+    // Overlapping retransmission completing both messages
+    auto const& messages = reassembler.addSegment(key, 1002, stream.data() + 2, stream.size() - 2, stream.size() - 2, 0);
+    REQUIRE(messages.size() == 2);
+    CHECK(toVector(messages[0]) == std::vector<uint8_t> { 1, 2, 3, 4 });
+    CHECK(toVector(messages[1]) == std::vector<uint8_t> { 5 });
+
+    // Stream is dropped after being idle
+    reassembler.advanceTick(DNS_TCP_STREAM_TIMEOUT_MS + 100);
+    CHECK(reassembler.getNumStreams() == 0);
+}
+
+TEST_CASE("Dns tcp lost and oversized segments", "[dnstcp]")
+{
+    DnsTcpReassembler reassembler(16);
+    DnsStreamKey key;
+    auto message = framed({ 1, 2, 3, 4 });
+    auto next = framed({ 5 });
+
+    // Gap after a partial message, framing restarts from the new segment
+    CHECK(reassembler.addSegment(key, 1000, message.data(), 3, 3, 0).empty());
+    auto const& afterGap = reassembler.addSegment(key, 1010, next.data(), next.size(), next.size(), 0);
+    REQUIRE(afterGap.size() == 1);
+    CHECK(toVector(afterGap[0]) == std::vector<uint8_t> { 5 });
+
+    // Too large to be buffered, skipped up to the next message
+    std::vector<uint8_t> large(DNS_TCP_MAX_BUFFERED, 0);
+    auto stream = framed(large);
+    stream.insert(stream.end(), next.begin(), next.end());
+    uint32_t half = stream.size() / 2;
+    CHECK(reassembler.addSegment(key, 2000, stream.data(), half, half, 0).empty());
+    auto const& afterSkip = reassembler.addSegment(key, 2000 + half, stream.data() + half,
+        stream.size() - half, stream.size() - half, 0);
+    REQUIRE(afterSkip.size() == 1);
+    CHECK(toVector(afterSkip[0]) == std::vector<uint8_t> { 5 });
+
+    // End of the segment not captured
+    CHECK(reassembler.getNumStreams() == 1);
+    auto const& truncated = reassembler.addSegment(key, 2000 + stream.size(), message.data(), message.size(), 40, 0);
+    CHECK(truncated.size() == 1);
+    CHECK(reassembler.getNumStreams() == 0);
+}
@@ -58,3 +58,63 @@ TEST_CASE("Dns tcp", "[dns]")
     REQUIRE(aggregatedFlows->size() == 1);
 
 }
+
+TEST_CASE("Dns rollup", "[dns]")
+{
+    auto tester = Tester();
+    tester.getFlowstatsConfiguration().setDnsRollupRegistered(true);
+    tester.readPcap("dns_rcrds.pcap");
+
+    auto aggregatedFlows = tester.getDnsStatsCollector().getAggregatedMap();
+    REQUIRE(aggregatedFlows->size() == 1);
+    auto key = AggregatedKey::aggregatedDnsKey("amazonaws.com", Tins::DNS::A, Transport::UDP);
+    CHECK(aggregatedFlows->at(key)->getFieldStr(Field::REQ, FROM_CLIENT, 1, 0) == "1");
+}
+
+TEST_CASE("Dns aggregation limit", "[dns]")
+{
+    auto tester = Tester();
+    tester.getFlowstatsConfiguration().setDnsMaxKeys(1);
+    tester.readPcap("dns_simple.pcap");
+
+    // The first name gets its aggregation, the others go to Other
+    auto aggregatedFlows = tester.getDnsStatsCollector().getAggregatedMap();
+    REQUIRE(aggregatedFlows->size() == 2);
+    auto otherKey = AggregatedKey::aggregatedDnsKey("Other",
+        static_cast<Tins::DNS::QueryType>(0), Transport::UDP);
+    CHECK(aggregatedFlows->count(otherKey) == 1);
+}
+
+TEST_CASE("Dns per resolver", "[dns]")
+{
+    auto tester = Tester();
+    tester.getFlowstatsConfiguration().setDnsPerResolver(true);
+    tester.readPcap("dns_simple.pcap");
+
+    auto aggregatedFlows = tester.getDnsStatsCollector().getAggregatedMap();
+    REQUIRE(aggregatedFlows->size() == 1);
+    auto resolverKey = AggregatedKey(FQDN_NONE, IPAddress(Tins::IPv4Address("192.168.1.254")), 53,
+        static_cast<Tins::DNS::QueryType>(0), Transport::UDP);
+    auto* resolverFlow = aggregatedFlows->at(resolverKey);
+    CHECK(resolverFlow->getFieldStr(Field::REQ, FROM_CLIENT, 1, 0) == "3");
+    CHECK(resolverFlow->getFieldStr(Field::TIMEOUTS, FROM_CLIENT, 1, 0) == "1");
+    CHECK(resolverFlow->getFieldStr(Field::RCODE_NOERROR_RATE, FROM_CLIENT, 1, 0) == "2");
+    CHECK(resolverFlow->getFieldStr(Field::RCODE_SERVFAIL_RATE, FROM_CLIENT, 1, 0) == "0");
+}
+
+TEST_CASE("Dns transaction keys", "[dns]")
+{
+    auto srv = IPAddress(Tins::IPv4Address("10.0.0.53"));
+    auto clt1 = IPAddress(Tins::IPv4Address("10.0.0.1"));
+    auto clt2 = IPAddress(Tins::IPv4Address("10.0.0.2"));
+    auto query = FlowId({ 40000, 53 }, { clt1, srv }, Transport::UDP);
+    auto response = FlowId({ 53, 40000 }, { srv, clt1 }, Transport::UDP);
+    auto otherClient = FlowId({ 40000, 53 }, { clt2, srv }, Transport::UDP);
+
+    auto key = DnsTransactionKey(query, 42, "test.com");
+    CHECK(key == DnsTransactionKey(response, 42, "TeSt.cOm"));
+    CHECK(std::hash<DnsTransactionKey>()(key) == std::hash<DnsTransactionKey>()(DnsTransactionKey(response, 42, "test.com")));
+    CHECK_FALSE(key == DnsTransactionKey(otherClient, 42, "test.com"));
+    CHECK_FALSE(key == DnsTransactionKey(query, 43, "test.com"));
+    CHECK_FALSE(key == DnsTransactionKey(query, 42, "google.com"));
+}
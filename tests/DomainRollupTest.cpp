@@ -0,0 +1,28 @@
+#include "DomainRollup.hpp"
+#include <catch2/catch.hpp>
+
+using namespace flowstats;
+
+TEST_CASE("Registered domain", "[rollup]")
+{
+    CHECK(registeredDomain("www.example.com") == "example.com");
+    CHECK(registeredDomain("a.b.example.co.uk") == "example.co.uk");
+    CHECK(registeredDomain("foo.github.io") == "foo.github.io");
+    CHECK(registeredDomain("bar.foo.github.io") == "foo.github.io");
+    CHECK(registeredDomain("5f3a.svc.cluster.local") == "cluster.local");
+
+    // Nothing left of the public suffix
+    CHECK(registeredDomain("example.com") == "example.com");
+    CHECK(registeredDomain("co.uk") == "co.uk");
+    CHECK(registeredDomain("localhost") == "localhost");
+    CHECK(registeredDomain("") == "");
+}
+
+TEST_CASE("Domain suffix", "[rollup]")
+{
+    CHECK(domainSuffix("a.b.svc.cluster.local", 3) == "svc.cluster.local");
+    CHECK(domainSuffix("a.b.svc.cluster.local", 1) == "local");
+    CHECK(domainSuffix("cluster.local", 3) == "cluster.local");
+    CHECK(domainSuffix("cluster.local", 0) == "cluster.local");
+    CHECK(domainSuffix("", 2) == "");
+}
@@ -0,0 +1,74 @@
+#include "FlatFlowTable.hpp"
+#include <catch2/catch.hpp>
+#include <map>
+#include <random>
+
+using namespace flowstats;
+
+namespace {
+
+// Send every key in a few buckets to exercise long probe sequences and
+// wrap around
+struct CollidingHash {
+    auto operator()(uint32_t key) const -> size_t
+    {
+        return static_cast<size_t>(key % 4) << 7 | (key & 0x7f);
+    }
+};
+
+} // namespace
+
+TEST_CASE("FlatFlowTable insert and erase", "[flattable]")
+{
+    FlatFlowTable<uint32_t, std::string> table(100);
+    auto res = table.emplace(1, "one");
+    CHECK(res.second);
+    CHECK(res.first->second == "one");
+    CHECK_FALSE(table.emplace(1, "other").second);
+    CHECK(table.at(1) == "one");
+    CHECK(table.size() == 1);
+
+    CHECK(table.erase(1) == 1);
+    CHECK(table.erase(1) == 0);
+    CHECK(table.find(1) == table.end());
+    CHECK(table.empty());
+}
+
+TEST_CASE("FlatFlowTable capacity is fixed", "[flattable]")
+{
+    FlatFlowTable<uint32_t, int> table(10);
+    for (uint32_t i = 0; i < 10; ++i) {
+        REQUIRE(table.emplace(i, i).second);
+    }
+    auto res = table.emplace(10, 10);
+    CHECK_FALSE(res.second);
+    CHECK(res.first == table.end());
+    CHECK(table.size() == 10);
+}
+
+TEST_CASE("FlatFlowTable matches std::map under churn", "[flattable]")
+{
+    FlatFlowTable<uint32_t, uint32_t, CollidingHash> table(1000);
+    std::map<uint32_t, uint32_t> reference;
+    std::mt19937 gen(1);
+    for (int i = 0; i < 100000; ++i) {
+        uint32_t key = gen() % 2000;
+        if (gen() % 2 && reference.size() < 1000) {
+            auto inserted = table.emplace(key, i).second;
+            REQUIRE(inserted == reference.emplace(key, i).second);
+        } else {
+            REQUIRE(table.erase(key) == reference.erase(key));
+        }
+    }
+
+    REQUIRE(table.size() == reference.size());
+    size_t iterated = 0;
+    for (auto const& it : table) {
+        REQUIRE(reference.at(it.first) == it.second);
+        iterated++;
+    }
+    CHECK(iterated == reference.size());
+    for (auto const& it : reference) {
+        REQUIRE(table.at(it.first) == it.second);
+    }
+}
@@ -0,0 +1,78 @@
+#include "HeavyHitters.hpp"
+#include <catch2/catch.hpp>
+#include <random>
+
+using namespace flowstats;
+
+namespace {
+
+struct Hits {
+    uint64_t hits = 0;
+
+    auto operator+=(Hits const& other) -> Hits&
+    {
+        hits += other.hits;
+        return *this;
+    }
+};
+
+} // namespace
+
+TEST_CASE("HeavyHitters exact under capacity", "[heavyhitters]")
+{
+    HeavyHitters<int, Hits, 4> heavyHitters;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j <= i; ++j) {
+            heavyHitters.add(i, 1)->hits++;
+        }
+    }
+    CHECK(heavyHitters.size() == 3);
+    auto top = heavyHitters.top(5);
+    REQUIRE(top.size() == 3);
+    CHECK(top[0].first == 2);
+    CHECK(top[0].second.hits == 3);
+    CHECK(top[2].first == 0);
+
+    heavyHitters.clear();
+    CHECK(heavyHitters.top(5).empty());
+}
+
+TEST_CASE("HeavyHitters keeps the heavy keys", "[heavyhitters]")
+{
+    HeavyHitters<uint32_t, Hits, 32> first;
+    HeavyHitters<uint32_t, Hits, 32> second;
+    std::mt19937 gen(1);
+    for (int i = 0; i < 100000; ++i) {
+        // Keys 0 to 4 get 40% of the traffic, the rest is spread over 10k keys
+        auto key = gen() % 10 < 4 ? gen() % 5 : 5 + gen() % 10000;
+        auto& summary = i % 2 ? first : second;
+        summary.add(key, 1)->hits++;
+    }
+    first.merge(second);
+
+    auto top = first.top(5);
+    REQUIRE(top.size() == 5);
+    for (auto const& it : top) {
+        CHECK(it.first < 5);
+        // Stats only miss the hits before the key was last tracked
+        CHECK(it.second.hits > 7000);
+    }
+}
+
+TEST_CASE("HeavyHitters merge bounds missing keys", "[heavyhitters]")
+{
+    HeavyHitters<char, Hits, 2> first;
+    HeavyHitters<char, Hits, 2> second;
+    first.add('a', 10)->hits += 10;
+    first.add('b', 1)->hits += 1;
+    second.add('c', 6)->hits += 6;
+    second.add('d', 5)->hits += 5;
+    first.merge(second);
+
+    // c and d may have weighed up to 1 in first, b up to 5 in second
+    auto top = first.top(2);
+    REQUIRE(top.size() == 2);
+    CHECK(top[0].first == 'a');
+    CHECK(top[1].first == 'c');
+    CHECK(top[1].second.hits == 6);
+}
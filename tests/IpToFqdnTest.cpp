@@ -0,0 +1,203 @@
+#include "Configuration.hpp"
+#include "IpToFqdn.hpp"
+#include <catch2/catch.hpp>
+#include <unistd.h>
+
+using namespace flowstats;
+
+TEST_CASE("IpToFqdn ttl", "[iptofqdn]")
+{
+    FlowstatsConfiguration conf;
+    IpToFqdn ipToFqdn(conf);
+    auto ip = Tins::IPv4Address("10.0.0.1");
+    auto staticIp = Tins::IPv4Address("10.0.0.2");
+
+    ipToFqdn.updateFqdn("static.com", { staticIp }, {});
+    ipToFqdn.updateFqdn("short.com", { ip }, {}, 5, { 1000, 0 });
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(ip)) == "short.com");
+
+    // Short ttls are kept FQDN_MIN_TTL_S
+    ipToFqdn.advanceTick({ 1000 + FQDN_MIN_TTL_S - 1, 0 });
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(ip)) == "short.com");
+
+    // A refresh pushes the expiry
+    ipToFqdn.updateFqdn("short.com", { ip }, {}, 300, { 1000 + FQDN_MIN_TTL_S - 1, 0 });
+    ipToFqdn.advanceTick({ 1000 + FQDN_MIN_TTL_S + 1, 0 });
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(ip)) == "short.com");
+
+    ipToFqdn.advanceTick({ 1000 + FQDN_MIN_TTL_S + 300, 0 });
+    CHECK_FALSE(ipToFqdn.getFlowFqdn(IPAddress(ip)).has_value());
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(staticIp)) == "static.com");
+
+    // static.com and the localhost addresses remain
+    auto stats = ipToFqdn.getStats();
+    CHECK(stats.entries == 3);
+    CHECK(stats.expirations == 1);
+    CHECK(stats.hits == 4);
+    CHECK(stats.misses == 1);
+    CHECK(stats.getHitRate() == Approx(0.8));
+}
+
+TEST_CASE("IpToFqdn pinned refresh", "[iptofqdn]")
+{
+    FlowstatsConfiguration conf;
+    IpToFqdn ipToFqdn(conf);
+    auto staticIp = Tins::IPv4Address("10.0.0.2");
+
+    ipToFqdn.updateFqdn("static.com", { staticIp }, {});
+    // Dns answers don't replace a pinned mapping
+    ipToFqdn.updateFqdn("cdn.com", { staticIp }, {}, 300, { 1000, 0 });
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(staticIp)) == "static.com");
+
+    ipToFqdn.advanceTick({ 1000, 0 });
+    ipToFqdn.advanceTick({ 1000 + 301, 0 });
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(staticIp)) == "static.com");
+    CHECK(ipToFqdn.getStats().expirations == 0);
+}
+
+TEST_CASE("IpToFqdn releases fqdns", "[iptofqdn]")
+{
+    FlowstatsConfiguration conf;
+    conf.setMaxFqdnEntries(8);
+    IpToFqdn ipToFqdn(conf);
+    auto numFqdns = fqdnTable().size();
+    auto numIds = fqdnTable().getNumIds();
+
+    // Evicted mappings release their fqdn, which is recycled on the next
+    // tick
+    for (uint32_t i = 0; i < 1000; ++i) {
+        auto ip = Tins::IPv4Address(0x0a000000 + i);
+        ipToFqdn.updateFqdn(fmt::format("{}.random.com", i), { ip }, {}, 300, { 1000 + i, 0 });
+        ipToFqdn.advanceTick({ 1000 + i, 0 });
+    }
+    CHECK(fqdnTable().size() <= numFqdns + 8);
+    CHECK(fqdnTable().getNumIds() <= numIds + 16);
+
+    // So do expired ones
+    ipToFqdn.advanceTick({ 1000 + 1000 + 300, 0 });
+    CHECK(fqdnTable().size() == numFqdns);
+
+    // A name used by a flow stays after its mapping
+    auto ip = Tins::IPv4Address("10.1.0.1");
+    ipToFqdn.updateFqdn("flow.com", { ip }, {}, 300, { 3000, 0 });
+    auto fqdnId = ipToFqdn.getFlowFqdnId(IPAddress(ip));
+    REQUIRE(fqdnId.has_value());
+    ipToFqdn.advanceTick({ 3000 + 301, 0 });
+    CHECK_FALSE(ipToFqdn.getFlowFqdn(IPAddress(ip)).has_value());
+    CHECK(fqdnString(*fqdnId) == "flow.com");
+}
+
+TEST_CASE("IpToFqdn eviction", "[iptofqdn]")
+{
+    FlowstatsConfiguration conf;
+    // One slot is taken by the pinned localhost address
+    conf.setMaxFqdnEntries(3);
+    IpToFqdn ipToFqdn(conf);
+    auto ip1 = Tins::IPv4Address("10.0.0.1");
+    auto ip2 = Tins::IPv4Address("10.0.0.2");
+    auto ip3 = Tins::IPv4Address("10.0.0.3");
+
+    ipToFqdn.updateFqdn("one.com", { ip1 }, {}, 300, { 1000, 0 });
+    ipToFqdn.updateFqdn("two.com", { ip2 }, {}, 300, { 1000, 0 });
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(ip1)) == "one.com");
+
+    // ip1 was used recently, ip2 goes
+    ipToFqdn.updateFqdn("three.com", { ip3 }, {}, 300, { 1000, 0 });
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(ip1)) == "one.com");
+    CHECK_FALSE(ipToFqdn.getFlowFqdn(IPAddress(ip2)).has_value());
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(ip3)) == "three.com");
+
+    auto stats = ipToFqdn.getStats();
+    CHECK(stats.entries == 4);
+    CHECK(stats.evictions == 1);
+}
+
+TEST_CASE("IpToFqdn cache", "[iptofqdn]")
+{
+    FlowstatsConfiguration conf;
+    auto path = fmt::format("/tmp/flowstats_fqdn_cache_{}", getpid());
+    auto ip = Tins::IPv4Address("10.0.0.1");
+    auto staticIp = Tins::IPv4Address("10.0.0.2");
+    auto expiredIp = Tins::IPv4Address("10.0.0.3");
+    auto ipv6 = Tins::IPv6Address("2001:db8::1");
+    timeval now = { time(nullptr), 0 };
+
+    {
+        IpToFqdn ipToFqdn(conf);
+        ipToFqdn.updateFqdn("static.com", { staticIp }, {});
+        ipToFqdn.updateFqdn("live.com", { ip }, { ipv6 }, 300, now);
+        ipToFqdn.updateFqdn("expired.com", { expiredIp }, {}, 300, { 1000, 0 });
+        REQUIRE(ipToFqdn.saveCache(path));
+    }
+
+    IpToFqdn ipToFqdn(conf);
+    REQUIRE(ipToFqdn.loadCache(path));
+    unlink(path.c_str());
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(ip)) == "live.com");
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(ipv6)) == "live.com");
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(staticIp)) == "static.com");
+    CHECK_FALSE(ipToFqdn.getFlowFqdn(IPAddress(expiredIp)).has_value());
+
+    // Loaded ttls still expire
+    ipToFqdn.advanceTick(now);
+    ipToFqdn.advanceTick({ now.tv_sec + 301, 0 });
+    CHECK_FALSE(ipToFqdn.getFlowFqdn(IPAddress(ip)).has_value());
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(staticIp)) == "static.com");
+
+    CHECK_FALSE(ipToFqdn.loadCache(path));
+}
+
+TEST_CASE("IpToFqdn replayed cache", "[iptofqdn]")
+{
+    FlowstatsConfiguration conf;
+    auto path = fmt::format("/tmp/flowstats_fqdn_replay_cache_{}", getpid());
+    auto ip = Tins::IPv4Address("10.0.0.1");
+    auto expiredIp = Tins::IPv4Address("10.0.0.2");
+
+    // Expiries of a replayed capture are saved as their remaining ttl
+    {
+        IpToFqdn ipToFqdn(conf);
+        ipToFqdn.advanceTick({ 1000, 0 });
+        ipToFqdn.updateFqdn("replay.com", { ip }, {}, 300, { 1000, 0 });
+        ipToFqdn.updateFqdn("expired.com", { expiredIp }, {}, 60, { 1000, 0 });
+        ipToFqdn.advanceTick({ 1100, 0 });
+        REQUIRE(ipToFqdn.saveCache(path));
+    }
+
+    timeval now = { time(nullptr), 0 };
+    IpToFqdn ipToFqdn(conf);
+    REQUIRE(ipToFqdn.loadCache(path));
+    unlink(path.c_str());
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(ip)) == "replay.com");
+    CHECK_FALSE(ipToFqdn.getFlowFqdn(IPAddress(expiredIp)).has_value());
+
+    ipToFqdn.advanceTick(now);
+    ipToFqdn.advanceTick({ now.tv_sec + 201, 0 });
+    CHECK_FALSE(ipToFqdn.getFlowFqdn(IPAddress(ip)).has_value());
+}
+
+TEST_CASE("IpToFqdn prefix fallback", "[iptofqdn]")
+{
+    FlowstatsConfiguration conf;
+    IpToFqdn ipToFqdn(conf);
+    CHECK(ipToFqdn.addPrefix("10.0.0.0/8", "internal"));
+    CHECK(ipToFqdn.addPrefix("10.1.0.0/16", "k8s-pods"));
+    CHECK(ipToFqdn.addPrefix("2600:1f00::/24", "aws"));
+    CHECK_FALSE(ipToFqdn.addPrefix("10.0.0.0/33", "invalid"));
+    CHECK_FALSE(ipToFqdn.addPrefix("10.0.0/8", "invalid"));
+
+    auto ip = Tins::IPv4Address("10.1.2.3");
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(ip)) == "k8s-pods");
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(Tins::IPv4Address("10.2.0.1"))) == "internal");
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(Tins::IPv6Address("2600:1f01::1"))) == "aws");
+    CHECK_FALSE(ipToFqdn.getFlowFqdn(IPAddress(Tins::IPv4Address("11.0.0.1"))).has_value());
+
+    // Dns mappings take precedence
+    ipToFqdn.updateFqdn("api.com", { ip }, {});
+    CHECK(ipToFqdn.getFlowFqdn(IPAddress(ip)) == "api.com");
+
+    auto stats = ipToFqdn.getStats();
+    CHECK(stats.hits == 1);
+    CHECK(stats.prefixHits == 3);
+    CHECK(stats.misses == 1);
+}
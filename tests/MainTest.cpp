@@ -33,17 +33,8 @@ auto Tester::readPcap(std::string const& pcap, std::string const& bpf, bool adva
     INFO("Checking file " << fullPath);
     REQUIRE(stat(fullPath.c_str(), &buffer) == 0);
 
-    auto reader = Tins::FileSniffer(fullPath, bpf);
-
-    int i = 0;
-    while (true) {
-        Tins::Packet packet = reader.next_packet();
-        if (packet.timestamp().seconds() == 0) {
-            break;
-        }
-        i++;
-        pktSource->processPacketSource(packet);
-    }
+    int i = pktSource->readPcapFile(fullPath, bpf);
+    REQUIRE(i >= 0);
     SPDLOG_INFO("Processed {} packets", i);
 
     if (advanceTick) {
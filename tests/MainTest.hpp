@@ -25,6 +25,7 @@ public:
 
     auto getSslStatsCollector() const -> SslStatsCollector const& { return sslStatsCollector; }
     auto getFlowstatsConfiguration() const -> FlowstatsConfiguration const& { return conf; }
+    auto getFlowstatsConfiguration() -> FlowstatsConfiguration& { return conf; }
     auto getIpToFqdn() -> IpToFqdn& { return ipToFqdn; }
 
 private:
@@ -37,5 +38,5 @@ private:
     TcpStatsCollector tcpStatsCollector;
     std::vector<Collector*> collectors;
     PktSource *pktSource;
-    std::atomic_bool shouldStop;
+    std::atomic_bool shouldStop = false;
 };
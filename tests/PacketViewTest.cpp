@@ -0,0 +1,157 @@
+#include "FlowId.hpp"
+#include "PacketView.hpp"
+#include <catch2/catch.hpp>
+#include <pcap/pcap.h>
+
+using namespace flowstats;
+
+namespace {
+
+auto ethernetHeader(uint16_t etherType) -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> frame(12, 0xaa);
+    frame.push_back(etherType >> 8);
+    frame.push_back(etherType & 0xff);
+    return frame;
+}
+
+auto ipv4Header(uint8_t protocol, uint16_t payloadSize) -> std::vector<uint8_t>
+{
+    uint16_t totalLength = 20 + payloadSize;
+    return {
+        0x45, 0, uint8_t(totalLength >> 8), uint8_t(totalLength & 0xff),
+        0, 1, 0x40, 0, 64, protocol, 0, 0,
+        10, 0, 0, 1,
+        10, 0, 0, 2
+    };
+}
+
+auto tcpHeader(uint16_t sport, uint16_t dport, uint8_t flags) -> std::vector<uint8_t>
+{
+    return {
+        uint8_t(sport >> 8), uint8_t(sport & 0xff), uint8_t(dport >> 8), uint8_t(dport & 0xff),
+        0, 0, 0x10, 0, // seq
+        0, 0, 0x20, 0, // ack
+        0x50, flags, 0x01, 0x00, // data offset, flags, window
+        0, 0, 0, 0
+    };
+}
+
+auto append(std::vector<uint8_t>* dst, std::vector<uint8_t> const& src) -> void
+{
+    dst->insert(dst->end(), src.begin(), src.end());
+}
+
+} // namespace
+
+TEST_CASE("PacketView vlan tcp", "[packetview]")
+{
+    auto frame = ethernetHeader(0x8100);
+    append(&frame, { 0x00, 0x0a, 0x08, 0x00 });
+    append(&frame, ipv4Header(6, 20 + 4));
+    append(&frame, tcpHeader(44000, 443, 0x18));
+    append(&frame, { 0x16, 0x03, 0x01, 0x00 });
+
+    PacketView packet;
+    REQUIRE(packet.parseFrame(DLT_EN10MB, frame.data(), frame.size(), { 1, 0 }) == PACKET_OK);
+    CHECK(packet.isTcp());
+    CHECK(packet.getSrcPort() == 44000);
+    CHECK(packet.getDstPort() == 443);
+    CHECK(packet.getSeq() == 0x1000);
+    CHECK(packet.getAckSeq() == 0x2000);
+    CHECK(packet.getWindow() == 0x100);
+    CHECK(packet.hasFlags(0x18));
+    CHECK(packet.getPayloadSize() == 4);
+    CHECK(packet.getWirePayloadSize() == 4);
+    CHECK(packet.getPayload()[0] == 0x16);
+    CHECK(packet.getAdvertisedSize() == 18 + 20 + 20 + 4);
+    CHECK(packet.getSrcIp() == IPAddress(Tins::IPv4Address("10.0.0.1")));
+    CHECK(packet.getDstIp() == IPAddress(Tins::IPv4Address("10.0.0.2")));
+
+    auto flowId = FlowId(packet);
+    CHECK(flowId.getPort(1) == 443);
+    CHECK(flowId.getTransport() == +Transport::TCP);
+}
+
+TEST_CASE("PacketView ipv6 udp with extension header", "[packetview]")
+{
+    auto frame = ethernetHeader(0x86dd);
+    std::vector<uint8_t> ipv6 = { 0x60, 0, 0, 0, 0, 8 + 8 + 3, 0, 64 };
+    ipv6.resize(8 + 32, 0);
+    ipv6[23] = 1;
+    ipv6[39] = 2;
+    append(&frame, ipv6);
+    // Hop-by-hop options, next header is udp
+    append(&frame, { 17, 0, 1, 4, 0, 0, 0, 0 });
+    append(&frame, { 0x12, 0x34, 0, 53, 0, 11, 0, 0, 'a', 'b', 'c' });
+
+    PacketView packet;
+    REQUIRE(packet.parseFrame(DLT_EN10MB, frame.data(), frame.size(), { 1, 0 }) == PACKET_OK);
+    CHECK(packet.getIsV6());
+    CHECK(packet.isUdp());
+    CHECK(packet.getDstPort() == 53);
+    CHECK(packet.getPayloadSize() == 3);
+    CHECK(packet.getSrcIp().getIsV6());
+    CHECK(packet.getDstIp() == IPAddress(Tins::IPv6Address("::2")));
+}
+
+TEST_CASE("FlowId keys", "[packetview]")
+{
+    auto clt = IPAddress(Tins::IPv4Address("10.0.0.1"));
+    auto srv = IPAddress(Tins::IPv4Address("10.0.0.2"));
+    auto request = FlowId({ 44000, 443 }, { clt, srv }, Transport::TCP);
+    auto response = FlowId({ 443, 44000 }, { srv, clt }, Transport::TCP);
+    CHECK(request == response);
+    CHECK(request.hash() == response.hash());
+    CHECK(request.getDirection() != response.getDirection());
+    CHECK(request.getIp(0) == srv);
+    CHECK(request.getIp(1) == clt);
+    CHECK_FALSE(request == FlowId({ 44000, 443 }, { clt, srv }, Transport::UDP));
+
+    auto clt6 = IPAddress(Tins::IPv6Address("2001:db8::1"));
+    auto srv6 = IPAddress(Tins::IPv6Address("2001:db8::2"));
+    auto flow6 = FlowId({ 44000, 443 }, { clt6, srv6 }, Transport::TCP);
+    CHECK(flow6.getIsV6());
+    CHECK(flow6 == FlowId({ 443, 44000 }, { srv6, clt6 }, Transport::TCP));
+    CHECK(flow6.getIp(0) == srv6);
+    CHECK(flow6.getPort(0) == 443);
+    CHECK_FALSE(flow6 == request);
+}
+
+TEST_CASE("PacketView skipped and unsupported frames", "[packetview]")
+{
+    PacketView packet;
+
+    auto arp = ethernetHeader(0x0806);
+    arp.resize(42, 0);
+    CHECK(packet.parseFrame(DLT_EN10MB, arp.data(), arp.size(), {}) == PACKET_SKIP);
+
+    auto mpls = ethernetHeader(0x8847);
+    mpls.resize(60, 0);
+    CHECK(packet.parseFrame(DLT_EN10MB, mpls.data(), mpls.size(), {}) == PACKET_UNSUPPORTED);
+
+    auto fragment = ethernetHeader(0x0800);
+    auto ip = ipv4Header(6, 40);
+    ip[6] = 0;
+    ip[7] = 10;
+    append(&fragment, ip);
+    fragment.resize(fragment.size() + 40, 0);
+    CHECK(packet.parseFrame(DLT_EN10MB, fragment.data(), fragment.size(), {}) == PACKET_SKIP);
+
+    auto truncated = ethernetHeader(0x0800);
+    append(&truncated, ipv4Header(6, 20));
+    append(&truncated, { 0, 80, 0, 80 });
+    CHECK(packet.parseFrame(DLT_EN10MB, truncated.data(), truncated.size(), {}) == PACKET_SKIP);
+}
+
+TEST_CASE("PacketView raw ip", "[packetview]")
+{
+    auto frame = ipv4Header(6, 20);
+    append(&frame, tcpHeader(80, 50000, 0x12));
+
+    PacketView packet;
+    REQUIRE(packet.parseFrame(DLT_RAW, frame.data(), frame.size(), {}) == PACKET_OK);
+    CHECK(packet.getSrcPort() == 80);
+    CHECK(packet.getPayloadSize() == 0);
+    CHECK(packet.getAdvertisedSize() == 40);
+}
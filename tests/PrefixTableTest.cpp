@@ -0,0 +1,105 @@
+#include "PrefixTable.hpp"
+#include <arpa/inet.h>
+#include <array>
+#include <catch2/catch.hpp>
+#include <random>
+
+using namespace flowstats;
+
+namespace {
+auto ipv4(char const* str) -> std::array<uint8_t, 4>
+{
+    std::array<uint8_t, 4> addr = {};
+    inet_pton(AF_INET, str, addr.data());
+    return addr;
+}
+
+auto ipv6(char const* str) -> std::array<uint8_t, 16>
+{
+    std::array<uint8_t, 16> addr = {};
+    inet_pton(AF_INET6, str, addr.data());
+    return addr;
+}
+} // namespace
+
+TEST_CASE("PrefixTable longest match", "[prefixtable]")
+{
+    PrefixTable<4> table;
+    CHECK_FALSE(table.find(ipv4("10.1.2.3").data()).has_value());
+
+    // Longer prefixes inserted first must survive shorter ones
+    table.insert(ipv4("10.1.2.0").data(), 24, 3);
+    table.insert(ipv4("10.1.2.3").data(), 32, 4);
+    table.insert(ipv4("10.0.0.0").data(), 8, 1);
+    table.insert(ipv4("10.1.0.0").data(), 16, 2);
+    table.insert(ipv4("10.1.2.128").data(), 25, 5);
+
+    CHECK(table.find(ipv4("10.1.2.3").data()) == 4u);
+    CHECK(table.find(ipv4("10.1.2.4").data()) == 3u);
+    CHECK(table.find(ipv4("10.1.2.200").data()) == 5u);
+    CHECK(table.find(ipv4("10.1.3.1").data()) == 2u);
+    CHECK(table.find(ipv4("10.200.3.1").data()) == 1u);
+    CHECK_FALSE(table.find(ipv4("11.0.0.1").data()).has_value());
+
+    table.insert(ipv4("0.0.0.0").data(), 0, 6);
+    CHECK(table.find(ipv4("11.0.0.1").data()) == 6u);
+    CHECK(table.find(ipv4("10.1.2.3").data()) == 4u);
+    CHECK(table.size() == 6);
+}
+
+TEST_CASE("PrefixTable ipv6", "[prefixtable]")
+{
+    PrefixTable<16> table;
+    table.insert(ipv6("2001:db8::").data(), 32, 1);
+    table.insert(ipv6("2001:db8:aa00::").data(), 40, 2);
+    table.insert(ipv6("2001:db8:aa00::1").data(), 128, 3);
+
+    CHECK(table.find(ipv6("2001:db8:1::1").data()) == 1u);
+    CHECK(table.find(ipv6("2001:db8:aaff::1").data()) == 2u);
+    CHECK(table.find(ipv6("2001:db8:aa00::1").data()) == 3u);
+    CHECK(table.find(ipv6("2001:db8:aa00::2").data()) == 2u);
+    CHECK_FALSE(table.find(ipv6("2001:db9::1").data()).has_value());
+}
+
+TEST_CASE("PrefixTable matches linear scan", "[prefixtable]")
+{
+    struct Prefix {
+        uint32_t addr;
+        size_t len;
+        uint32_t value;
+    };
+    std::vector<Prefix> prefixes;
+    PrefixTable<4> table;
+    std::mt19937 gen(1);
+    auto toBytes = [](uint32_t addr) {
+        return std::array<uint8_t, 4> { static_cast<uint8_t>(addr >> 24), static_cast<uint8_t>(addr >> 16),
+            static_cast<uint8_t>(addr >> 8), static_cast<uint8_t>(addr) };
+    };
+    auto mask = [](size_t len) { return len == 0 ? 0 : ~uint32_t(0) << (32 - len); };
+
+    // Cluster prefixes under 10/8 so they overlap
+    for (uint32_t value = 1; value < 2000; ++value) {
+        size_t len = 8 + gen() % 25;
+        uint32_t addr = (0x0a000000 | (gen() & 0x00ffffff)) & mask(len);
+        prefixes.push_back({ addr, len, value });
+        table.insert(toBytes(addr).data(), len, value);
+    }
+
+    for (int i = 0; i < 20000; ++i) {
+        uint32_t addr = 0x0a000000 | (gen() & 0x00ffffff);
+        if (i % 2 == 0) {
+            // Land inside a known prefix
+            auto const& prefix = prefixes[gen() % prefixes.size()];
+            addr = prefix.addr | (gen() & ~mask(prefix.len));
+        }
+        std::optional<uint32_t> expected;
+        size_t bestLen = 0;
+        for (auto const& prefix : prefixes) {
+            if ((addr & mask(prefix.len)) == prefix.addr && (!expected.has_value() || prefix.len >= bestLen)) {
+                expected = prefix.value;
+                bestLen = prefix.len;
+            }
+        }
+        REQUIRE(table.find(toBytes(addr).data()) == expected);
+    }
+}
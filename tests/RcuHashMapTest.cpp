@@ -0,0 +1,103 @@
+#include "RcuHashMap.hpp"
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <thread>
+#include <vector>
+
+using namespace flowstats;
+
+TEST_CASE("RcuHashMap insert and update", "[rcuhashmap]")
+{
+    RcuHashMap<uint32_t, uint32_t> map(16);
+    CHECK_FALSE(map.find(1).has_value());
+
+    CHECK_FALSE(map.insert(1, 10).has_value());
+    CHECK_FALSE(map.insert(2, 20).has_value());
+    CHECK(map.insert(1, 11) == 10u);
+    CHECK(map.find(1) == 11u);
+    CHECK(map.find(2) == 20u);
+    CHECK(map.size() == 2);
+
+    // Grow a few times
+    for (uint32_t i = 0; i < 10000; ++i) {
+        map.insert(i << 8, i);
+    }
+    CHECK(map.size() == 10000 + 2);
+    CHECK(map.find(1) == 11u);
+    CHECK(map.find(9999u << 8) == 9999u);
+
+    size_t visited = 0;
+    map.forEach([&](uint32_t, uint32_t) { visited++; });
+    CHECK(visited == map.size());
+}
+
+TEST_CASE("RcuHashMap erase and evict", "[rcuhashmap]")
+{
+    RcuHashMap<uint32_t, uint32_t> map(16, 3);
+    map.insert(1, 1, true);
+    map.insert(2, 2);
+    map.insert(3, 3);
+    CHECK(map.erase(3));
+    CHECK_FALSE(map.erase(3));
+    CHECK_FALSE(map.find(3).has_value());
+    CHECK(map.size() == 2);
+
+    // Revive a deleted key
+    map.insert(3, 33);
+    CHECK(map.find(3) == 33u);
+
+    // 3 was referenced by the lookup, 1 is pinned
+    map.insert(4, 4);
+    CHECK(map.getEvictions() == 1);
+    CHECK(map.size() == 3);
+    CHECK(map.find(1) == 1u);
+    CHECK_FALSE(map.peek(2).has_value());
+    CHECK(map.find(3) == 33u);
+    CHECK(map.find(4) == 4u);
+
+    // Deleted slots are dropped by rebuilds
+    map.erase(4);
+    for (uint32_t i = 100; i < 10000; ++i) {
+        map.insert(i, i);
+        map.erase(i);
+    }
+    CHECK(map.size() == 2);
+    CHECK(map.getEvictions() == 1);
+    CHECK(map.find(1) == 1u);
+    CHECK(map.find(3) == 33u);
+}
+
+TEST_CASE("RcuHashMap concurrent readers", "[rcuhashmap]")
+{
+    RcuHashMap<uint32_t, uint32_t> map(16);
+    std::atomic_bool done = false;
+    std::atomic<uint32_t> inserted = 0;
+    std::atomic<int> errors = 0;
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&]() {
+            while (!done.load()) {
+                // Everything inserted before the read has to be visible
+                uint32_t last = inserted.load();
+                for (uint32_t i = 0; i < last; i += 97) {
+                    auto value = map.find(i);
+                    if (!value.has_value() || *value != i + 1) {
+                        errors++;
+                    }
+                }
+            }
+        });
+    }
+
+    for (uint32_t i = 0; i < 20000; ++i) {
+        map.insert(i, i + 1);
+        inserted.store(i + 1);
+    }
+    done.store(true);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    CHECK(errors.load() == 0);
+    CHECK(map.size() == 20000);
+}
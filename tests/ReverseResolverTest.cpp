@@ -0,0 +1,132 @@
+#include "Configuration.hpp"
+#include "IpToFqdn.hpp"
+#include "ReverseResolver.hpp"
+#include <arpa/inet.h>
+#include <array>
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <netinet/in.h>
+#include <poll.h>
+#include <thread>
+#include <tins/dns.h>
+#include <unistd.h>
+
+using namespace flowstats;
+
+namespace {
+/**
+ * Answer PTR queries for 10.2.3.4 on a local udp port, NXDOMAIN otherwise
+ */
+class StubDnsServer {
+public:
+    StubDnsServer()
+    {
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        socklen_t len = sizeof(addr);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        port = ntohs(addr.sin_port);
+        server = std::thread(&StubDnsServer::serve, this);
+    }
+
+    ~StubDnsServer()
+    {
+        stop = true;
+        server.join();
+        close(fd);
+    }
+
+    uint16_t port = 0;
+    std::atomic<int> queries = 0;
+
+private:
+    auto serve() -> void
+    {
+        std::array<uint8_t, 4096> buffer;
+        while (!stop) {
+            pollfd pfd = { fd, POLLIN, 0 };
+            if (poll(&pfd, 1, 10) <= 0) {
+                continue;
+            }
+            sockaddr_storage from = {};
+            socklen_t fromLen = sizeof(from);
+            auto len = recvfrom(fd, buffer.data(), buffer.size(), 0,
+                reinterpret_cast<sockaddr*>(&from), &fromLen);
+            Tins::DNS dns(buffer.data(), len);
+            queries++;
+            dns.type(Tins::DNS::RESPONSE);
+            auto name = dns.queries().at(0).dname();
+            if (name == "4.3.2.10.in-addr.arpa") {
+                dns.add_answer(Tins::DNS::resource(name, "host.example.com",
+                    Tins::DNS::PTR, Tins::DNS::INTERNET, 300));
+            } else {
+                dns.rcode(3);
+            }
+            auto response = dns.serialize();
+            sendto(fd, response.data(), response.size(), 0,
+                reinterpret_cast<sockaddr*>(&from), fromLen);
+        }
+    }
+
+    int fd = -1;
+    std::atomic_bool stop = false;
+    std::thread server;
+};
+
+// enqueue drops the address when the resolver holds the lock
+auto enqueue(ReverseResolver* resolver, IPAddress const& ip) -> void
+{
+    auto dropped = resolver->getStats().dropped;
+    resolver->enqueue(ip);
+    while (resolver->getStats().dropped != dropped) {
+        dropped = resolver->getStats().dropped;
+        resolver->enqueue(ip);
+    }
+}
+
+auto waitProcessed(ReverseResolver const& resolver, uint64_t expected) -> void
+{
+    for (int i = 0; i < 300; ++i) {
+        auto stats = resolver.getStats();
+        if (stats.resolved + stats.failed >= expected) {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+} // namespace
+
+TEST_CASE("ReverseResolver ptr names", "[reverse]")
+{
+    CHECK(ReverseResolver::ptrName(IPAddress(Tins::IPv4Address("10.2.3.4"))) == "4.3.2.10.in-addr.arpa");
+    CHECK(ReverseResolver::ptrName(IPAddress(Tins::IPv6Address("2001:db8::567:89ab")))
+        == "b.a.9.8.7.6.5.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.8.b.d.0.1.0.0.2.ip6.arpa");
+}
+
+TEST_CASE("ReverseResolver stub server", "[reverse]")
+{
+    StubDnsServer stub;
+    FlowstatsConfiguration conf;
+    IpToFqdn ipToFqdn(conf);
+    ReverseResolver resolver(&ipToFqdn, fmt::format("127.0.0.1:{}", stub.port), 1000);
+    auto known = IPAddress(Tins::IPv4Address("10.2.3.4"));
+    auto unknown = IPAddress(Tins::IPv4Address("10.9.9.9"));
+
+    enqueue(&resolver, known);
+    enqueue(&resolver, unknown);
+    waitProcessed(resolver, 2);
+    CHECK(ipToFqdn.getFlowFqdn(known) == "host.example.com");
+    CHECK_FALSE(ipToFqdn.getFlowFqdn(unknown).has_value());
+
+    // Failures are cached, no new query is sent
+    enqueue(&resolver, unknown);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto stats = resolver.getStats();
+    CHECK(stats.queued == 2);
+    CHECK(stats.resolved == 1);
+    CHECK(stats.failed == 1);
+    CHECK(stub.queries == 2);
+}
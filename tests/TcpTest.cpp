@@ -36,11 +36,11 @@ TEST_CASE("Tcp simple", "[tcp]")
         CHECK(aggregatedFlow->getFieldStr(Field::MTU, FROM_CLIENT, 1, 0) == "140");
         CHECK(aggregatedFlow->getFieldStr(Field::MTU, FROM_SERVER, 1, 0) == "594");
 
-        auto flows = tcpStatsCollector.getTcpFlow();
+        auto const& flows = tcpStatsCollector.getTcpFlow();
         CHECK(flows.size() == 1);
         CHECK(flows.begin()->second.getGap() == 0);
 
-        AggregatedKey totalKey = AggregatedKey("Total", {}, 0);
+        AggregatedKey totalKey = AggregatedKey(FQDN_TOTAL, {}, 0);
         std::map<Field, std::string> totalValues;
         CHECK(aggregatedFlow->getFieldStr(Field::SYN, FROM_CLIENT, 1, 0) == "1");
     }
@@ -78,6 +78,24 @@ TEST_CASE("Tcp sort", "[tcp]")
         CHECK(flows[1]->getSrvPort() == 443);
         CHECK(flows[2]->getSrvPort() == 443);
         CHECK(flows[3]->getSrvPort() == 443);
+
+        flows = tcpStatsCollector.getAggregatedFlows(2);
+        REQUIRE(flows.size() == 2);
+        CHECK(flows[0]->getSrvPort() == 80);
+        CHECK(flows[1]->getSrvPort() == 443);
+
+        tcpStatsCollector.publishSnapshot();
+        auto output = tcpStatsCollector.outputStatus(1, 1, 2);
+        CHECK(output.getFirstRow() == 1);
+        CHECK(output.getNumRows() == 5);
+        CHECK(output.getValues().size() == 2);
+        CHECK(output.hasRows(1, 2));
+        CHECK_FALSE(output.hasRows(0, 2));
+
+        output = tcpStatsCollector.outputStatus(1, 0, 0);
+        CHECK(output.getFirstRow() == 0);
+        CHECK(output.getNumRows() == 5);
+        CHECK(output.getValues().empty());
     }
 }
 
@@ -102,7 +120,7 @@ TEST_CASE("https pcap", "[tcp]")
         CHECK(aggregatedFlow->getFieldStr(Field::CONN, FROM_CLIENT, 1, 0)== "1");
         CHECK(aggregatedFlow->getFieldStr(Field::CT_P99, FROM_CLIENT, 1, 0)== "1ms");
 
-        auto flows = tcpStatsCollector.getTcpFlow();
+        auto const& flows = tcpStatsCollector.getTcpFlow();
         REQUIRE(flows.size() == 1);
         CHECK(flows.begin()->second.getGap() == 0);
     }
@@ -147,7 +165,7 @@ TEST_CASE("Tcp reused port", "[tcp]")
         CHECK(aggregatedFlow->getFieldStr(Field::CT_P99, FROM_CLIENT, 1, 0) == "0ms");
         CHECK(aggregatedFlow->getFieldStr(Field::SRT_P99, FROM_CLIENT, 1, 0) == "0ms");
 
-        auto flows = tcpStatsCollector.getTcpFlow();
+        auto const& flows = tcpStatsCollector.getTcpFlow();
         REQUIRE(flows.size() == 0);
     }
 }
@@ -336,7 +354,7 @@ TEST_CASE("Gap in capture", "[tcp]")
         CHECK(flow->getFieldStr(Field::SRT, FROM_CLIENT, 1, 0) == "1");
         CHECK(flow->getFieldStr(Field::SRT_P99, FROM_CLIENT, 1, 0) == "26ms");
 
-        auto flows = tcpStatsCollector.getTcpFlow();
+        auto const& flows = tcpStatsCollector.getTcpFlow();
         CHECK(flows.size() == 1);
         CHECK(flows.begin()->second.getGap() == 1);
     }
@@ -392,3 +410,32 @@ TEST_CASE("Ipv6", "[tcp]")
         CHECK(flow->getFieldStr(Field::BYTES, FROM_SERVER, 1, 0) == "886 B");
     }
 }
+
+TEST_CASE("Snapshots reuse flow copies", "[tcp]")
+{
+    auto tester = Tester();
+    auto& tcpStatsCollector = tester.getTcpStatsCollector();
+    tester.readPcap("https.pcap", "port 443", false);
+    auto* aggregatedFlow = tcpStatsCollector.getAggregatedMap()->begin()->second;
+
+    tcpStatsCollector.publishSnapshot();
+    auto first = tcpStatsCollector.getSnapshot();
+    REQUIRE(first->flows.size() == 1);
+    auto const* firstCopy = first->flows[0].second.get();
+
+    // Unchanged flows are shared with the previous snapshot
+    tcpStatsCollector.publishSnapshot();
+    CHECK(tcpStatsCollector.getSnapshot()->flows[0].second.get() == firstCopy);
+    first.reset();
+
+    // Once released, a copy is overwritten by the second change after it
+    aggregatedFlow->resetFlow(true);
+    tcpStatsCollector.publishSnapshot();
+    CHECK(tcpStatsCollector.getSnapshot()->flows[0].second.get() != firstCopy);
+
+    aggregatedFlow->resetFlow(true);
+    tcpStatsCollector.publishSnapshot();
+    auto last = tcpStatsCollector.getSnapshot();
+    CHECK(last->flows[0].second.get() == firstCopy);
+    CHECK(last->flows[0].second->getTotalPackets() == aggregatedFlow->getTotalPackets());
+}
@@ -0,0 +1,89 @@
+#include "TimerWheel.hpp"
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <limits>
+#include <map>
+#include <random>
+
+using namespace flowstats;
+
+TEST_CASE("TimerWheel fires at deadline", "[timerwheel]")
+{
+    TimerWheel<int> wheel;
+    std::vector<int> expired;
+    auto onExpire = [&](int key) { expired.push_back(key); };
+
+    wheel.advance(1000000, onExpire);
+    wheel.schedule(1, 1000100);
+    wheel.schedule(2, 1000050);
+    wheel.schedule(3, 1000000 + 5 * 60 * 1000);
+    CHECK(wheel.size() == 3);
+
+    wheel.advance(1000040, onExpire);
+    CHECK(expired.empty());
+    wheel.advance(1000050, onExpire);
+    CHECK(expired == std::vector<int> { 2 });
+    wheel.advance(1000000 + 5 * 60 * 1000 - 10, onExpire);
+    CHECK(expired == std::vector<int> { 2, 1 });
+    wheel.advance(1000000 + 5 * 60 * 1000, onExpire);
+    CHECK(expired == std::vector<int> { 2, 1, 3 });
+    CHECK(wheel.size() == 0);
+}
+
+TEST_CASE("TimerWheel re-arm and drain", "[timerwheel]")
+{
+    TimerWheel<int> wheel;
+    int fired = 0;
+    wheel.advance(0, [](int) {});
+    wheel.schedule(1, 100);
+    // Re-arm from the callback
+    wheel.advance(100, [&](int key) {
+        fired++;
+        wheel.schedule(key, 200);
+    });
+    CHECK(fired == 1);
+    CHECK(wheel.size() == 1);
+
+    // A past deadline fires on the next tick
+    wheel.schedule(2, 0);
+    wheel.schedule(3, std::numeric_limits<uint64_t>::max() / 2);
+    std::vector<int> expired;
+    wheel.advance(std::numeric_limits<uint64_t>::max(), [&](int key) { expired.push_back(key); });
+    std::sort(expired.begin(), expired.end());
+    CHECK(expired == std::vector<int> { 1, 2, 3 });
+}
+
+TEST_CASE("TimerWheel matches sorted deadlines", "[timerwheel]")
+{
+    TimerWheel<uint32_t> wheel;
+    std::multimap<uint64_t, uint32_t> reference;
+    std::mt19937 gen(1);
+    uint64_t now = 1600000000000;
+    wheel.advance(now, [](uint32_t) {});
+
+    for (uint32_t i = 0; i < 20000; ++i) {
+        // Mix sub second, minute and day long timeouts
+        uint64_t delay = gen() % 3 == 0 ? gen() % 1000 : gen() % (24 * 3600 * 1000);
+        uint64_t deadline = (now + delay) / 10 * 10 + 10;
+        wheel.schedule(i, deadline);
+        reference.emplace(deadline, i);
+        now += gen() % 5000;
+        wheel.advance(now, [&](uint32_t key) {
+            auto it = reference.begin();
+            REQUIRE(it != reference.end());
+            REQUIRE(it->first <= now);
+            auto range = reference.equal_range(it->first);
+            bool found = false;
+            for (auto r = range.first; r != range.second; ++r) {
+                if (r->second == key) {
+                    reference.erase(r);
+                    found = true;
+                    break;
+                }
+            }
+            REQUIRE(found);
+        });
+        REQUIRE((reference.empty() || reference.begin()->first > now));
+    }
+    CHECK(wheel.size() == reference.size());
+}
@@ -1,9 +1,12 @@
 #include "Utils.hpp"
 #include "Collector.hpp"
 #include "DnsStatsCollector.hpp"
+#include "FqdnTable.hpp"
 #include "MainTest.hpp"
+#include "Stats.hpp"
 #include "TcpStatsCollector.hpp"
 #include <catch2/catch.hpp>
+#include <cmath>
 
 using namespace flowstats;
 
@@ -23,6 +26,53 @@ TEST_CASE("Fqdn sort", "[sort]")
     CHECK(vec1[4]->getFqdn() == "z1");
 }
 
+TEST_CASE("Fqdn intern", "[fqdn]")
+{
+    FqdnTable table;
+    CHECK(table.get(FQDN_NONE).empty());
+    CHECK(table.get(FQDN_UNKNOWN) == "Unknown");
+    CHECK(table.get(FQDN_TOTAL) == "Total");
+
+    auto id = table.intern("www.test.com");
+    CHECK(table.intern(std::string("www.test.com")) == id);
+    CHECK(table.intern("Total") == FQDN_TOTAL);
+
+    // Ids and strings stay valid when blocks are added
+    auto const& str = table.get(id);
+    for (int i = 0; i < 10000; ++i) {
+        CHECK(table.intern(std::to_string(i)) == id + 1 + i);
+    }
+    CHECK(table.get(id + 1 + 5000) == "5000");
+    CHECK(&table.get(id) == &str);
+    CHECK(table.size() == 10000 + 4);
+}
+
+TEST_CASE("Fqdn release", "[fqdn]")
+{
+    FqdnTable table;
+    auto id = table.acquire("www.test.com");
+    CHECK(table.acquire("www.test.com") == id);
+    CHECK(table.find("www.test.com") == id);
+    CHECK_FALSE(table.release(id));
+    CHECK(table.release(id));
+    CHECK_FALSE(table.find("www.test.com").has_value());
+    CHECK(table.size() == 3);
+
+    // Released ids are reused once recycled
+    table.recycle({ id });
+    CHECK(table.acquire("www.other.com") == id);
+    CHECK(table.get(id) == "www.other.com");
+    CHECK(table.getNumIds() == 4);
+
+    // Pinned and interned fqdns are never released
+    CHECK(table.pin(id));
+    CHECK_FALSE(table.release(id));
+    auto interned = table.acquire("Total");
+    CHECK(interned == FQDN_TOTAL);
+    CHECK_FALSE(table.release(interned));
+    CHECK(table.get(FQDN_TOTAL) == "Total");
+}
+
 TEST_CASE("Get With Warparound", "[warparound]")
 {
     CHECK(getWithWarparound(8, 10, 1) == 9);
@@ -35,3 +85,36 @@ TEST_CASE("Get With Warparound", "[warparound]")
 
     CHECK(getWithWarparound(0, 10, -1) == 9);
 }
+
+TEST_CASE("Percentile", "[percentile]")
+{
+    Percentile small;
+    for (uint32_t i = 1; i <= 100; ++i) {
+        small.addPoint(i);
+    }
+    CHECK(small.getCount() == 100);
+    CHECK(small.getPercentile(0) == 1);
+    CHECK(small.getPercentile(0.5) == 50);
+    CHECK(small.getPercentile(0.95) == 95);
+    CHECK(small.getPercentile(1) == 100);
+    CHECK(small.getPercentileStr(0.99) == "99ms");
+
+    Percentile large;
+    for (uint32_t i = 1; i <= 100000; ++i) {
+        large.addPoint(i * 1000);
+    }
+    Percentile merged;
+    merged.addPoints(small);
+    merged.addPoints(large);
+    CHECK(merged.getCount() == 100100);
+    CHECK(merged.getPercentile(0) == 1);
+    CHECK(merged.getPercentile(1) == 100000000);
+    for (auto p : { 0.5F, 0.95F, 0.99F }) {
+        auto expected = static_cast<double>(large.getPercentile(p));
+        CHECK(std::abs(expected - 1000 * floor(100000 * p + 0.5)) / expected < 0.01);
+    }
+
+    merged.reset();
+    CHECK(merged.getCount() == 0);
+    CHECK(merged.getPercentileStr(0.95) == "-");
+}